@@ -10,7 +10,7 @@ CONFIG += c++11 lrelease embed_translations
 # Qt version check
 contains(QT_VERSION, ^5\\..*) {
     message("Building for Qt version $${QT_VERSION}.")
-    QT += widgets xml
+    QT += concurrent widgets xml
 } else {
     error("Qt5 is required!")
 }
@@ -23,8 +23,13 @@ INCLUDEPATH += . $$SRC/contrib/SimpleLogger/src $$SRC/contrib/Argengine/src
 HEADERS +=  \
     $$SRC/about_dlg.hpp \
     $$SRC/application.hpp \
+    $$SRC/binary_serializer.hpp \
+    $$SRC/container_serializer.hpp \
     $$SRC/copy_paste.hpp \
     $$SRC/graph.hpp \
+    $$SRC/graph_algorithms.hpp \
+    $$SRC/graph_change.hpp \
+    $$SRC/graph_snapshot.hpp \
     $$SRC/graphics_factory.hpp \
     $$SRC/grid.hpp \
     $$SRC/edge.hpp \
@@ -50,7 +55,11 @@ HEADERS +=  \
     $$SRC/mouse_action.hpp \
     $$SRC/node.hpp \
     $$SRC/node_base.hpp \
+    $$SRC/node_geometry_table.hpp \
     $$SRC/node_handle.hpp \
+    $$SRC/node_id.hpp \
+    $$SRC/parallel.hpp \
+    $$SRC/persistent_vector.hpp \
     $$SRC/reader.hpp \
     $$SRC/recent_files_manager.hpp \
     $$SRC/recent_files_menu.hpp \
@@ -58,6 +67,8 @@ HEADERS +=  \
     $$SRC/serializer.hpp \
     $$SRC/state_machine.hpp \
     $$SRC/text_edit.hpp \
+    $$SRC/undo_command.hpp \
+    $$SRC/undo_journal.hpp \
     $$SRC/undo_stack.hpp \
     $$SRC/whats_new_dlg.hpp \
     $$SRC/writer.hpp \
@@ -67,8 +78,12 @@ HEADERS +=  \
 SOURCES += \
     $$SRC/about_dlg.cpp \
     $$SRC/application.cpp \
+    $$SRC/binary_serializer.cpp \
+    $$SRC/container_serializer.cpp \
     $$SRC/copy_paste.cpp \
     $$SRC/graph.cpp \
+    $$SRC/graph_algorithms.cpp \
+    $$SRC/graph_snapshot.cpp \
     $$SRC/graphics_factory.cpp \
     $$SRC/grid.cpp \
     $$SRC/edge.cpp \
@@ -93,6 +108,7 @@ SOURCES += \
     $$SRC/mouse_action.cpp \
     $$SRC/node.cpp \
     $$SRC/node_base.cpp \
+    $$SRC/node_geometry_table.cpp \
     $$SRC/node_handle.cpp \
     $$SRC/reader.cpp \
     $$SRC/recent_files_manager.cpp \
@@ -101,6 +117,8 @@ SOURCES += \
     $$SRC/serializer.cpp \
     $$SRC/state_machine.cpp \
     $$SRC/text_edit.cpp \
+    $$SRC/undo_command.cpp \
+    $$SRC/undo_journal.cpp \
     $$SRC/undo_stack.cpp \
     $$SRC/whats_new_dlg.cpp \
     $$SRC/writer.cpp \
@@ -108,6 +108,7 @@ Application::Application(int & argc, char ** argv)
     m_mainWindow.reset(new MainWindow);
     m_mediator.reset(new Mediator(*m_mainWindow));
     m_editorData.reset(new EditorData);
+    m_editorData->setUndoJournalEnabled(loadUndoJournalEnabled());
     m_editorScene.reset(new EditorScene);
     m_editorView = new EditorView(*m_mediator);
     m_pngExportDialog.reset(new PngExportDialog(*m_mainWindow));
@@ -152,7 +153,7 @@ Application::Application(int & argc, char ** argv)
 
 QString Application::getFileDialogFileText() const
 {
-    return tr("Heimer Files") + " (*" + Constants::Application::FILE_EXTENSION + ")";
+    return tr("Heimer Files") + " (*" + Constants::Application::FILE_EXTENSION + " *" + Constants::Application::BINARY_FILE_EXTENSION + " *" + Constants::Application::CONTAINER_FILE_EXTENSION + ")";
 }
 
 int Application::run()
@@ -239,7 +240,7 @@ void Application::doOpenMindMap(QString fileName)
     L().debug() << "Opening '" << fileName.toStdString();
 
     if (m_mediator->openMindMap(fileName)) {
-        m_mainWindow->disableUndoAndRedo();
+        m_mainWindow->updateUndoAndRedo();
 
         saveRecentPath(fileName);
 
@@ -281,7 +282,7 @@ void Application::saveMindMapAs()
         return;
     }
 
-    if (!fileName.endsWith(Constants::Application::FILE_EXTENSION)) {
+    if (!fileName.endsWith(Constants::Application::FILE_EXTENSION) && !fileName.endsWith(Constants::Application::BINARY_FILE_EXTENSION) && !fileName.endsWith(Constants::Application::CONTAINER_FILE_EXTENSION)) {
         fileName += Constants::Application::FILE_EXTENSION;
     }
 
@@ -306,6 +307,15 @@ QString Application::loadRecentPath() const
     return path;
 }
 
+bool Application::loadUndoJournalEnabled() const
+{
+    QSettings settings;
+    settings.beginGroup(m_settingsGroup);
+    const auto enabled = settings.value("undoJournal", false).toBool();
+    settings.endGroup();
+    return enabled;
+}
+
 void Application::saveRecentPath(QString path)
 {
     QSettings settings;
@@ -64,6 +64,8 @@ private:
 
     QString loadRecentPath() const;
 
+    bool loadUndoJournalEnabled() const;
+
     void openArgMindMap();
 
     void openMindMap();
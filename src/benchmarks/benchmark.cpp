@@ -0,0 +1,176 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include "simple_logger.hpp"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSysInfo>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+using juzzlin::L;
+
+namespace {
+
+//! \return The given memory field of /proc/self/status in bytes, or -1 if not available.
+qint64 memoryStatus(const QByteArray & field)
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/status");
+    if (file.open(QIODevice::ReadOnly)) {
+        for (auto && line : file.readAll().split('\n')) {
+            if (line.startsWith(field + ':')) {
+                return line.mid(field.size() + 1).simplified().split(' ').at(0).toLongLong() * 1024;
+            }
+        }
+    }
+#else
+    Q_UNUSED(field)
+#endif
+    return -1;
+}
+
+void resetPeakMemory()
+{
+#ifdef Q_OS_LINUX
+    // Resets the peak resident set size (VmHWM) to the current one
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+#endif
+}
+
+//! \return The memory before and the peak since the given memory, if available.
+QJsonObject memoryResult(qint64 memoryBefore)
+{
+    QJsonObject memory;
+    const auto peakMemory = memoryStatus("VmHWM");
+    if (memoryBefore >= 0 && peakMemory >= 0) {
+        memory.insert("rssBeforeBytes", memoryBefore);
+        memory.insert("peakRssBytes", peakMemory);
+    }
+    return memory;
+}
+
+} // namespace
+
+Benchmark::Benchmark(const QString & name)
+  : m_name(name)
+{
+}
+
+void Benchmark::setParameter(const QString & name, const QVariant & value)
+{
+    m_parameters.insert(name, QJsonValue::fromVariant(value));
+}
+
+void Benchmark::removeParameter(const QString & name)
+{
+    m_parameters.remove(name);
+}
+
+void Benchmark::measure(const QString & operation, size_t count, std::function<void()> function)
+{
+    resetPeakMemory();
+    const auto memoryBefore = memoryStatus("VmRSS");
+
+    QElapsedTimer timer;
+    timer.start();
+    function();
+    const auto nanoseconds = timer.nsecsElapsed();
+
+    addResult(operation, count, nanoseconds, memoryResult(memoryBefore));
+}
+
+void Benchmark::measureLatency(const QString & operation, size_t repetitions, std::function<void(size_t)> function)
+{
+    resetPeakMemory();
+    const auto memoryBefore = memoryStatus("VmRSS");
+
+    std::vector<qint64> latencies;
+    latencies.reserve(repetitions);
+    QElapsedTimer timer;
+    for (size_t i = 0; i < repetitions; i++) {
+        timer.start();
+        function(i);
+        latencies.push_back(timer.nsecsElapsed());
+    }
+
+    auto result = memoryResult(memoryBefore);
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        // Nearest-rank percentiles
+        const auto percentile = [&latencies](double p) {
+            const auto rank = static_cast<size_t>(std::ceil(p * latencies.size()));
+            return latencies.at(std::max<size_t>(rank, 1) - 1);
+        };
+        result.insert("p50Ns", percentile(0.5));
+        result.insert("p90Ns", percentile(0.9));
+        result.insert("p99Ns", percentile(0.99));
+        result.insert("maxNs", latencies.back());
+    }
+
+    addResult(operation, repetitions, std::accumulate(latencies.begin(), latencies.end(), qint64(0)), result);
+}
+
+void Benchmark::addResult(const QString & operation, size_t count, qint64 nanoseconds, const QJsonObject & extra)
+{
+    auto result = m_parameters;
+    result.insert("operation", operation);
+    result.insert("count", static_cast<qint64>(count));
+    result.insert("totalNs", nanoseconds);
+    result.insert("nsPerItem", count ? static_cast<double>(nanoseconds) / count : 0.0);
+    for (auto iter = extra.begin(); iter != extra.end(); iter++) {
+        result.insert(iter.key(), iter.value());
+    }
+    m_results.append(result);
+
+    L().info() << m_name.toStdString() << ": " << operation.toStdString() << " x " << count << ": " << nanoseconds / 1000000.0 << " ms";
+}
+
+QJsonObject Benchmark::toJson() const
+{
+    QJsonObject json;
+    json.insert("benchmark", m_name);
+    json.insert("version", VERSION);
+    json.insert("buildAbi", QSysInfo::buildAbi());
+    json.insert("results", m_results);
+    return json;
+}
+
+bool Benchmark::write(const QString & fileName) const
+{
+    const auto json = QJsonDocument(toJson()).toJson();
+    if (fileName.isEmpty()) {
+        return std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout) == static_cast<size_t>(json.size());
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+        L().error() << "Cannot write '" << fileName.toStdString() << "'";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVariant>
+
+#include <functional>
+
+/*! Collects timings of benchmarked operations and writes them as JSON, so that results can be compared
+ *  across releases. Each result holds the parameters set at the time, e.g. the topology and the number of
+ *  nodes, the operation, the number of items it was done for and the elapsed time. On Linux the resident
+ *  memory before the operation and the peak during it are recorded too. */
+class Benchmark
+{
+public:
+    explicit Benchmark(const QString & name);
+
+    //! Sets a parameter for the following results.
+    void setParameter(const QString & name, const QVariant & value);
+
+    void removeParameter(const QString & name);
+
+    //! Runs the function once and records it as the operation done for the given number of items.
+    void measure(const QString & operation, size_t count, std::function<void()> function);
+
+    /*! Runs the function the given number of times with the number of the repetition as the argument.
+     *  Records the total time and the percentiles and the maximum of the latencies of single runs. */
+    void measureLatency(const QString & operation, size_t repetitions, std::function<void(size_t)> function);
+
+    //! Records a result measured by the caller. Extra fields are added to the result as they are.
+    void addResult(const QString & operation, size_t count, qint64 nanoseconds, const QJsonObject & extra = {});
+
+    QJsonObject toJson() const;
+
+    //! Writes the results to the given file, or to stdout if the file name is empty.
+    //! \return False if the file couldn't be written.
+    bool write(const QString & fileName) const;
+
+private:
+    QString m_name;
+
+    QJsonObject m_parameters;
+
+    QJsonArray m_results;
+};
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,262 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include "argengine.hpp"
+#include "edge_base.hpp"
+#include "graph.hpp"
+#include "mind_map_data.hpp"
+#include "node_base.hpp"
+#include "simple_logger.hpp"
+
+#include <QApplication>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+using juzzlin::Argengine;
+using juzzlin::L;
+
+namespace {
+
+//! Restoring a snapshot creates graphics items for every node, so it's measured only up to this size
+const size_t MAX_RESTORE_NODES = 100000;
+
+//! Number of the nodes with the most edges that are deleted
+const size_t HUB_COUNT = 100;
+
+enum class Topology
+{
+    DeepTree,
+    WideStar,
+    RandomDag
+};
+
+QString topologyName(Topology topology)
+{
+    switch (topology) {
+    case Topology::DeepTree:
+        return "deepTree";
+    case Topology::WideStar:
+        return "wideStar";
+    case Topology::RandomDag:
+        return "randomDag";
+    }
+
+    return "";
+}
+
+//! Edges as (source, target) positions in the node list
+using EdgeList = std::vector<std::pair<size_t, size_t>>;
+
+EdgeList generateEdges(Topology topology, size_t nodeCount, std::mt19937 & engine)
+{
+    EdgeList edges;
+    switch (topology) {
+    case Topology::DeepTree:
+        // Every node has two children, one of which continues the branch, so the depth is n / 2
+        for (size_t i = 1; i < nodeCount; i++) {
+            edges.push_back({ (i - 1) / 2 * 2, i });
+        }
+        break;
+    case Topology::WideStar:
+        for (size_t i = 1; i < nodeCount; i++) {
+            edges.push_back({ 0, i });
+        }
+        break;
+    case Topology::RandomDag:
+        // Every node gets edges from up to three distinct earlier nodes
+        for (size_t i = 1; i < nodeCount; i++) {
+            std::uniform_int_distribution<size_t> distribution(0, i - 1);
+            std::set<size_t> sources;
+            while (sources.size() < std::min<size_t>(i, 3)) {
+                sources.insert(distribution(engine));
+            }
+            for (auto && source : sources) {
+                edges.push_back({ source, i });
+            }
+        }
+        break;
+    }
+
+    return edges;
+}
+
+//! \return A value that depends on the results of the queries, so that they can't be optimized away.
+size_t benchmarkGraph(Benchmark & benchmark, Topology topology, size_t nodeCount, unsigned int seed)
+{
+    std::mt19937 engine(seed);
+    const auto edgeList = generateEdges(topology, nodeCount, engine);
+
+    benchmark.setParameter("topology", topologyName(topology));
+    benchmark.setParameter("nodes", static_cast<qint64>(nodeCount));
+    benchmark.setParameter("edges", static_cast<qint64>(edgeList.size()));
+
+    // The nodes and edges are created beforehand and kept alive, so that only the graph operations are measured
+    std::vector<NodeBasePtr> nodes;
+    nodes.reserve(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        nodes.push_back(std::make_shared<NodeBase>());
+    }
+
+    std::vector<EdgeBasePtr> edges;
+    edges.reserve(edgeList.size());
+    for (auto && edge : edgeList) {
+        edges.push_back(std::make_shared<EdgeBase>(*nodes.at(edge.first), *nodes.at(edge.second)));
+    }
+
+    MindMapData data;
+    auto && graph = data.graph();
+
+    benchmark.measure("addNode", nodes.size(), [&] {
+        for (auto && node : nodes) {
+            graph.addNode(node);
+        }
+    });
+
+    benchmark.measure("addEdge", edges.size(), [&] {
+        for (auto && edge : edges) {
+            graph.addEdge(edge);
+        }
+    });
+
+    size_t checksum = 0;
+    benchmark.measure("getNodeByIndex", nodes.size(), [&] {
+        for (auto && node : nodes) {
+            checksum += graph.getNode(node->index()) != nullptr;
+        }
+    });
+
+    benchmark.measure("getNodeById", nodes.size(), [&] {
+        for (auto && node : nodes) {
+            checksum += graph.getNode(node->id()) != nullptr;
+        }
+    });
+
+    benchmark.measure("edgesFromAndTo", nodes.size(), [&] {
+        for (auto && node : nodes) {
+            checksum += graph.edgesFrom(node->id()).size() + graph.edgesTo(node->id()).size();
+        }
+    });
+
+    benchmark.measure("getEdgesFromAndToNode", nodes.size(), [&] {
+        for (auto && node : nodes) {
+            checksum += graph.getEdgesFromNode(node).size() + graph.getEdgesToNode(node).size();
+        }
+    });
+
+    benchmark.measure("areDirectlyConnected", edges.size(), [&] {
+        for (auto && edge : edges) {
+            checksum += graph.areDirectlyConnected(edge->sourceNodeBase().id(), edge->targetNodeBase().id());
+        }
+    });
+
+    benchmark.measure("snapshot", nodes.size(), [&] {
+        checksum += data.snapshot().graph.nodes.size();
+    });
+
+    nodes.front()->setText("changed");
+    benchmark.measure("snapshotAfterChange", 1, [&] {
+        checksum += data.snapshot().graph.nodes.size();
+    });
+
+    // MindMapData can't be copied, so a copy is made by restoring a snapshot
+    if (nodeCount <= MAX_RESTORE_NODES) {
+        const auto snapshot = data.snapshot();
+        std::unique_ptr<MindMapData> copy;
+        benchmark.measure("restoreSnapshot", nodes.size(), [&] {
+            copy.reset(new MindMapData(snapshot));
+        });
+        checksum += copy->graph().numNodes();
+    }
+
+    auto hubs = nodes;
+    const auto hubCount = std::min(HUB_COUNT, hubs.size());
+    std::partial_sort(hubs.begin(), hubs.begin() + static_cast<long>(hubCount), hubs.end(), [&](const NodeBasePtr & node0, const NodeBasePtr & node1) {
+        return graph.inDegree(node0->id()) + graph.outDegree(node0->id()) > graph.inDegree(node1->id()) + graph.outDegree(node1->id());
+    });
+    benchmark.measure("deleteHubNode", hubCount, [&] {
+        for (size_t i = 0; i < hubCount; i++) {
+            graph.deleteNode(hubs.at(i)->index());
+        }
+    });
+
+    benchmark.measure("clear", graph.numNodes(), [&] {
+        graph.clear();
+    });
+
+    return checksum;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    // The results go to stdout, so the progress goes to stderr
+    L::setStream(L::Level::Info, std::cerr);
+
+    // Nodes are graphics items even though nothing is shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    size_t maxNodes = 1000000;
+    unsigned int seed = 1;
+    QString output;
+
+    Argengine ae(argc, argv);
+
+    ae.addOption(
+      { "--max-nodes" }, [&maxNodes](std::string value) {
+          maxNodes = std::stoul(value);
+      },
+      false, "Size of the biggest graphs. The sizes go up from 1000 by a factor of 10. Default: 1000000.");
+
+    ae.addOption(
+      { "--seed" }, [&seed](std::string value) {
+          seed = static_cast<unsigned int>(std::stoul(value));
+      },
+      false, "Seed of the random graphs. Default: 1.");
+
+    ae.addOption(
+      { "-o", "--output" }, [&output](std::string value) {
+          output = value.c_str();
+      },
+      false, "Write the results to the given file instead of stdout.");
+
+    ae.setHelpText(std::string("\nUsage: ") + argv[0] + " [OPTIONS]\n\nMeasures Graph operations on synthetic graphs and prints the results as JSON.");
+
+    ae.parse();
+
+    Benchmark benchmark("graph_bench");
+    benchmark.setParameter("seed", seed);
+
+    size_t checksum = 0;
+    for (size_t nodeCount = 1000; nodeCount <= maxNodes; nodeCount *= 10) {
+        for (auto && topology : { Topology::DeepTree, Topology::WideStar, Topology::RandomDag }) {
+            checksum += benchmarkGraph(benchmark, topology, nodeCount, seed);
+        }
+    }
+    L().debug() << "Checksum: " << checksum;
+
+    return benchmark.write(output) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,255 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include "argengine.hpp"
+#include "constants.hpp"
+#include "editor_data.hpp"
+#include "editor_scene.hpp"
+#include "editor_view.hpp"
+#include "hash_seed.hpp"
+#include "main_window.hpp"
+#include "mediator.hpp"
+#include "mind_map_data.hpp"
+#include "mind_map_generator.hpp"
+#include "node.hpp"
+#include "simple_logger.hpp"
+#include "writer.hpp"
+
+#include <QApplication>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+
+using juzzlin::Argengine;
+using juzzlin::L;
+
+namespace {
+
+//! Size of the rectangle of a rubber band selection in scene coordinates
+const double SELECTION_SIZE = 1000;
+
+//! Maximum width and height of exported images
+const int MAX_EXPORT_SIZE = 4096;
+
+//! Runs the events caused by an operation, e.g. the repaints, so that they are included in its latency.
+void processEvents()
+{
+    QApplication::processEvents();
+}
+
+NodePtr randomNode(EditorData & editorData, std::mt19937 & engine)
+{
+    auto && nodes = editorData.mindMapData()->graph().getNodes();
+    std::uniform_int_distribution<size_t> distribution(0, nodes.size() - 1);
+    return std::dynamic_pointer_cast<Node>(nodes.at(distribution(engine)));
+}
+
+QRectF selectionRectangle(const Node & node)
+{
+    return { node.location() - QPointF(SELECTION_SIZE, SELECTION_SIZE) / 2, QSizeF(SELECTION_SIZE, SELECTION_SIZE) };
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    // The results go to stdout, so the progress goes to stderr
+    L::setStream(L::Level::Info, std::cerr);
+
+    HashSeed::init();
+
+    // Keep the settings and the recent files of the application intact
+    QApplication::setOrganizationName(Constants::Application::QSETTINGS_COMPANY_NAME);
+    QApplication::setApplicationName("scene_bench");
+
+    // The whole editor is run, but nothing needs to be shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    size_t nodeCount = 10000;
+    size_t repetitions = 100;
+    unsigned int seed = 1;
+    QString output;
+
+    Argengine ae(argc, argv);
+
+    ae.addOption(
+      { "--nodes" }, [&nodeCount](std::string value) {
+          nodeCount = std::stoul(value);
+      },
+      false, "Number of nodes in the mind map. Default: 10000.");
+
+    ae.addOption(
+      { "--repetitions" }, [&repetitions](std::string value) {
+          repetitions = std::stoul(value);
+      },
+      false, "Number of repetitions of each operation. Opening and exporting are repeated a tenth of that. Default: 100.");
+
+    ae.addOption(
+      { "--seed" }, [&seed](std::string value) {
+          seed = static_cast<unsigned int>(std::stoul(value));
+      },
+      false, "Seed of the random map and the random operations. Default: 1.");
+
+    ae.addOption(
+      { "-o", "--output" }, [&output](std::string value) {
+          output = value.c_str();
+      },
+      false, "Write the results to the given file instead of stdout.");
+
+    ae.setHelpText(std::string("\nUsage: ") + argv[0] + " [OPTIONS]\n\nMeasures latencies of editing a synthetic mind map in the editor and prints the percentiles as JSON.");
+
+    ae.parse();
+
+    repetitions = std::max<size_t>(repetitions, 1);
+    const auto slowRepetitions = std::max<size_t>(repetitions / 10, 1);
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        L().error() << "Cannot create a temporary directory";
+        return EXIT_FAILURE;
+    }
+
+    // A random tree with some cross edges and labels, as a map would look like
+    MindMapGenerator::Parameters workload;
+    workload.nodeCount = std::max<size_t>(nodeCount, 1);
+    workload.crossEdgeCount = workload.nodeCount / 10;
+    workload.seed = seed;
+    const auto data = MindMapGenerator(workload).generate(dir.path());
+    const auto fileName = dir.path() + "/benchmark" + Constants::Application::FILE_EXTENSION;
+    if (!data || !Writer::writeToFile(*data, fileName)) {
+        L().error() << "Cannot write '" << fileName.toStdString() << "'";
+        return EXIT_FAILURE;
+    }
+
+    // Set up the editor as Application does. The view is owned by the main window and the rest
+    // are declared in the order of the members of Application, so they are also destroyed in that order.
+    std::unique_ptr<MainWindow> mainWindow(new MainWindow);
+    const auto mediator = std::make_shared<Mediator>(*mainWindow);
+    const auto editorData = std::make_shared<EditorData>();
+    const auto editorScene = std::make_shared<EditorScene>();
+    const auto editorView = new EditorView(*mediator);
+    mainWindow->setMediator(mediator);
+    mediator->setEditorData(editorData);
+    mediator->setEditorScene(editorScene);
+    mediator->setEditorView(*editorView);
+    mainWindow->initialize();
+    mediator->initializeView();
+    mainWindow->show();
+    processEvents();
+
+    Benchmark benchmark("scene_bench");
+    benchmark.setParameter("nodes", static_cast<qint64>(workload.nodeCount));
+    benchmark.setParameter("edges", static_cast<qint64>(workload.nodeCount - 1 + workload.crossEdgeCount));
+    benchmark.setParameter("repetitions", static_cast<qint64>(repetitions));
+    benchmark.setParameter("seed", seed);
+    benchmark.setParameter("platform", QApplication::platformName());
+
+    auto opened = true;
+    benchmark.measureLatency("openMindMap", slowRepetitions, [&](size_t) {
+        opened = mediator->openMindMap(fileName) && opened;
+        mainWindow->updateUndoAndRedo();
+        processEvents();
+    });
+    if (!opened) {
+        L().error() << "Cannot open '" << fileName.toStdString() << "'";
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<int> offset(-workload.spread, workload.spread);
+
+    benchmark.measureLatency("createAndAddNode", repetitions, [&](size_t) {
+        const auto parent = randomNode(*editorData, engine);
+        mediator->saveUndoPoint();
+        mediator->createAndAddNode(parent->index(), parent->location() + QPointF(offset(engine), offset(engine)));
+        processEvents();
+    });
+
+    benchmark.measureLatency("undo", repetitions, [&](size_t) {
+        mediator->undo();
+        mainWindow->updateUndoAndRedo();
+        mediator->setupMindMapAfterUndoOrRedo();
+        processEvents();
+    });
+
+    benchmark.measureLatency("redo", repetitions, [&](size_t) {
+        mediator->redo();
+        mainWindow->updateUndoAndRedo();
+        mediator->setupMindMapAfterUndoOrRedo();
+        processEvents();
+    });
+
+    benchmark.measureLatency("rubberBandSelect", repetitions, [&](size_t) {
+        mediator->setRectagleSelection(selectionRectangle(*randomNode(*editorData, engine)));
+        processEvents();
+    });
+
+    // Drag the group selected around a node by that node as a single undoable edit
+    const auto reference = randomNode(*editorData, engine);
+    mediator->setRectagleSelection(selectionRectangle(*reference));
+    benchmark.setParameter("selectionGroupSize", static_cast<qint64>(mediator->selectionGroupSize()));
+    mediator->beginUndoTransaction();
+    benchmark.measureLatency("dragSelectionGroup", repetitions, [&](size_t) {
+        mediator->moveSelectionGroup(*reference, reference->location() + QPointF(offset(engine), offset(engine)) / 10);
+        processEvents();
+    });
+    mediator->endUndoTransaction();
+    benchmark.removeParameter("selectionGroupSize");
+    mediator->clearSelectionGroup();
+
+    // The rectangle is calculated in the background, so wait until the view has been zoomed to it
+    auto zoomedToFit = false;
+    const auto zoomConnection = QObject::connect(mediator.get(), &Mediator::zoomedToFit, [&zoomedToFit] {
+        zoomedToFit = true;
+    });
+    benchmark.measureLatency("zoomToFit", repetitions, [&](size_t) {
+        zoomedToFit = false;
+        emit mainWindow->zoomToFitTriggered();
+        while (!zoomedToFit) {
+            QApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        processEvents();
+    });
+    QObject::disconnect(zoomConnection);
+
+    const auto exportFileName = dir.path() + "/benchmark.png";
+    auto exported = true;
+    const auto connection = QObject::connect(mediator.get(), &Mediator::exportFinished, [&exported](bool success) {
+        exported = exported && success;
+    });
+    benchmark.measureLatency("exportToPNG", slowRepetitions, [&](size_t) {
+        auto size = mediator->zoomForExport();
+        if (size.width() > MAX_EXPORT_SIZE || size.height() > MAX_EXPORT_SIZE) {
+            size.scale(MAX_EXPORT_SIZE, MAX_EXPORT_SIZE, Qt::KeepAspectRatio);
+        }
+        mediator->exportToPNG(exportFileName, size, false);
+        processEvents();
+    });
+    QObject::disconnect(connection);
+    if (!exported) {
+        L().error() << "Cannot export '" << exportFileName.toStdString() << "'";
+    }
+
+    return benchmark.write(output) && exported ? EXIT_SUCCESS : EXIT_FAILURE;
+}
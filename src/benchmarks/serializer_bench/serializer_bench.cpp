@@ -0,0 +1,245 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchmark.hpp"
+
+#include "argengine.hpp"
+#include "constants.hpp"
+#include "edge.hpp"
+#include "file_exception.hpp"
+#include "mind_map_data.hpp"
+#include "mind_map_generator.hpp"
+#include "node.hpp"
+#include "reader.hpp"
+#include "simple_logger.hpp"
+#include "writer.hpp"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+
+using juzzlin::Argengine;
+using juzzlin::L;
+
+namespace {
+
+//! \return Sizes of the images used by the nodes by image id.
+std::map<size_t, QSize> imageSizes(MindMapData & data)
+{
+    std::map<size_t, QSize> sizes;
+    for (auto && node : data.graph().getNodes()) {
+        if (node->imageRef()) {
+            const auto image = data.imageManager().getImage(node->imageRef());
+            sizes[node->imageRef()] = image.second ? image.first.image().size() : QSize();
+        }
+    }
+    return sizes;
+}
+
+//! \return Description of the first difference in what the file format stores, or an empty string if none.
+QString difference(MindMapData & expected, const std::map<size_t, QSize> & expectedImageSizes, MindMapData & actual)
+{
+    if (expected.backgroundColor() != actual.backgroundColor() || expected.edgeColor() != actual.edgeColor()
+        || expected.edgeWidth() != actual.edgeWidth() || expected.textSize() != actual.textSize()
+        || expected.cornerRadius() != actual.cornerRadius()) {
+        return "Different styles";
+    }
+
+    auto && expectedGraph = expected.graph();
+    auto && actualGraph = actual.graph();
+    if (expectedGraph.numNodes() != actualGraph.numNodes() || expectedGraph.getEdges().size() != actualGraph.getEdges().size()) {
+        return "Different number of nodes or edges";
+    }
+
+    for (auto && expectedNode : expectedGraph.getNodes()) {
+        const auto actualNode = actualGraph.getNode(actualGraph.getNodeId(expectedNode->index()));
+        if (!actualNode) {
+            return QString("Node %1 missing").arg(expectedNode->index());
+        }
+        if (expectedNode->text() != actualNode->text() || expectedNode->color() != actualNode->color()
+            || expectedNode->textColor() != actualNode->textColor() || expectedNode->location() != actualNode->location()
+            || expectedNode->imageRef() != actualNode->imageRef()) {
+            return QString("Node %1 differs").arg(expectedNode->index());
+        }
+    }
+
+    for (auto && expectedEdge : expectedGraph.getEdges()) {
+        const auto sourceIndex = expectedEdge->sourceNodeBase().index();
+        const auto targetIndex = expectedEdge->targetNodeBase().index();
+        const auto actualEdge = actualGraph.getEdge(actualGraph.getNodeId(sourceIndex), actualGraph.getNodeId(targetIndex));
+        if (!actualEdge) {
+            return QString("Edge %1 -> %2 missing").arg(sourceIndex).arg(targetIndex);
+        }
+        if (expectedEdge->text() != actualEdge->text() || expectedEdge->arrowMode() != actualEdge->arrowMode()
+            || expectedEdge->reversed() != actualEdge->reversed()) {
+            return QString("Edge %1 -> %2 differs").arg(sourceIndex).arg(targetIndex);
+        }
+    }
+
+    // The image manager is shared, so the loaded images have replaced the original ones
+    if (imageSizes(actual) != expectedImageSizes) {
+        return "Different images";
+    }
+
+    return "";
+}
+
+//! \return True if the round-trip was lossless.
+bool benchmarkWorkload(Benchmark & benchmark, const MindMapGenerator::Parameters & workload, const QString & format, const QString & fileExtension)
+{
+    benchmark.setParameter("format", format);
+    benchmark.setParameter("nodes", static_cast<qint64>(workload.nodeCount));
+    benchmark.setParameter("edges", static_cast<qint64>(workload.nodeCount - 1 + workload.crossEdgeCount));
+    benchmark.setParameter("textLength", workload.textLength);
+    benchmark.setParameter("images", static_cast<qint64>(workload.imageCount));
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        L().error() << "Cannot create a temporary directory";
+        return false;
+    }
+    const auto fileName = dir.path() + "/benchmark" + fileExtension;
+
+    MindMapDataPtr data;
+    benchmark.measure("generate", workload.nodeCount, [&] {
+        data = MindMapGenerator(workload).generate(dir.path());
+    });
+    if (!data) {
+        return false;
+    }
+    const auto expectedImageSizes = imageSizes(*data);
+
+    auto written = false;
+    benchmark.measure("save", workload.nodeCount, [&] {
+        written = Writer::writeToFile(*data, fileName);
+    });
+    if (!written) {
+        L().error() << "Cannot write '" << fileName.toStdString() << "'";
+        return false;
+    }
+    benchmark.setParameter("fileBytes", QFileInfo(fileName).size());
+
+    MindMapDataPtr loaded;
+    try {
+        benchmark.measure("load", workload.nodeCount, [&] {
+            loaded = Reader::readFromFile(fileName);
+        });
+    } catch (const FileException & e) {
+        L().error() << e.message().toStdString();
+        return false;
+    }
+
+    const auto error = difference(*data, expectedImageSizes, *loaded);
+    benchmark.addResult("roundTrip", workload.nodeCount, 0, { { "lossless", error.isEmpty() } });
+    benchmark.removeParameter("fileBytes");
+    if (!error.isEmpty()) {
+        L().error() << "Round-trip of " << workload.nodeCount << " nodes failed: " << error.toStdString();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    // The results go to stdout, so the progress goes to stderr
+    L::setStream(L::Level::Info, std::cerr);
+
+    // Nodes are graphics items even though nothing is shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    size_t maxNodes = 100000;
+    size_t edgesPerNode = 2;
+    int textLength = 200;
+    size_t imageCount = 10;
+    unsigned int seed = 1;
+    QString output;
+
+    Argengine ae(argc, argv);
+
+    ae.addOption(
+      { "--max-nodes" }, [&maxNodes](std::string value) {
+          maxNodes = std::stoul(value);
+      },
+      false, "Size of the biggest map. The sizes go up from 1000 by a factor of 10. Default: 100000.");
+
+    ae.addOption(
+      { "--edges-per-node" }, [&edgesPerNode](std::string value) {
+          edgesPerNode = std::stoul(value);
+      },
+      false, "Number of edges per node. Default: 2.");
+
+    ae.addOption(
+      { "--text-length" }, [&textLength](std::string value) {
+          textLength = std::stoi(value);
+      },
+      false, "Length of node texts in characters. Edge texts are a tenth of that. Default: 200.");
+
+    ae.addOption(
+      { "--images" }, [&imageCount](std::string value) {
+          imageCount = std::stoul(value);
+      },
+      false, "Number of embedded images. Default: 10.");
+
+    ae.addOption(
+      { "--seed" }, [&seed](std::string value) {
+          seed = static_cast<unsigned int>(std::stoul(value));
+      },
+      false, "Seed of the random maps. Default: 1.");
+
+    ae.addOption(
+      { "-o", "--output" }, [&output](std::string value) {
+          output = value.c_str();
+      },
+      false, "Write the results to the given file instead of stdout.");
+
+    ae.setHelpText(std::string("\nUsage: ") + argv[0] + " [OPTIONS]\n\nMeasures saving and loading of synthetic mind maps, verifies the round-trips and prints the results as JSON.");
+
+    ae.parse();
+
+    Benchmark benchmark("serializer_bench");
+    benchmark.setParameter("seed", seed);
+
+    auto lossless = true;
+    for (size_t nodeCount = 1000; nodeCount <= maxNodes; nodeCount *= 10) {
+        // A random tree with random cross edges and everything that the file format stores
+        MindMapGenerator::Parameters workload;
+        workload.nodeCount = nodeCount;
+        workload.branchingFactor = 0;
+        workload.crossEdgeCount = nodeCount * std::max<size_t>(edgesPerNode, 1) - (nodeCount - 1);
+        workload.textLength = textLength;
+        workload.textDistribution = MindMapGenerator::TextDistribution::Fixed;
+        workload.edgeLabelRatio = 1;
+        workload.randomColors = true;
+        workload.imageCount = imageCount;
+        workload.seed = seed;
+        lossless = benchmarkWorkload(benchmark, workload, "xml", Constants::Application::FILE_EXTENSION) && lossless;
+        lossless = benchmarkWorkload(benchmark, workload, "container", Constants::Application::CONTAINER_FILE_EXTENSION) && lossless;
+        lossless = benchmarkWorkload(benchmark, workload, "binary", Constants::Application::BINARY_FILE_EXTENSION) && lossless;
+    }
+
+    return benchmark.write(output) && lossless ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,516 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "binary_serializer.hpp"
+
+#include "constants.hpp"
+#include "graph.hpp"
+#include "node.hpp"
+#include "simple_logger.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using juzzlin::L;
+using std::make_shared;
+
+namespace BinarySerializer {
+
+namespace {
+
+//! "HMB1" in the file
+const quint32 MAGIC = 0x31424d48;
+
+const quint16 FORMAT_VERSION = 1;
+
+const qint64 HEADER_SIZE = 104;
+
+//! x, y, width, height, image ref, index, text, color, text color
+const qint64 NODE_RECORD_SIZE = 4 * 8 + 8 + 4 * 4;
+
+//! Source index, target index, text, arrow mode, reversed
+const qint64 EDGE_RECORD_SIZE = 3 * 4 + 2 * 2;
+
+//! Id, path, reserved, blob offset, blob size
+const qint64 IMAGE_RECORD_SIZE = 8 + 2 * 4 + 2 * 8;
+
+const qint64 ALIGNMENT = 8;
+
+//! Output is written to the device in blocks of about this size
+const int BLOCK_SIZE = 64 * 1024;
+
+qint64 aligned(qint64 offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+class Corrupted : public std::runtime_error
+{
+public:
+    explicit Corrupted(const std::string & what)
+      : std::runtime_error(what)
+    {
+    }
+};
+
+void check(bool condition, const std::string & what)
+{
+    if (!condition) {
+        throw Corrupted(what);
+    }
+}
+
+//! \return True if the range is within the given size.
+bool contains(quint64 size, quint64 offset, quint64 length)
+{
+    return offset <= size && length <= size - offset;
+}
+
+//! Buffers little-endian values and writes them to the device in blocks.
+class Output
+{
+public:
+    explicit Output(QIODevice & device)
+      : m_device(device)
+    {
+        m_buffer.reserve(BLOCK_SIZE + BLOCK_SIZE / 2);
+    }
+
+    template<typename T>
+    void put(T value)
+    {
+        const T littleEndian = qToLittleEndian(value);
+        putBytes(reinterpret_cast<const char *>(&littleEndian), sizeof(T));
+    }
+
+    void putDouble(double value)
+    {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(bits);
+    }
+
+    void putBytes(const char * data, qint64 size)
+    {
+        m_buffer.append(data, static_cast<int>(size));
+        if (m_buffer.size() >= BLOCK_SIZE) {
+            flush();
+        }
+    }
+
+    void padTo(qint64 offset)
+    {
+        while (position() < offset) {
+            putBytes("", 1);
+        }
+    }
+
+    qint64 position() const
+    {
+        return m_written + m_buffer.size();
+    }
+
+    //! \return False if any write failed.
+    bool flush()
+    {
+        if (!m_buffer.isEmpty()) {
+            m_isValid = m_device.write(m_buffer) == m_buffer.size() && m_isValid;
+            m_written += m_buffer.size();
+            m_buffer.clear();
+        }
+        return m_isValid;
+    }
+
+private:
+    QIODevice & m_device;
+
+    QByteArray m_buffer;
+
+    qint64 m_written = 0;
+
+    bool m_isValid = true;
+};
+
+//! Reads little-endian values from memory. The caller checks the bounds.
+class Input
+{
+public:
+    explicit Input(const uchar * data)
+      : m_data(data)
+    {
+    }
+
+    template<typename T>
+    T get()
+    {
+        const auto value = qFromLittleEndian<T>(m_data);
+        m_data += sizeof(T);
+        return value;
+    }
+
+    double getDouble()
+    {
+        const auto bits = get<quint64>();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+private:
+    const uchar * m_data;
+};
+
+class StringTable
+{
+public:
+    StringTable(const uchar * data, quint64 size, quint64 tableOffset, quint64 dataOffset, quint32 count)
+      : m_offsets(data + tableOffset)
+      , m_data(data + dataOffset)
+      , m_count(count)
+    {
+        // The last offset is the size of the string data
+        check(contains(size, tableOffset, (quint64(count) + 1) * 8), "String table out of bounds");
+        m_dataSize = qFromLittleEndian<quint64>(m_offsets + quint64(count) * 8);
+        check(contains(size, dataOffset, m_dataSize), "String data out of bounds");
+    }
+
+    QString at(quint32 index) const
+    {
+        check(index < m_count, "Invalid string index");
+        const auto begin = qFromLittleEndian<quint64>(m_offsets + quint64(index) * 8);
+        const auto end = qFromLittleEndian<quint64>(m_offsets + quint64(index + 1) * 8);
+        check(begin <= end && end <= m_dataSize && end - begin <= quint64(std::numeric_limits<int>::max()), "Invalid string");
+        return QString::fromUtf8(reinterpret_cast<const char *>(m_data + begin), static_cast<int>(end - begin));
+    }
+
+private:
+    const uchar * m_offsets;
+
+    const uchar * m_data;
+
+    quint32 m_count;
+
+    quint64 m_dataSize = 0;
+};
+
+//! \return Contents of the image file, or an empty array in unit tests.
+QByteArray readImageFile(const std::string & path)
+{
+#ifndef HEIMER_UNIT_TEST
+    QFile in(path.c_str());
+    if (!in.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Cannot open file: '" + path + "'");
+    }
+    return in.readAll();
+#else
+    Q_UNUSED(path)
+    return {};
+#endif
+}
+
+// The purpose of this #ifdef is to build GUILESS unit tests so that QTEST_GUILESS_MAIN can be used
+#ifdef HEIMER_UNIT_TEST
+EdgeBasePtr createEdge(MindMapData & data, int index0, int index1)
+#else
+EdgePtr createEdge(MindMapData & data, int index0, int index1)
+#endif
+{
+#ifdef HEIMER_UNIT_TEST
+    auto node0 = data.graph().getNode(index0);
+    auto node1 = data.graph().getNode(index1);
+#else
+    auto node0 = std::dynamic_pointer_cast<Node>(data.graph().getNode(index0));
+    auto node1 = std::dynamic_pointer_cast<Node>(data.graph().getNode(index1));
+#endif
+    if (!node0 || !node1) {
+        L().warning() << "Skipping edge " << index0 << " -> " << index1 << " with a missing node";
+        return {};
+    }
+
+#ifdef HEIMER_UNIT_TEST
+    return make_shared<EdgeBase>(*node0, *node1);
+#else
+    // Init a new edge. QGraphicsScene will take the ownership eventually.
+    return make_shared<Edge>(*node0, *node1);
+#endif
+}
+
+} // namespace
+
+bool isBinary(const QByteArray & head)
+{
+    return head.size() >= MAGIC_SIZE && qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(head.constData())) == MAGIC;
+}
+
+MindMapDataPtr fromBinary(const uchar * data, qint64 size)
+{
+    try {
+        check(size >= HEADER_SIZE && isBinary(QByteArray::fromRawData(reinterpret_cast<const char *>(data), MAGIC_SIZE)), "Not a binary mind map");
+
+        Input header(data + MAGIC_SIZE);
+        const auto formatVersion = header.get<quint16>();
+        check(formatVersion == FORMAT_VERSION, "Unsupported format version " + std::to_string(formatVersion));
+        check(header.get<quint16>() >= HEADER_SIZE, "Invalid header size");
+        const auto nodeCount = header.get<quint32>();
+        const auto edgeCount = header.get<quint32>();
+        const auto stringCount = header.get<quint32>();
+        const auto imageCount = header.get<quint32>();
+        const auto nodeTableOffset = header.get<quint64>();
+        const auto edgeTableOffset = header.get<quint64>();
+        const auto stringTableOffset = header.get<quint64>();
+        const auto stringDataOffset = header.get<quint64>();
+        const auto imageTableOffset = header.get<quint64>();
+        const auto blobOffset = header.get<quint64>();
+
+        const auto fileSize = static_cast<quint64>(size);
+        check(contains(fileSize, nodeTableOffset, nodeCount * quint64(NODE_RECORD_SIZE)), "Node table out of bounds");
+        check(contains(fileSize, edgeTableOffset, edgeCount * quint64(EDGE_RECORD_SIZE)), "Edge table out of bounds");
+        check(contains(fileSize, imageTableOffset, imageCount * quint64(IMAGE_RECORD_SIZE)), "Image table out of bounds");
+        check(contains(fileSize, blobOffset, 0), "Blobs out of bounds");
+        const StringTable strings(data, fileSize, stringTableOffset, stringDataOffset, stringCount);
+
+        auto mindMapData = make_shared<MindMapData>();
+        mindMapData->setBackgroundColor(QColor::fromRgba(header.get<quint32>()));
+        mindMapData->setEdgeColor(QColor::fromRgba(header.get<quint32>()));
+        mindMapData->setEdgeWidth(header.getDouble());
+        mindMapData->setTextSize(header.get<qint32>());
+        mindMapData->setCornerRadius(header.get<qint32>());
+        mindMapData->setVersion(strings.at(header.get<quint32>()));
+
+        // Build the graph in bulk: nodes are indexed once before edges are resolved against them
+        auto && graph = mindMapData->graph();
+        graph.reserve(nodeCount, edgeCount);
+        for (quint32 i = 0; i < nodeCount; i++) {
+            Input record(data + nodeTableOffset + i * quint64(NODE_RECORD_SIZE));
+#ifdef HEIMER_UNIT_TEST
+            auto node = make_shared<NodeBase>();
+#else
+            // Init a new node. QGraphicsScene will take the ownership eventually.
+            auto node = make_shared<Node>();
+#endif
+            const auto x = record.getDouble();
+            const auto y = record.getDouble();
+            node->setLocation({ x, y });
+            const auto width = record.getDouble();
+            const auto height = record.getDouble();
+            node->setSize({ width, height });
+            node->setImageRef(static_cast<size_t>(record.get<quint64>()));
+            node->setIndex(record.get<qint32>());
+            node->setText(strings.at(record.get<quint32>()));
+            node->setColor(QColor::fromRgba(record.get<quint32>()));
+            node->setTextColor(QColor::fromRgba(record.get<quint32>()));
+            graph.appendNode(node);
+        }
+
+        size_t rejected = graph.finalize();
+
+        for (quint32 i = 0; i < edgeCount; i++) {
+            Input record(data + edgeTableOffset + i * quint64(EDGE_RECORD_SIZE));
+            const auto index0 = record.get<qint32>();
+            const auto index1 = record.get<qint32>();
+            const auto text = strings.at(record.get<quint32>());
+            const auto arrowMode = record.get<quint16>();
+            const auto reversed = record.get<quint16>();
+            if (const auto edge = createEdge(*mindMapData, index0, index1)) {
+                edge->setArrowMode(static_cast<EdgeBase::ArrowMode>(arrowMode));
+                edge->setReversed(reversed);
+                edge->setText(text);
+                graph.appendEdge(edge);
+            }
+        }
+
+        rejected += graph.finalize();
+        if (rejected) {
+            L().warning() << "Rejected " << rejected << " invalid nodes or edges";
+        }
+
+        for (quint32 i = 0; i < imageCount; i++) {
+            Input record(data + imageTableOffset + i * quint64(IMAGE_RECORD_SIZE));
+            const auto id = static_cast<size_t>(record.get<quint64>());
+            const auto path = strings.at(record.get<quint32>()).toStdString();
+            record.get<quint32>();
+            const auto offset = record.get<quint64>();
+            const auto length = record.get<quint64>();
+            check(contains(fileSize - blobOffset, offset, length) && length <= quint64(std::numeric_limits<int>::max()), "Image out of bounds");
+            // The image is decoded only when a node shows it
+            Image image(QByteArray(reinterpret_cast<const char *>(data + blobOffset + offset), static_cast<int>(length)), path);
+            image.setId(id);
+            mindMapData->imageManager().setImage(image);
+        }
+
+        return mindMapData;
+    } catch (const Corrupted & e) {
+        L().error() << "Invalid binary mind map: " << e.what();
+        return {};
+    }
+}
+
+bool toBinary(MindMapData & mindMapData, QIODevice & device)
+{
+    auto && graph = mindMapData.graph();
+    auto && nodes = graph.getNodes();
+
+    // Edges in the same order as in the XML format
+    std::vector<EdgeBase *> edges;
+    edges.reserve(graph.getEdges().size());
+    for (auto && node : nodes) {
+        for (auto && edge : graph.edgesFrom(node->id())) {
+            edges.push_back(edge.get());
+        }
+    }
+
+    std::map<size_t, Image> images;
+    for (auto && node : nodes) {
+        if (node->imageRef() && !images.count(node->imageRef())) {
+            Image image;
+            bool exists;
+            std::tie(image, exists) = mindMapData.imageManager().getImage(node->imageRef());
+            if (exists) {
+                images[node->imageRef()] = image;
+            }
+        }
+    }
+
+    // The offsets of the strings are written before the strings, so the strings are encoded up front.
+    // The version comes first, then the texts of the nodes and the edges and the paths of the images.
+    std::vector<QByteArray> strings;
+    strings.reserve(1 + nodes.size() + edges.size() + images.size());
+    strings.push_back(Constants::Application::APPLICATION_VERSION);
+    for (auto && node : nodes) {
+        strings.push_back(node->text().toUtf8());
+    }
+    for (auto && edge : edges) {
+        strings.push_back(edge->text().toUtf8());
+    }
+    for (auto && image : images) {
+        strings.push_back(QByteArray::fromStdString(image.second.path()));
+    }
+    quint64 stringDataSize = 0;
+    for (auto && string : strings) {
+        stringDataSize += static_cast<quint64>(string.size());
+    }
+
+    const auto nodeTableOffset = HEADER_SIZE;
+    const auto edgeTableOffset = aligned(nodeTableOffset + static_cast<qint64>(nodes.size()) * NODE_RECORD_SIZE);
+    const auto stringTableOffset = aligned(edgeTableOffset + static_cast<qint64>(edges.size()) * EDGE_RECORD_SIZE);
+    const auto stringDataOffset = aligned(stringTableOffset + static_cast<qint64>(strings.size() + 1) * 8);
+    const auto imageTableOffset = aligned(stringDataOffset + static_cast<qint64>(stringDataSize));
+    const auto blobOffset = aligned(imageTableOffset + static_cast<qint64>(images.size()) * IMAGE_RECORD_SIZE);
+
+    Output output(device);
+    output.put(MAGIC);
+    output.put(FORMAT_VERSION);
+    output.put(static_cast<quint16>(HEADER_SIZE));
+    output.put(static_cast<quint32>(nodes.size()));
+    output.put(static_cast<quint32>(edges.size()));
+    output.put(static_cast<quint32>(strings.size()));
+    output.put(static_cast<quint32>(images.size()));
+    output.put(static_cast<quint64>(nodeTableOffset));
+    output.put(static_cast<quint64>(edgeTableOffset));
+    output.put(static_cast<quint64>(stringTableOffset));
+    output.put(static_cast<quint64>(stringDataOffset));
+    output.put(static_cast<quint64>(imageTableOffset));
+    output.put(static_cast<quint64>(blobOffset));
+    output.put(static_cast<quint32>(mindMapData.backgroundColor().rgba()));
+    output.put(static_cast<quint32>(mindMapData.edgeColor().rgba()));
+    output.putDouble(mindMapData.edgeWidth());
+    output.put(static_cast<qint32>(mindMapData.textSize()));
+    output.put(static_cast<qint32>(mindMapData.cornerRadius()));
+    output.put(quint32(0)); // Version string
+    output.put(quint32(0)); // Reserved
+
+    quint32 stringIndex = 1;
+    auto && geometry = graph.geometry();
+    for (size_t slot = 0; slot < nodes.size(); slot++) {
+        auto && node = nodes.at(slot);
+        output.putDouble(geometry.x()[slot]);
+        output.putDouble(geometry.y()[slot]);
+        output.putDouble(geometry.width()[slot]);
+        output.putDouble(geometry.height()[slot]);
+        output.put(static_cast<quint64>(node->imageRef()));
+        output.put(static_cast<qint32>(node->index()));
+        output.put(stringIndex++);
+        output.put(static_cast<quint32>(node->color().rgba()));
+        output.put(static_cast<quint32>(node->textColor().rgba()));
+    }
+
+    output.padTo(edgeTableOffset);
+    for (auto && edge : edges) {
+        output.put(static_cast<qint32>(edge->sourceNodeBase().index()));
+        output.put(static_cast<qint32>(edge->targetNodeBase().index()));
+        output.put(stringIndex++);
+        output.put(static_cast<quint16>(edge->arrowMode()));
+        output.put(static_cast<quint16>(edge->reversed()));
+    }
+
+    output.padTo(stringTableOffset);
+    quint64 stringOffset = 0;
+    for (auto && string : strings) {
+        output.put(stringOffset);
+        stringOffset += static_cast<quint64>(string.size());
+    }
+    output.put(stringOffset);
+
+    output.padTo(stringDataOffset);
+    for (auto && string : strings) {
+        output.putBytes(string.constData(), string.size());
+    }
+    strings.clear();
+
+    // Blobs are read when they are written, so only one image file is in memory at a time
+    std::vector<qint64> blobSizes;
+    for (auto && image : images) {
+        blobSizes.push_back(QFileInfo(image.second.path().c_str()).size());
+    }
+#ifdef HEIMER_UNIT_TEST
+    std::fill(blobSizes.begin(), blobSizes.end(), 0);
+#endif
+
+    output.padTo(imageTableOffset);
+    quint64 blobPosition = 0;
+    size_t imageIndex = 0;
+    for (auto && image : images) {
+        output.put(static_cast<quint64>(image.first));
+        output.put(stringIndex++);
+        output.put(quint32(0)); // Reserved
+        output.put(blobPosition);
+        output.put(static_cast<quint64>(blobSizes.at(imageIndex)));
+        blobPosition += static_cast<quint64>(blobSizes.at(imageIndex++));
+    }
+
+    output.padTo(blobOffset);
+    imageIndex = 0;
+    for (auto && image : images) {
+        const auto blob = readImageFile(image.second.path());
+        if (blob.size() != blobSizes.at(imageIndex++)) {
+            throw std::runtime_error("File changed while saving: '" + image.second.path() + "'");
+        }
+        output.putBytes(blob.constData(), blob.size());
+    }
+
+    return output.flush();
+}
+
+} // namespace BinarySerializer
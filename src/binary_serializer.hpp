@@ -0,0 +1,45 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARY_SERIALIZER_HPP
+#define BINARY_SERIALIZER_HPP
+
+#include "mind_map_data.hpp"
+
+#include <QByteArray>
+#include <QIODevice>
+
+/*! Binary variant of the file format: a versioned header followed by fixed-layout node and edge tables,
+ *  a string table for all texts and a blob section with the raw image files. Numbers are little-endian
+ *  and the tables 8-byte aligned, so that a file can be loaded straight from a memory map. */
+namespace BinarySerializer {
+
+//! Number of bytes isBinary() needs to recognize the format.
+static const qint64 MAGIC_SIZE = 4;
+
+//! \return True if the data starts like the binary format.
+bool isBinary(const QByteArray & head);
+
+/*! Builds the mind map from the whole file in memory, e.g. a memory map. Texts and images are copied,
+ *  so the memory can be released afterwards.
+ *  \return The mind map or nullptr if the data is corrupted or of an unsupported version. */
+MindMapDataPtr fromBinary(const uchar * data, qint64 size);
+
+//! \return False if writing to the device failed.
+bool toBinary(MindMapData & mindMapData, QIODevice & device);
+
+} // namespace BinarySerializer
+
+#endif // BINARY_SERIALIZER_HPP
@@ -30,6 +30,12 @@ static constexpr auto COPYRIGHT = "Copyright (c) 2018-2020 Jussi Lind";
 
 static constexpr auto FILE_EXTENSION = ".alz";
 
+//! Mind maps saved with this extension use the binary format
+static constexpr auto BINARY_FILE_EXTENSION = ".alzb";
+
+//! Mind maps saved with this extension use the compressed container that stores images as they are
+static constexpr auto CONTAINER_FILE_EXTENSION = ".alzc";
+
 static constexpr auto QSETTINGS_COMPANY_NAME = "Heimer";
 
 static constexpr auto WEB_SITE_URL = "http://juzzlin.github.io/Heimer";
@@ -158,6 +164,23 @@ static const int MAX_SIZE = 24;
 
 } // namespace Text
 
+namespace Undo {
+
+static const size_t MEMORY_BUDGET = 64 * 1024 * 1024;
+
+//! Undo points with the same merge key pushed within this interval make a single edit
+static const int MERGE_INTERVAL_MS = 1000;
+
+//! Number of the latest edits kept uncompressed in the undo and redo histories
+static const size_t UNCOMPRESSED_EDITS = 8;
+
+static constexpr auto JOURNAL_FILE_EXTENSION = ".undo";
+
+//! The journal is compacted when it's bigger than this and twice the size after the previous compaction
+static const qint64 JOURNAL_COMPACTION_SIZE = 1024 * 1024;
+
+} // namespace Undo
+
 namespace View {
 
 static const int CLICK_TOLERANCE = 5;
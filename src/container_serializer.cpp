@@ -0,0 +1,358 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "container_serializer.hpp"
+
+#include "graph.hpp"
+#include "serializer.hpp"
+#include "simple_logger.hpp"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+using juzzlin::L;
+
+namespace ContainerSerializer {
+
+namespace {
+
+//! "HMZ1" in the file
+const quint32 MAGIC = 0x315a4d48;
+
+const quint16 FORMAT_VERSION = 1;
+
+const QByteArray MODEL_ENTRY = "model.xml";
+
+//! Followed by the content hash
+const QByteArray IMAGE_ENTRY_PREFIX = "images/";
+
+//! Entries are split into chunks of at most this size before compression
+const int CHUNK_SIZE = 256 * 1024;
+
+//! zlib may grow incompressible data a bit
+const int MAX_STORED_CHUNK_SIZE = CHUNK_SIZE + CHUNK_SIZE / 100 + 64;
+
+enum class Method : quint16
+{
+    Stored = 0,
+    Zlib = 1
+};
+
+template<typename T>
+bool put(QIODevice & device, T value)
+{
+    const T littleEndian = qToLittleEndian(value);
+    return device.write(reinterpret_cast<const char *>(&littleEndian), sizeof(T)) == sizeof(T);
+}
+
+template<typename T>
+bool get(QIODevice & device, T & value)
+{
+    uchar bytes[sizeof(T)];
+    if (device.read(reinterpret_cast<char *>(bytes), sizeof(T)) != sizeof(T)) {
+        return false;
+    }
+    value = qFromLittleEndian<T>(bytes);
+    return true;
+}
+
+/*! Writes an entry to the container. Data written to this device is collected into chunks, which are
+ *  compressed and written to the container one by one. finish() must be called after the data. */
+class EntryWriter : public QIODevice
+{
+public:
+    EntryWriter(QIODevice & device, const QByteArray & name, Method method)
+      : m_device(device)
+      , m_method(method)
+    {
+        m_isValid = put(device, static_cast<quint16>(name.size())) && device.write(name) == name.size() && put(device, static_cast<quint16>(method));
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+
+    //! Writes the last chunk and the end of the entry. \return False if writing to the container failed.
+    bool finish()
+    {
+        writeChunk();
+        m_isValid = put(m_device, quint32(0)) && put(m_device, quint32(0)) && m_isValid;
+        close();
+        return m_isValid;
+    }
+
+protected:
+    qint64 readData(char *, qint64) override
+    {
+        return -1;
+    }
+
+    qint64 writeData(const char * data, qint64 size) override
+    {
+        for (qint64 written = 0; written < size;) {
+            const auto count = std::min(size - written, static_cast<qint64>(CHUNK_SIZE - m_chunk.size()));
+            m_chunk.append(data + written, static_cast<int>(count));
+            written += count;
+            if (m_chunk.size() == CHUNK_SIZE) {
+                writeChunk();
+            }
+        }
+        return m_isValid ? size : -1;
+    }
+
+private:
+    void writeChunk()
+    {
+        if (!m_chunk.isEmpty()) {
+            const auto stored = m_method == Method::Zlib ? qCompress(m_chunk) : m_chunk;
+            m_isValid = put(m_device, static_cast<quint32>(stored.size())) && put(m_device, static_cast<quint32>(m_chunk.size())) && m_device.write(stored) == stored.size() && m_isValid;
+            m_chunk.clear();
+        }
+    }
+
+    QIODevice & m_device;
+
+    Method m_method;
+
+    QByteArray m_chunk;
+
+    bool m_isValid = true;
+};
+
+/*! Reads an entry from the container. Chunks are read and decompressed only as data is read from this
+ *  device, and never beyond the end of the entry. */
+class EntryReader : public QIODevice
+{
+public:
+    EntryReader(QIODevice & device, Method method)
+      : m_device(device)
+      , m_method(method)
+    {
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    bool atEnd() const override
+    {
+        return (m_isFinished || !m_isValid) && m_position == m_chunk.size();
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return m_chunk.size() - m_position + QIODevice::bytesAvailable();
+    }
+
+    //! Skips the rest of the entry. \return False if the entry is corrupted.
+    bool finish()
+    {
+        while (readChunk()) {
+        }
+        close();
+        return m_isValid;
+    }
+
+protected:
+    qint64 readData(char * data, qint64 maxSize) override
+    {
+        qint64 count = 0;
+        while (count < maxSize && (m_position < m_chunk.size() || readChunk())) {
+            const auto length = std::min(maxSize - count, static_cast<qint64>(m_chunk.size() - m_position));
+            std::memcpy(data + count, m_chunk.constData() + m_position, static_cast<size_t>(length));
+            m_position += static_cast<int>(length);
+            count += length;
+        }
+        return count || (!m_isFinished && m_isValid) ? count : -1;
+    }
+
+    qint64 writeData(const char *, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    //! \return True if a chunk was read.
+    bool readChunk()
+    {
+        m_chunk.clear();
+        m_position = 0;
+        if (m_isFinished || !m_isValid) {
+            return false;
+        }
+
+        quint32 storedSize = 0;
+        quint32 size = 0;
+        if (!get(m_device, storedSize) || !get(m_device, size)) {
+            return fail("Truncated entry");
+        }
+        if (!storedSize && !size) {
+            m_isFinished = true;
+            return false;
+        }
+        if (storedSize > quint32(MAX_STORED_CHUNK_SIZE) || size > quint32(CHUNK_SIZE)) {
+            return fail("Invalid chunk size");
+        }
+        const auto stored = m_device.read(storedSize);
+        if (stored.size() != static_cast<int>(storedSize)) {
+            return fail("Truncated entry");
+        }
+        m_chunk = m_method == Method::Zlib ? qUncompress(stored) : stored;
+        if (m_chunk.size() != static_cast<int>(size)) {
+            return fail("Invalid chunk");
+        }
+        return true;
+    }
+
+    bool fail(const char * what)
+    {
+        L().error() << "Invalid container: " << what;
+        m_chunk.clear();
+        m_isValid = false;
+        return false;
+    }
+
+    QIODevice & m_device;
+
+    Method m_method;
+
+    QByteArray m_chunk;
+
+    int m_position = 0;
+
+    bool m_isFinished = false;
+
+    bool m_isValid = true;
+};
+
+//! \return Contents of the image file, or an empty array in unit tests.
+QByteArray readImageFile(const std::string & path)
+{
+#ifndef HEIMER_UNIT_TEST
+    QFile in(path.c_str());
+    if (!in.open(QIODevice::ReadOnly)) {
+        throw std::runtime_error("Cannot open file: '" + path + "'");
+    }
+    return in.readAll();
+#else
+    Q_UNUSED(path)
+    return {};
+#endif
+}
+
+} // namespace
+
+bool isContainer(const QByteArray & head)
+{
+    return head.size() >= MAGIC_SIZE && qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(head.constData())) == MAGIC;
+}
+
+MindMapDataPtr fromContainer(QIODevice & device)
+{
+    quint32 magic = 0;
+    quint16 formatVersion = 0;
+    quint16 reserved = 0;
+    if (!get(device, magic) || magic != MAGIC || !get(device, formatVersion) || !get(device, reserved)) {
+        L().error() << "Invalid container: Not a container";
+        return {};
+    }
+    if (formatVersion != FORMAT_VERSION) {
+        L().error() << "Invalid container: Unsupported format version " << formatVersion;
+        return {};
+    }
+
+    // Images come before the model, so that they are at hand when the XML refers to them
+    Serializer::ImageFiles imageFiles;
+    MindMapDataPtr data;
+    while (true) {
+        quint16 nameSize = 0;
+        if (!get(device, nameSize)) {
+            L().error() << "Invalid container: Truncated file";
+            return {};
+        }
+        if (!nameSize) {
+            break;
+        }
+
+        const auto name = device.read(nameSize);
+        quint16 method = 0;
+        if (name.size() != nameSize || !get(device, method) || method > static_cast<quint16>(Method::Zlib)) {
+            L().error() << "Invalid container: Invalid entry";
+            return {};
+        }
+
+        EntryReader entry(device, static_cast<Method>(method));
+        if (name.startsWith(IMAGE_ENTRY_PREFIX)) {
+            imageFiles[name.mid(IMAGE_ENTRY_PREFIX.size())] = entry.readAll();
+        } else if (name == MODEL_ENTRY && !data) {
+            if (!(data = Serializer::fromXml(entry, imageFiles))) {
+                return {};
+            }
+            imageFiles.clear();
+        } else {
+            L().warning() << "Skipping unknown entry '" << name.toStdString() << "'";
+        }
+        if (!entry.finish()) {
+            return {};
+        }
+    }
+
+    if (!data) {
+        L().error() << "Invalid container: No model";
+    }
+
+    return data;
+}
+
+bool toContainer(MindMapData & mindMapData, QIODevice & device)
+{
+    auto isValid = put(device, MAGIC) && put(device, FORMAT_VERSION) && put(device, quint16(0));
+
+    // Image files are read when they are written, so only one is in memory at a time. Identical files are stored once.
+    Serializer::ImageHashes imageHashes;
+    std::set<QByteArray> storedHashes;
+    for (auto && node : mindMapData.graph().getNodes()) {
+        if (node->imageRef() && !imageHashes.count(node->imageRef())) {
+            Image image;
+            bool exists;
+            std::tie(image, exists) = mindMapData.imageManager().getImage(node->imageRef());
+            if (exists) {
+                const auto file = readImageFile(image.path());
+                const auto hash = QCryptographicHash::hash(file, QCryptographicHash::Sha1).toHex();
+                imageHashes[image.id()] = hash;
+                if (storedHashes.insert(hash).second) {
+                    EntryWriter entry(device, IMAGE_ENTRY_PREFIX + hash, Method::Stored);
+                    entry.write(file);
+                    isValid = entry.finish() && isValid;
+                }
+            }
+        }
+    }
+
+    EntryWriter entry(device, MODEL_ENTRY, Method::Zlib);
+    isValid = Serializer::toXml(mindMapData, entry, imageHashes) && isValid;
+    isValid = entry.finish() && isValid;
+
+    return put(device, quint16(0)) && isValid;
+}
+
+} // namespace ContainerSerializer
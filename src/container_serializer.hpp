@@ -0,0 +1,44 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CONTAINER_SERIALIZER_HPP
+#define CONTAINER_SERIALIZER_HPP
+
+#include "mind_map_data.hpp"
+
+#include <QByteArray>
+#include <QIODevice>
+
+/*! Compressed container for the XML format. The file is a sequence of named entries: first each image
+ *  file as it is, keyed by its content hash, and then the XML with images referring to those hashes.
+ *  The XML is compressed with zlib in independent chunks, so it's decompressed and parsed as it's read.
+ *  Images are not compressed again as image files already are compressed. */
+namespace ContainerSerializer {
+
+//! Number of bytes isContainer() needs to recognize the format.
+static const qint64 MAGIC_SIZE = 4;
+
+//! \return True if the data starts like the container format.
+bool isContainer(const QByteArray & head);
+
+//! \return The mind map or nullptr if the container is corrupted or of an unsupported version.
+MindMapDataPtr fromContainer(QIODevice & device);
+
+//! \return False if writing to the device failed.
+bool toContainer(MindMapData & mindMapData, QIODevice & device);
+
+} // namespace ContainerSerializer
+
+#endif // CONTAINER_SERIALIZER_HPP
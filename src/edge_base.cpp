@@ -14,6 +14,7 @@
 // along with Heimer. If not, see <http://www.gnu.org/licenses/>.
 
 #include "edge_base.hpp"
+#include "graph.hpp"
 #include "node_base.hpp"
 
 EdgeBase::EdgeBase(NodeBase & sourceNode, NodeBase & targetNode)
@@ -40,6 +41,7 @@ EdgeBase::ArrowMode EdgeBase::arrowMode() const
 void EdgeBase::setArrowMode(EdgeBase::ArrowMode arrowMode)
 {
     m_arrowMode = arrowMode;
+    notifyChanged();
 }
 
 QColor EdgeBase::color() const
@@ -55,6 +57,7 @@ void EdgeBase::setColor(const QColor & color)
 void EdgeBase::setText(const QString & text)
 {
     m_text = text;
+    notifyChanged();
 }
 
 double EdgeBase::width() const
@@ -85,6 +88,7 @@ bool EdgeBase::reversed() const
 void EdgeBase::setReversed(bool reversed)
 {
     m_reversed = reversed;
+    notifyChanged();
 }
 
 bool EdgeBase::selected() const
@@ -97,6 +101,13 @@ void EdgeBase::setSelected(bool selected)
     m_selected = selected;
 }
 
+void EdgeBase::notifyChanged()
+{
+    if (m_graph) {
+        m_graph->markChanged(*this);
+    }
+}
+
 NodeBase & EdgeBase::sourceNodeBase() const
 {
     return *m_sourceNode;
@@ -21,6 +21,7 @@
 #include <QColor>
 #include <QString>
 
+class Graph;
 class NodeBase;
 
 class EdgeBase
@@ -76,6 +77,10 @@ public:
     virtual void setSelected(bool selected);
 
 private:
+    void notifyChanged();
+
+    friend class Graph;
+
     NodeBase * m_sourceNode;
 
     NodeBase * m_targetNode;
@@ -93,6 +98,9 @@ private:
     bool m_selected = false;
 
     ArrowMode m_arrowMode = ArrowMode::Single;
+
+    //! Graph is notified about changes in the persistent state while the edge belongs to it
+    Graph * m_graph = nullptr;
 };
 
 using EdgeBasePtr = std::shared_ptr<EdgeBase>;
@@ -17,12 +17,17 @@
 
 #include "constants.hpp"
 #include "node.hpp"
+#include "node_geometry_table.hpp"
 #include "reader.hpp"
 #include "recent_files_manager.hpp"
 #include "selection_group.hpp"
-#include "serializer.hpp"
+#include "undo_journal.hpp"
 #include "writer.hpp"
 
+#include <QFile>
+#include <QFutureWatcher>
+
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -40,11 +45,6 @@ QColor EditorData::backgroundColor() const
     return m_mindMapData ? m_mindMapData->backgroundColor() : Constants::MindMap::DEFAULT_BACKGROUND_COLOR;
 }
 
-void EditorData::clearScene()
-{
-    emit sceneCleared();
-}
-
 MouseAction & EditorData::mouseAction()
 {
     return m_mouseAction;
@@ -63,13 +63,18 @@ void EditorData::loadMindMapData(QString fileName)
     m_selectedEdge = nullptr;
 
 #ifndef HEIMER_UNIT_TEST
-    setMindMapData(Serializer::fromXml(Reader::readFromFile(fileName)));
+    setMindMapData(Reader::readFromFile(fileName));
 #endif
     m_fileName = fileName;
     setIsModified(false);
     RecentFilesManager::instance().addRecentFile(fileName);
 
     m_undoStack.clear();
+
+    // Only a journal saved with the document is used. Just opening a document never creates one.
+    if (m_undoJournalEnabled && QFile::exists(UndoJournal::fileName(fileName))) {
+        m_undoStack.restoreFromJournal(std::make_shared<UndoJournal>(fileName), UndoJournal::documentHash(fileName));
+    }
 }
 
 bool EditorData::isModified() const
@@ -91,11 +96,8 @@ void EditorData::undo()
 
         m_dragAndDropNode = nullptr;
 
-        saveRedoPoint();
-
-        clearScene();
-
-        m_mindMapData = m_undoStack.undo();
+        m_undoStack.undo(*m_mindMapData);
+        emit undoEnabled(m_undoStack.isUndoable());
 
         setIsModified(true);
     }
@@ -115,11 +117,8 @@ void EditorData::redo()
 
         m_dragAndDropNode = nullptr;
 
-        saveUndoPoint();
-
-        clearScene();
-
-        m_mindMapData = m_undoStack.redo();
+        m_undoStack.redo(*m_mindMapData);
+        emit undoEnabled(m_undoStack.isUndoable());
 
         setIsModified(true);
     }
@@ -133,28 +132,47 @@ bool EditorData::saveMindMap()
     return saveMindMapAs(m_fileName);
 }
 
-void EditorData::saveUndoPoint()
+void EditorData::saveUndoPoint(const QString & mergeKey)
 {
     assert(m_mindMapData);
-    m_undoStack.pushUndoPoint(m_mindMapData);
+    m_undoStack.pushUndoPoint(*m_mindMapData, mergeKey);
     emit undoEnabled(m_undoStack.isUndoable());
 
     setIsModified(true);
 }
 
-void EditorData::saveRedoPoint()
+void EditorData::beginUndoTransaction()
 {
     assert(m_mindMapData);
-    m_undoStack.pushRedoPoint(m_mindMapData);
+    m_undoStack.beginTransaction(*m_mindMapData);
+    emit undoEnabled(m_undoStack.isUndoable());
 
     setIsModified(true);
 }
 
+void EditorData::endUndoTransaction()
+{
+    m_undoStack.endTransaction();
+}
+
+void EditorData::endAllUndoTransactions()
+{
+    m_undoStack.endAllTransactions();
+}
+
 bool EditorData::saveMindMapAs(QString fileName)
 {
     assert(m_mindMapData);
 
-    if (Writer::writeToFile(Serializer::toXml(*m_mindMapData), fileName)) {
+    if (Writer::writeToFile(*m_mindMapData, fileName)) {
+        if (m_undoJournalEnabled) {
+            // The history is kept in a journal next to the document
+            if (fileName != m_fileName || !m_undoStack.hasJournal()) {
+                m_undoStack.setJournal(std::make_shared<UndoJournal>(fileName));
+            }
+            m_undoStack.markSaved(*m_mindMapData, UndoJournal::documentHash(fileName));
+        }
+
         m_fileName = fileName;
         setIsModified(false);
         RecentFilesManager::instance().addRecentFile(fileName);
@@ -232,6 +250,80 @@ void EditorData::clearSelectionGroup()
     m_selectionGroup->clear();
 }
 
+void EditorData::findBestOverlapNode(const Node & source)
+{
+    // The nodes don't move while a new edge is dragged, so the geometry is copied only once per drag
+    if (!m_mouseAction.geometry()) {
+        m_mouseAction.setGeometry(std::make_shared<const NodeGeometryColumns>(m_mindMapData->graph().geometry().columns()));
+    }
+
+    // Pre-filter candidates in the background. The margin covers the handles that are included in Node::boundingRect().
+    const auto sourceRect = source.boundingRect().translated(source.pos());
+    const auto sourceIndex = source.index();
+    const auto generation = ++m_overlapGeneration;
+    const auto watcher = new QFutureWatcher<std::vector<size_t>>(this);
+    connect(watcher, &QFutureWatcher<std::vector<size_t>>::finished, this, [this, sourceRect, sourceIndex, generation, watcher] {
+        if (generation == m_overlapGeneration && m_mouseAction.action() == MouseAction::Action::CreateOrConnectNode && m_mouseAction.sourceNode()) {
+            emit bestOverlapNodeFound(getBestOverlapNode(sourceRect, sourceIndex, watcher->result()));
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(NodeGeometryColumns::intersectingSlots(m_mouseAction.geometry(), sourceRect, Constants::Node::HANDLE_RADIUS));
+}
+
+NodePtr EditorData::bestOverlapNode(const Node & source)
+{
+    ++m_overlapGeneration;
+
+    const auto sourceRect = source.boundingRect().translated(source.pos());
+    return getBestOverlapNode(sourceRect, source.index(), m_mindMapData->graph().geometry().intersectingSlots(sourceRect, Constants::Node::HANDLE_RADIUS));
+}
+
+double EditorData::calculateNodeOverlapScore(const QRectF & rect1, const QRectF & rect2) const
+{
+    if (rect1.intersects(rect2)) {
+        auto combined = rect1;
+        combined = combined.united(rect2);
+
+        const auto biggestArea = std::max(rect1.width() * rect1.height(), rect2.height() * rect2.width());
+
+        return biggestArea / combined.width() / combined.height();
+    }
+
+    return 0;
+}
+
+NodePtr EditorData::getBestOverlapNode(const QRectF & sourceRect, int sourceIndex, const std::vector<size_t> & candidateSlots)
+{
+    const auto sourceNode = m_mouseAction.sourceNode();
+    if (!sourceNode) {
+        return {};
+    }
+
+    NodePtr bestNode;
+    double bestScore = 0;
+
+    // The candidates are scored by the current geometry of the nodes
+    auto && graph = m_mindMapData->graph();
+    auto && nodes = graph.getNodes();
+    for (auto && slot : candidateSlots) {
+        if (slot >= nodes.size()) {
+            continue;
+        }
+        if (const auto node = std::dynamic_pointer_cast<Node>(nodes.at(slot))) {
+            if (node->index() != sourceIndex && node->index() != sourceNode->index() && !graph.areDirectlyConnected(node->id(), sourceNode->id())) {
+                const auto score = calculateNodeOverlapScore(sourceRect, node->boundingRect().translated(node->pos()));
+                if (score > 0.75 && score > bestScore) {
+                    bestNode = node;
+                    bestScore = score;
+                }
+            }
+        }
+    }
+
+    return bestNode;
+}
+
 NodeBasePtr EditorData::getNodeByIndex(int index)
 {
     assert(m_mindMapData);
@@ -264,6 +356,15 @@ void EditorData::setSelectedNode(Node * node)
     m_selectionGroup->setSelectedNode(node);
 }
 
+void EditorData::setUndoJournalEnabled(bool enabled)
+{
+    m_undoJournalEnabled = enabled;
+
+    if (!enabled) {
+        m_undoStack.setJournal(nullptr);
+    }
+}
+
 Edge * EditorData::selectedEdge() const
 {
     return m_selectedEdge;
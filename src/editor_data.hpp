@@ -60,6 +60,16 @@ public:
 
     NodePtr copyNodeAt(Node & source, QPointF pos);
 
+    /*! Finds the node that the source overlaps the most in the background, e.g. the dummy node of a new edge
+     *  being dragged. The result is delivered by bestOverlapNodeFound() unless a newer search was started or
+     *  the drag has ended. */
+    void findBestOverlapNode(const Node & source);
+
+    //! Like findBestOverlapNode(), but blocks and returns the result, e.g. for the final position when the drag
+    //! ends. Results of pending background searches are dropped.
+    //! \return Null if nothing overlaps enough.
+    NodePtr bestOverlapNode(const Node & source);
+
     QColor backgroundColor() const;
 
     MouseAction & mouseAction();
@@ -88,9 +98,16 @@ public:
 
     bool saveMindMapAs(QString fileName);
 
-    void saveUndoPoint();
+    //! Undo points with the same non-empty merge key pushed in quick succession make a single edit.
+    void saveUndoPoint(const QString & mergeKey = {});
+
+    //! Makes everything until the matching endUndoTransaction() a single edit.
+    void beginUndoTransaction();
 
-    void saveRedoPoint();
+    void endUndoTransaction();
+
+    //! Closes all open undo transactions, e.g. when a drag is aborted.
+    void endAllUndoTransactions();
 
     void setMindMapData(MindMapDataPtr newMindMapData);
 
@@ -98,6 +115,10 @@ public:
 
     void setSelectedNode(Node * node);
 
+    //! Keeps the undo history in a journal next to the document when the document is saved, so that it
+    //! survives restarts. Off by default, as the journal keeps e.g. deleted texts on disk.
+    void setUndoJournalEnabled(bool enabled);
+
     Edge * selectedEdge() const;
 
     Node * selectedNode() const;
@@ -110,9 +131,10 @@ public:
 
 signals:
 
-    void isModifiedChanged(bool isModified);
+    //! The node is null if nothing overlaps enough.
+    void bestOverlapNodeFound(NodePtr node);
 
-    void sceneCleared();
+    void isModifiedChanged(bool isModified);
 
     void undoEnabled(bool enable);
 
@@ -120,7 +142,9 @@ private:
     EditorData(const EditorData & e) = delete;
     EditorData & operator=(const EditorData & e) = delete;
 
-    void clearScene();
+    double calculateNodeOverlapScore(const QRectF & rect1, const QRectF & rect2) const;
+
+    NodePtr getBestOverlapNode(const QRectF & sourceRect, int sourceIndex, const std::vector<size_t> & candidateSlots);
 
     void removeNodesFromScene();
 
@@ -148,6 +172,11 @@ private:
 
     bool m_isModified = false;
 
+    bool m_undoJournalEnabled = false;
+
+    // Only the result of the latest overlap search is used
+    size_t m_overlapGeneration = 0;
+
     QString m_fileName;
 };
 
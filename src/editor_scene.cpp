@@ -16,10 +16,6 @@
 #include "editor_scene.hpp"
 
 #include "constants.hpp"
-#include "edge.hpp"
-#include "magic_zoom.hpp"
-#include "node.hpp"
-
 #include "simple_logger.hpp"
 
 #include <QGraphicsLineItem>
@@ -60,23 +56,6 @@ void EditorScene::initialize()
     m_ownItems.push_back(ItemPtr(bottomLine));
 }
 
-QRectF EditorScene::zoomToFit(bool isForExport) const
-{
-    return MagicZoom::calculateRectangle(*this, isForExport);
-}
-
-bool EditorScene::hasEdge(Node & node0, Node & node1)
-{
-    for (auto && item : items()) {
-        if (auto edge = dynamic_cast<Edge *>(item)) {
-            if (edge->sourceNode().index() == node0.index() && edge->targetNode().index() == node1.index()) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
 void EditorScene::removeItems()
 {
     // We don't want the scene to destroy the items as they are managed elsewhere
@@ -20,8 +20,6 @@
 
 #include <QGraphicsScene>
 
-class Node;
-
 class EditorScene : public QGraphicsScene
 {
 public:
@@ -29,11 +27,6 @@ public:
 
     void initialize();
 
-    QRectF zoomToFit(bool isForExport = false) const;
-
-    //! Checks if the graphics scene already has the given edge item added
-    bool hasEdge(Node & node0, Node & node1);
-
     virtual ~EditorScene();
 
 private:
@@ -15,6 +15,7 @@
 
 #include <QApplication>
 #include <QColorDialog>
+#include <QFocusEvent>
 #include <QGraphicsItem>
 #include <QGraphicsSimpleTextItem>
 #include <QMouseEvent>
@@ -64,6 +65,29 @@ EditorView::EditorView(Mediator & mediator)
     connect(m_mainContextMenu, &MainContextMenu::newNodeRequested, this, &EditorView::newNodeRequested);
     connect(m_mainContextMenu, &MainContextMenu::nodeColorActionTriggered, this, &EditorView::openNodeColorDialog);
     connect(m_mainContextMenu, &MainContextMenu::nodeTextColorActionTriggered, this, &EditorView::openNodeTextColorDialog);
+
+    connect(&m_mediator, &Mediator::bestOverlapNodeFound, this, &EditorView::setConnectionTargetNode);
+}
+
+void EditorView::abortDrag()
+{
+    switch (m_mediator.mouseAction().action()) {
+    case MouseAction::Action::MoveNode:
+    case MouseAction::Action::CreateOrConnectNode:
+        if (m_connectionTargetNode) {
+            m_connectionTargetNode->setSelected(false);
+            m_connectionTargetNode = nullptr;
+        }
+        resetDummyDragItems();
+        m_mediator.mouseAction().clear();
+        // Otherwise every following undo point would be merged into the aborted drag
+        m_mediator.endAllUndoTransactions();
+        QApplication::restoreOverrideCursor();
+        L().debug() << "Drag aborted";
+        break;
+    default:
+        break;
+    }
 }
 
 void EditorView::finishRubberBand()
@@ -73,6 +97,13 @@ void EditorView::finishRubberBand()
     m_rubberBand->hide();
 }
 
+void EditorView::focusOutEvent(QFocusEvent * event)
+{
+    abortDrag();
+
+    QGraphicsView::focusOutEvent(event);
+}
+
 void EditorView::handleMousePressEventOnBackground(QMouseEvent & event)
 {
     if (m_mediator.selectionGroupSize()) {
@@ -182,8 +213,8 @@ void EditorView::handleRightButtonClickOnNode(Node & node)
 
 void EditorView::initiateNewNodeDrag(NodeHandle & nodeHandle)
 {
-    // User is initiating a new node drag
-    m_mediator.saveUndoPoint();
+    // User is initiating a new node drag. Everything until the mouse release is a single edit.
+    m_mediator.beginUndoTransaction();
     auto parentNode = dynamic_cast<Node *>(nodeHandle.parentItem());
     assert(parentNode);
     m_mediator.mouseAction().setSourceNode(parentNode, MouseAction::Action::CreateOrConnectNode);
@@ -195,7 +226,8 @@ void EditorView::initiateNewNodeDrag(NodeHandle & nodeHandle)
 
 void EditorView::initiateNodeDrag(Node & node)
 {
-    m_mediator.saveUndoPoint();
+    // Everything until the mouse release is a single edit
+    m_mediator.beginUndoTransaction();
 
     node.setZValue(node.zValue() + 1);
     m_mediator.mouseAction().setSourceNode(&node, MouseAction::Action::MoveNode);
@@ -251,12 +283,11 @@ void EditorView::mouseMoveEvent(QMouseEvent * event)
         m_mediator.clearSelectedNode();
         m_mediator.clearSelectionGroup();
 
-        m_connectionTargetNode = nullptr;
-        // TODO: Use items() to pre-filter the nodes
-        if (auto && node = m_mediator.getBestOverlapNode(*m_dummyDragNode)) {
-            node->setSelected(true);
-            m_connectionTargetNode = node;
+        // The target found for the previous position is kept until the search for this one finishes
+        if (m_connectionTargetNode) {
+            m_connectionTargetNode->setSelected(true);
         }
+        m_mediator.findBestOverlapNode(*m_dummyDragNode);
     } break;
     case MouseAction::Action::RubberBand:
         updateRubberBand();
@@ -272,6 +303,9 @@ void EditorView::mouseMoveEvent(QMouseEvent * event)
 
 void EditorView::mousePressEvent(QMouseEvent * event)
 {
+    // The release of a previous drag may never arrive, e.g. if the mouse was grabbed by another window
+    abortDrag();
+
     m_clickedPos = event->pos();
     const auto clickedScenePos = mapToScene(m_clickedPos);
     m_mediator.mouseAction().setClickedScenePos(clickedScenePos);
@@ -315,9 +349,13 @@ void EditorView::mouseReleaseEvent(QMouseEvent * event)
         switch (m_mediator.mouseAction().action()) {
         case MouseAction::Action::MoveNode:
             m_mediator.mouseAction().clear();
+            m_mediator.endUndoTransaction();
             break;
         case MouseAction::Action::CreateOrConnectNode:
             if (auto sourceNode = m_mediator.mouseAction().sourceNode()) {
+                // The background search for the last move may not have finished, so the target is found
+                // for the final position here
+                setConnectionTargetNode(m_dummyDragNode ? m_mediator.bestOverlapNode(*m_dummyDragNode) : nullptr);
                 if (m_connectionTargetNode) {
                     m_mediator.addEdge(*sourceNode, *m_connectionTargetNode);
                     m_connectionTargetNode->setSelected(false);
@@ -329,6 +367,7 @@ void EditorView::mouseReleaseEvent(QMouseEvent * event)
                 resetDummyDragItems();
                 m_mediator.mouseAction().clear();
             }
+            m_mediator.endUndoTransaction();
             break;
         case MouseAction::Action::RubberBand:
             finishRubberBand();
@@ -389,6 +428,19 @@ void EditorView::resetDummyDragItems()
     L().debug() << "Dummy drag item reset";
 }
 
+void EditorView::setConnectionTargetNode(std::shared_ptr<Node> node)
+{
+    if (m_connectionTargetNode) {
+        m_connectionTargetNode->setSelected(false);
+    }
+
+    m_connectionTargetNode = node;
+
+    if (m_connectionTargetNode) {
+        m_connectionTargetNode->setSelected(true);
+    }
+}
+
 void EditorView::showDummyDragEdge(bool show)
 {
     if (auto sourceNode = m_mediator.mouseAction().sourceNode()) {
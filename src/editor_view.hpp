@@ -36,6 +36,7 @@ class MindMapTile;
 class Object;
 class ObjectModelLoaderoader;
 class QAction;
+class QFocusEvent;
 class QMouseEvent;
 class QPaintEvent;
 class QWheelEvent;
@@ -68,6 +69,8 @@ public slots:
     void setGridSize(int size);
 
 protected:
+    void focusOutEvent(QFocusEvent * event) override;
+
     void mouseMoveEvent(QMouseEvent * event) override;
 
     void mousePressEvent(QMouseEvent * event) override;
@@ -88,7 +91,11 @@ private slots:
 
     void openNodeTextColorDialog();
 
+    void setConnectionTargetNode(std::shared_ptr<Node> node);
+
 private:
+    void abortDrag();
+
     void finishRubberBand();
 
     void handleMousePressEventOnBackground(QMouseEvent & event);
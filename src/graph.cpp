@@ -28,7 +28,103 @@ Graph::Graph()
 
 void Graph::clear()
 {
+    const bool wasEmpty = m_nodes.empty() && m_edges.empty();
+
+    m_pendingEdges.clear();
+    m_pendingNodes.clear();
+
+    for (auto && edge : m_edges) {
+        edge->m_graph = nullptr;
+    }
+    m_edgesFrom.clear();
+    m_edgesTo.clear();
+    m_edgeMap.clear();
+    m_edges.clear();
+
+    // Keep the slots so that handles issued before clear() stay detectably stale
+    for (auto && node : m_nodes) {
+        releaseSlot(node->id());
+        node->m_id = {};
+        node->m_graph = nullptr;
+    }
+    m_edgesFrom.resize(m_slots.size());
+    m_edgesTo.resize(m_slots.size());
+
+    m_changedEdges.clear();
+    m_changedNodes.clear();
+    m_snapshot = {};
+
+    m_componentSizes.clear();
+    m_geometry.clear();
+    m_indexMap.clear();
     m_nodes.clear();
+
+    if (!wasEmpty) {
+        reportChange({ GraphChange::Type::Cleared });
+    }
+}
+
+void Graph::reserve(size_t nodeCount, size_t edgeCount)
+{
+    m_nodes.reserve(nodeCount);
+    m_slots.reserve(nodeCount);
+    m_indexMap.reserve(nodeCount);
+    m_geometry.reserve(nodeCount);
+
+    m_edges.reserve(edgeCount);
+    m_edgeMap.reserve(edgeCount);
+    m_edgesFrom.reserve(nodeCount);
+    m_edgesTo.reserve(nodeCount);
+}
+
+void Graph::appendNode(NodeBasePtr node)
+{
+    m_pendingNodes.push_back(node);
+}
+
+void Graph::appendEdge(EdgeBasePtr edge)
+{
+    m_pendingEdges.push_back(edge);
+}
+
+size_t Graph::finalize()
+{
+    beginChanges();
+
+    size_t rejected = 0;
+
+    // Calculate the next free index only once for the whole batch
+    for (auto && node : m_pendingNodes) {
+        m_count = std::max(m_count, node->index() + 1);
+    }
+
+    for (auto && node : m_pendingNodes) {
+        if (node->index() == -1) {
+            node->setIndex(m_count++);
+        }
+        if (!insertNode(node)) {
+            juzzlin::L().warning() << "Node with index " << node->index() << " already exists";
+            rejected++;
+        }
+    }
+    m_pendingNodes.clear();
+
+    for (auto && edge : m_pendingEdges) {
+        const int sourceIndex = edge->sourceNodeBase().index();
+        const int targetIndex = edge->targetNodeBase().index();
+        if (!isMember(edge->sourceNodeBase()) || !isMember(edge->targetNodeBase())) {
+            juzzlin::L().warning() << "Dangling edge " << sourceIndex << " -> " << targetIndex;
+            rejected++;
+        } else if (!insertEdge(edge)) {
+            juzzlin::L().warning() << "Duplicate edge " << sourceIndex << " -> " << targetIndex;
+            rejected++;
+        }
+    }
+    m_pendingEdges.clear();
+
+    endChanges();
+
+    return rejected;
 }
 
 void Graph::addNode(NodeBasePtr node)
@@ -41,83 +137,355 @@ void Graph::addNode(NodeBasePtr node)
         }
     }
 
-    m_nodes.push_back(node);
+    if (!insertNode(node)) {
+        juzzlin::L().warning() << "Node with index " << node->index() << " already exists";
+    }
+}
+
+bool Graph::insertNode(NodeBasePtr node)
+{
+    assert(!node->id().isValid());
+
+    const auto id = allocateSlot(m_nodes.size());
+    if (m_indexMap.emplace(node->index(), id).second) {
+        node->m_id = id;
+        node->m_graph = this;
+        m_nodes.push_back(node);
+        m_geometry.attach(*node);
+        m_snapshot.nodes.push_back(NodeRecord(*node));
+        createComponent(id.slot());
+        reportChange(nodeChange(GraphChange::Type::NodeAdded, *node));
+        return true;
+    }
+    releaseSlot(id);
+    return false;
+}
+
+bool Graph::insertEdge(EdgeBasePtr edge)
+{
+    if (m_edgeMap.emplace(edgeKey(*edge), m_edges.size()).second) {
+        edge->m_graph = this;
+        m_edges.push_back(edge);
+        m_snapshot.edges.push_back(EdgeRecord(*edge));
+        m_edgesFrom.at(edge->sourceNodeBase().id().slot()).push_back(edge);
+        m_edgesTo.at(edge->targetNodeBase().id().slot()).push_back(edge);
+        joinComponents(edge->sourceNodeBase().id().slot(), edge->targetNodeBase().id().slot());
+        reportChange(edgeChange(GraphChange::Type::EdgeAdded, *edge));
+        return true;
+    }
+    return false;
+}
+
+NodeId Graph::allocateSlot(size_t position)
+{
+    uint32_t slot = 0;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+        m_edgesFrom.emplace_back();
+        m_edgesTo.emplace_back();
+    }
+
+    auto && entry = m_slots.at(slot);
+    entry.position = position;
+    entry.used = true;
+    return { slot, entry.generation };
+}
+
+void Graph::releaseSlot(NodeId id)
+{
+    auto && entry = m_slots.at(id.slot());
+    entry.generation++;
+    entry.used = false;
+    entry.changed = false;
+    m_freeSlots.push_back(id.slot());
+}
+
+void Graph::createComponent(uint32_t slot)
+{
+    const auto component = m_nextComponentId++;
+    m_slots.at(slot).component = component;
+    m_componentSizes[component] = 1;
+}
+
+void Graph::joinComponents(uint32_t slot0, uint32_t slot1)
+{
+    auto component0 = m_slots.at(slot0).component;
+    auto component1 = m_slots.at(slot1).component;
+    if (component0 == component1) {
+        return;
+    }
+
+    // Relabel the smaller component so that the total cost of building a graph stays O(n log n)
+    if (m_componentSizes.at(component0) > m_componentSizes.at(component1)) {
+        std::swap(component0, component1);
+        std::swap(slot0, slot1);
+    }
+
+    std::vector<uint32_t> queue = { slot0 };
+    m_slots.at(slot0).component = component1;
+    for (size_t i = 0; i < queue.size(); i++) {
+        const auto slot = queue.at(i);
+        for (auto && edge : m_edgesFrom.at(slot)) {
+            const auto neighbor = edge->targetNodeBase().id().slot();
+            if (m_slots.at(neighbor).component == component0) {
+                m_slots.at(neighbor).component = component1;
+                queue.push_back(neighbor);
+            }
+        }
+        for (auto && edge : m_edgesTo.at(slot)) {
+            const auto neighbor = edge->sourceNodeBase().id().slot();
+            if (m_slots.at(neighbor).component == component0) {
+                m_slots.at(neighbor).component = component1;
+                queue.push_back(neighbor);
+            }
+        }
+    }
+
+    m_componentSizes.at(component1) += m_componentSizes.at(component0);
+    m_componentSizes.erase(component0);
+}
+
+void Graph::splitComponents(std::vector<uint32_t> candidates)
+{
+    // Candidates are nodes that were connected before a removal. Check them pairwise until each of them
+    // is known to be either connected to the first one or relabeled into a new component.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    while (candidates.size() >= 2) {
+        const auto component = m_slots.at(candidates.at(0)).component;
+        if (splitIfDisconnected(candidates.at(0), candidates.at(1))) {
+            candidates.erase(candidates.begin() + 1);
+        } else {
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [=](uint32_t slot) {
+                                 return m_slots.at(slot).component != component;
+                             }),
+                             candidates.end());
+        }
+    }
+}
+
+bool Graph::splitIfDisconnected(uint32_t slot0, uint32_t slot1)
+{
+    if (m_slots.at(slot0).component != m_slots.at(slot1).component) {
+        return false;
+    }
+
+    // Grow one breadth-first search from each end in lockstep. If the searches meet, the nodes are still connected.
+    // Otherwise the search that runs out first has visited a whole separated part, so the cost is proportional
+    // to the smaller part and not to the whole component.
+    const auto stamp0 = nextVisitStamp();
+    const auto stamp1 = nextVisitStamp();
+    std::vector<uint32_t> visited0 = { slot0 };
+    std::vector<uint32_t> visited1 = { slot1 };
+    m_slots.at(slot0).visitStamp = stamp0;
+    m_slots.at(slot1).visitStamp = stamp1;
+    size_t head0 = 0;
+    size_t head1 = 0;
+    while (head0 < visited0.size() && head1 < visited1.size()) {
+        if (visitNeighbors(visited0.at(head0++), stamp0, stamp1, visited0) || visitNeighbors(visited1.at(head1++), stamp1, stamp0, visited1)) {
+            return true;
+        }
+    }
+
+    auto && separated = head0 == visited0.size() ? visited0 : visited1;
+    const auto oldComponent = m_slots.at(slot0).component;
+    const auto newComponent = m_nextComponentId++;
+    for (auto && slot : separated) {
+        m_slots.at(slot).component = newComponent;
+    }
+    m_componentSizes[newComponent] = separated.size();
+    m_componentSizes.at(oldComponent) -= separated.size();
+    return false;
+}
+
+bool Graph::visitNeighbors(uint32_t slot, uint32_t stamp, uint32_t otherStamp, std::vector<uint32_t> & visited)
+{
+    const auto visit = [&](uint32_t neighbor) {
+        auto && entry = m_slots.at(neighbor);
+        if (entry.visitStamp == otherStamp) {
+            return true;
+        }
+        if (entry.visitStamp != stamp) {
+            entry.visitStamp = stamp;
+            visited.push_back(neighbor);
+        }
+        return false;
+    };
+
+    for (auto && edge : m_edgesFrom.at(slot)) {
+        if (visit(edge->targetNodeBase().id().slot())) {
+            return true;
+        }
+    }
+    for (auto && edge : m_edgesTo.at(slot)) {
+        if (visit(edge->sourceNodeBase().id().slot())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Graph::nextVisitStamp()
+{
+    if (m_visitStamp == UINT32_MAX) {
+        for (auto && entry : m_slots) {
+            entry.visitStamp = 0;
+        }
+        m_visitStamp = 0;
+    }
+    return ++m_visitStamp;
+}
+
+bool Graph::isMember(const NodeBase & node) const
+{
+    return getNode(node.id()) == &node;
+}
+
+Graph::EdgeKey Graph::edgeKey(NodeId sourceId, NodeId targetId)
+{
+    return (static_cast<EdgeKey>(sourceId.slot()) << 32) | targetId.slot();
+}
+
+Graph::EdgeKey Graph::edgeKey(const EdgeBase & edge)
+{
+    return edgeKey(edge.sourceNodeBase().id(), edge.targetNodeBase().id());
+}
+
+void Graph::removeEdgeAt(size_t position)
+{
+    // Swap-and-pop so that the removal doesn't shift the rest of the edges
+    m_edges.at(position)->m_graph = nullptr;
+    m_edgeMap.erase(edgeKey(*m_edges.at(position)));
+    if (position + 1 < m_edges.size()) {
+        m_edges.at(position) = m_edges.back();
+        m_edgeMap[edgeKey(*m_edges.at(position))] = position;
+        m_snapshot.edges.set(position, m_snapshot.edges.back());
+    }
+    m_edges.pop_back();
+    m_snapshot.edges.pop_back();
+}
+
+void Graph::removeFromAdjacency(EdgeVector & edges, const EdgeBase * edge)
+{
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [=](const EdgeBasePtr & candidate) {
+                    return candidate.get() == edge;
+                }),
+                edges.end());
 }
 
 void Graph::deleteEdge(int index0, int index1)
 {
-    EdgeVector::iterator edgeIter;
-    bool edgeErased = false;
-    do {
-        edgeIter = std::find_if(
-          m_edges.begin(), m_edges.end(), [=](const EdgeBasePtr & edge) {
-              return edge->sourceNodeBase().index() == index0 && edge->targetNodeBase().index() == index1;
-          });
-        edgeErased = edgeIter != m_edges.end();
-        if (edgeErased) {
-            m_edges.erase(edgeIter);
+    const auto id0 = getNodeId(index0);
+    const auto id1 = getNodeId(index1);
+    if (id0.isValid() && id1.isValid()) {
+        const auto iter = m_edgeMap.find(edgeKey(id0, id1));
+        if (iter != m_edgeMap.end()) {
+            const auto edge = m_edges.at(iter->second);
+            reportChange(edgeChange(GraphChange::Type::EdgeRemoved, *edge));
+            removeEdgeAt(iter->second);
+            removeFromAdjacency(m_edgesFrom.at(id0.slot()), edge.get());
+            removeFromAdjacency(m_edgesTo.at(id1.slot()), edge.get());
+            splitComponents({ id0.slot(), id1.slot() });
         }
-    } while (edgeErased);
+    }
 }
 
 void Graph::deleteNode(int index)
 {
-    const auto iter = std::find_if(m_nodes.begin(), m_nodes.end(), [=](const NodeBasePtr & node) {
-        return node->index() == index;
-    });
-
-    if (iter != m_nodes.end()) {
-        EdgeVector::iterator edgeIter;
-        bool edgeErased = false;
-        do {
-            edgeIter = std::find_if(
-              m_edges.begin(), m_edges.end(), [=](const EdgeBasePtr & edge) {
-                  return edge->sourceNodeBase().index() == index || edge->targetNodeBase().index() == index;
-              });
-            edgeErased = edgeIter != m_edges.end();
-            if (edgeErased) {
-                m_edges.erase(edgeIter);
-            }
-        } while (edgeErased);
+    const auto indexIter = m_indexMap.find(index);
+    if (indexIter != m_indexMap.end()) {
+        const auto id = indexIter->second;
+
+        // Report the node and its edges as a single batch
+        beginChanges();
+
+        // Remove incident edges in a single pass over the adjacency lists of the node
+        std::vector<uint32_t> neighbors;
+        EdgeVector edges;
+        edges.swap(m_edgesFrom.at(id.slot()));
+        for (auto && edge : edges) {
+            reportChange(edgeChange(GraphChange::Type::EdgeRemoved, *edge));
+            const auto targetSlot = edge->targetNodeBase().id().slot();
+            removeEdgeAt(m_edgeMap.at(edgeKey(*edge)));
+            removeFromAdjacency(m_edgesTo.at(targetSlot), edge.get());
+            neighbors.push_back(targetSlot);
+        }
+
+        edges.clear();
+        edges.swap(m_edgesTo.at(id.slot()));
+        for (auto && edge : edges) {
+            reportChange(edgeChange(GraphChange::Type::EdgeRemoved, *edge));
+            const auto sourceSlot = edge->sourceNodeBase().id().slot();
+            removeEdgeAt(m_edgeMap.at(edgeKey(*edge)));
+            removeFromAdjacency(m_edgesFrom.at(sourceSlot), edge.get());
+            neighbors.push_back(sourceSlot);
+        }
+
+        // The node is isolated now, so drop it from its component and check if the neighbors got separated
+        const auto component = m_slots.at(id.slot()).component;
+        if (!--m_componentSizes.at(component)) {
+            m_componentSizes.erase(component);
+        }
+        neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), id.slot()), neighbors.end());
+        splitComponents(neighbors);
+
+        // Swap-and-pop the node itself. The geometry table does the same, so slots stay in sync with m_nodes.
+        const auto position = m_slots.at(id.slot()).position;
+        auto && node = m_nodes.at(position);
+        reportChange(nodeChange(GraphChange::Type::NodeRemoved, *node));
+        m_geometry.detach(*node);
+        node->m_id = {};
+        node->m_graph = nullptr;
+        releaseSlot(id);
+        m_indexMap.erase(indexIter);
+        if (position + 1 < m_nodes.size()) {
+            node = m_nodes.back();
+            m_slots.at(node->id().slot()).position = position;
+            m_snapshot.nodes.set(position, m_snapshot.nodes.back());
+        }
+        m_nodes.pop_back();
+        m_snapshot.nodes.pop_back();
 
-        m_nodes.erase(iter);
+        endChanges();
     }
 }
 
 void Graph::addEdge(EdgeBasePtr newEdge)
 {
     // Add if such edge doesn't already exist
-    if (std::count_if(
-          m_edges.begin(), m_edges.end(), [=](const EdgeBasePtr & edge) {
-              return edge->sourceNodeBase().index() == newEdge->sourceNodeBase().index() && edge->targetNodeBase().index() == newEdge->targetNodeBase().index();
-          })
-        == 0) {
-        m_edges.push_back(newEdge);
+    if (isMember(newEdge->sourceNodeBase()) && isMember(newEdge->targetNodeBase())) {
+        insertEdge(newEdge);
+    } else {
+        juzzlin::L().warning() << "Dangling edge " << newEdge->sourceNodeBase().index() << " -> " << newEdge->targetNodeBase().index();
     }
 }
 
 #ifdef HEIMER_UNIT_TEST
 void Graph::addEdge(int node0, int node1)
 {
-    // Add if such edge doesn't already exist
-    if (std::count_if(
-          m_edges.begin(), m_edges.end(), [=](const EdgeBasePtr & edge) {
-              return edge->sourceNodeBase().index() == node0 && edge->targetNodeBase().index() == node1;
-          })
-        == 0) {
-        m_edges.push_back(std::make_shared<EdgeBase>(*getNode(node0), *getNode(node1)));
+    const auto id0 = getNodeId(node0);
+    const auto id1 = getNodeId(node1);
+    if (id0.isValid() && id1.isValid() && !m_edgeMap.count(edgeKey(id0, id1))) {
+        addEdge(std::make_shared<EdgeBase>(*getNode(id0), *getNode(id1)));
     }
 }
 #endif
 
 bool Graph::areDirectlyConnected(NodeBasePtr node0, NodeBasePtr node1)
 {
-    for (auto && edge : m_edges) {
-        if ((edge->sourceNodeBase().index() == node0->index() && edge->targetNodeBase().index() == node1->index()) || (edge->sourceNodeBase().index() == node1->index() && edge->targetNodeBase().index() == node0->index())) {
-            return true;
-        }
+    return areDirectlyConnected(getNodeId(node0->index()), getNodeId(node1->index()));
+}
+
+bool Graph::areDirectlyConnected(NodeId id0, NodeId id1) const
+{
+    if (!contains(id0) || !contains(id1)) {
+        return false;
     }
-    return false;
+    return m_edgeMap.count(edgeKey(id0, id1)) || m_edgeMap.count(edgeKey(id1, id0));
 }
 
 size_t Graph::numNodes() const
@@ -130,34 +498,93 @@ const Graph::EdgeVector & Graph::getEdges() const
     return m_edges;
 }
 
-Graph::EdgeVector Graph::getEdgesFromNode(NodeBasePtr node)
+EdgeBase * Graph::getEdge(NodeId sourceId, NodeId targetId) const
 {
-    Graph::EdgeVector edges;
-    for (auto && edge : m_edges) {
-        if (edge->sourceNodeBase().index() == node->index()) {
-            edges.push_back(edge);
+    if (contains(sourceId) && contains(targetId)) {
+        const auto iter = m_edgeMap.find(edgeKey(sourceId, targetId));
+        if (iter != m_edgeMap.end()) {
+            return m_edges.at(iter->second).get();
         }
     }
-    return edges;
+    return nullptr;
+}
+
+Graph::EdgeVector Graph::getEdgesFromNode(NodeBasePtr node)
+{
+    const auto id = getNodeId(node->index());
+    return id.isValid() ? m_edgesFrom.at(id.slot()) : Graph::EdgeVector {};
 }
 
 Graph::EdgeVector Graph::getEdgesToNode(NodeBasePtr node)
 {
-    Graph::EdgeVector edges;
-    for (auto && edge : m_edges) {
-        if (edge->targetNodeBase().index() == node->index()) {
-            edges.push_back(edge);
-        }
-    }
-    return edges;
+    const auto id = getNodeId(node->index());
+    return id.isValid() ? m_edgesTo.at(id.slot()) : Graph::EdgeVector {};
+}
+
+Graph::EdgeView Graph::view(const EdgeVector & edges)
+{
+    return { edges.data(), edges.data() + edges.size() };
+}
+
+Graph::EdgeView Graph::edgesFrom(NodeId id) const
+{
+    return contains(id) ? view(m_edgesFrom.at(id.slot())) : EdgeView {};
+}
+
+Graph::EdgeView Graph::edgesTo(NodeId id) const
+{
+    return contains(id) ? view(m_edgesTo.at(id.slot())) : EdgeView {};
+}
+
+size_t Graph::inDegree(NodeId id) const
+{
+    return contains(id) ? m_edgesTo.at(id.slot()).size() : 0;
+}
+
+size_t Graph::outDegree(NodeId id) const
+{
+    return contains(id) ? m_edgesFrom.at(id.slot()).size() : 0;
 }
 
 NodeBasePtr Graph::getNode(int index)
 {
-    auto iter = std::find_if(m_nodes.begin(), m_nodes.end(), [=](const NodeBasePtr & node) {
-        return node->index() == index;
-    });
-    return iter != m_nodes.end() ? *iter : NodeBasePtr();
+    const auto id = getNodeId(index);
+    return id.isValid() ? m_nodes.at(m_slots.at(id.slot()).position) : NodeBasePtr();
+}
+
+NodeBase * Graph::getNode(NodeId id) const
+{
+    return contains(id) ? m_nodes.at(m_slots.at(id.slot()).position).get() : nullptr;
+}
+
+NodeId Graph::getNodeId(int index) const
+{
+    const auto iter = m_indexMap.find(index);
+    return iter != m_indexMap.end() ? iter->second : NodeId {};
+}
+
+bool Graph::contains(NodeId id) const
+{
+    if (id.isValid() && id.slot() < m_slots.size()) {
+        auto && entry = m_slots.at(id.slot());
+        return entry.used && entry.generation == id.generation();
+    }
+    return false;
+}
+
+uint32_t Graph::componentId(NodeId id) const
+{
+    return contains(id) ? m_slots.at(id.slot()).component : UINT32_MAX;
+}
+
+size_t Graph::componentSize(NodeId id) const
+{
+    return contains(id) ? m_componentSizes.at(m_slots.at(id.slot()).component) : 0;
+}
+
+size_t Graph::componentCount() const
+{
+    return m_componentSizes.size();
 }
 
 const Graph::NodeVector & Graph::getNodes() const
@@ -165,19 +592,146 @@ const Graph::NodeVector & Graph::getNodes() const
     return m_nodes;
 }
 
+void Graph::markChanged(const NodeBase & node, GraphChange::Type type)
+{
+    auto && entry = m_slots.at(node.id().slot());
+    if (!entry.changed) {
+        entry.changed = true;
+        m_changedNodes.push_back(node.id().slot());
+    }
+
+    reportChange(nodeChange(type, node));
+}
+
+void Graph::markChanged(const EdgeBase & edge)
+{
+    m_changedEdges.insert(edgeKey(edge));
+
+    reportChange(edgeChange(GraphChange::Type::EdgeChanged, edge));
+}
+
+size_t Graph::addChangeObserver(ChangeObserver observer)
+{
+    m_observers.push_back({ m_nextObserverId, observer });
+    return m_nextObserverId++;
+}
+
+void Graph::removeChangeObserver(size_t id)
+{
+    m_observers.erase(std::remove_if(m_observers.begin(), m_observers.end(), [=](const std::pair<size_t, ChangeObserver> & observer) {
+                          return observer.first == id;
+                      }),
+                      m_observers.end());
+}
+
+void Graph::beginChanges()
+{
+    m_transactionDepth++;
+}
+
+void Graph::endChanges()
+{
+    assert(m_transactionDepth > 0);
+    if (!--m_transactionDepth) {
+        publishChanges();
+    }
+}
+
+void Graph::reportChange(const GraphChange & change)
+{
+    if (m_observers.empty()) {
+        return;
+    }
+
+    switch (change.type) {
+    case GraphChange::Type::NodeMoved:
+    case GraphChange::Type::NodeChanged:
+    case GraphChange::Type::EdgeChanged:
+    case GraphChange::Type::StyleChanged:
+        if (!m_pendingChangeKeys.insert(std::make_tuple(static_cast<int>(change.type), change.node.value(), change.targetNode.value())).second) {
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    m_pendingChanges.push_back(change);
+
+    if (!m_transactionDepth) {
+        publishChanges();
+    }
+}
+
+void Graph::publishChanges()
+{
+    if (m_pendingChanges.empty()) {
+        return;
+    }
+
+    ChangeBatch changes;
+    changes.swap(m_pendingChanges);
+    m_pendingChangeKeys.clear();
+
+    // Observers may add or remove observers
+    const auto observers = m_observers;
+    for (auto && observer : observers) {
+        observer.second(changes);
+    }
+}
+
+GraphChange Graph::nodeChange(GraphChange::Type type, const NodeBase & node)
+{
+    return { type, node.id(), node.index() };
+}
+
+GraphChange Graph::edgeChange(GraphChange::Type type, const EdgeBase & edge)
+{
+    return { type, edge.sourceNodeBase().id(), edge.sourceNodeBase().index(), edge.targetNodeBase().id(), edge.targetNodeBase().index() };
+}
+
+GraphSnapshot Graph::snapshot()
+{
+    for (auto && slot : m_changedNodes) {
+        auto && entry = m_slots.at(slot);
+        if (entry.changed) {
+            entry.changed = false;
+            m_snapshot.nodes.set(entry.position, NodeRecord(*m_nodes.at(entry.position)));
+        }
+    }
+    m_changedNodes.clear();
+
+    for (auto && key : m_changedEdges) {
+        const auto iter = m_edgeMap.find(key);
+        if (iter != m_edgeMap.end()) {
+            m_snapshot.edges.set(iter->second, EdgeRecord(*m_edges.at(iter->second)));
+        }
+    }
+    m_changedEdges.clear();
+
+    return m_snapshot;
+}
+
+const NodeGeometryTable & Graph::geometry() const
+{
+    return m_geometry;
+}
+
 Graph::NodeVector Graph::getNodesConnectedToNode(NodeBasePtr node)
 {
     NodeVector result;
 
-    auto && from = getEdgesFromNode(node);
-    auto && to = getEdgesToNode(node);
+    const auto id = getNodeId(node->index());
+    const auto from = edgesFrom(id);
+    const auto to = edgesTo(id);
+    result.reserve(from.size() + to.size());
 
     for (auto && edge : to) {
-        result.push_back(getNode(edge->sourceNodeBase().index()));
+        result.push_back(m_nodes.at(m_slots.at(edge->sourceNodeBase().id().slot()).position));
     }
 
     for (auto && edge : from) {
-        result.push_back(getNode(edge->targetNodeBase().index()));
+        result.push_back(m_nodes.at(m_slots.at(edge->targetNodeBase().id().slot()).position));
     }
 
     return result;
@@ -185,9 +739,10 @@ Graph::NodeVector Graph::getNodesConnectedToNode(NodeBasePtr node)
 
 Graph::~Graph()
 {
+    m_observers.clear();
+
     // Ensure that edges are always deleted before nodes
-    m_edges.clear();
-    m_nodes.clear();
+    clear();
 
     juzzlin::L().debug() << "Graph deleted";
 }
@@ -17,16 +17,72 @@
 #define GRAPH_HPP
 
 #include "edge_base.hpp"
+#include "graph_change.hpp"
+#include "graph_snapshot.hpp"
 #include "node_base.hpp"
+#include "node_geometry_table.hpp"
+#include "node_id.hpp"
 
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 class NodeBase;
 
 class Graph
 {
 public:
+    //! Non-owning view to items stored in the graph. Iterating doesn't allocate nor touch refcounts.
+    //! Invalidated by any modification of the graph.
+    template<typename T>
+    class View
+    {
+    public:
+        View() = default;
+
+        View(const T * begin, const T * end)
+          : m_begin(begin)
+          , m_end(end)
+        {
+        }
+
+        const T * begin() const
+        {
+            return m_begin;
+        }
+
+        const T * end() const
+        {
+            return m_end;
+        }
+
+        size_t size() const
+        {
+            return static_cast<size_t>(m_end - m_begin);
+        }
+
+        bool empty() const
+        {
+            return m_begin == m_end;
+        }
+
+        const T & operator[](size_t i) const
+        {
+            return m_begin[i];
+        }
+
+    private:
+        const T * m_begin = nullptr;
+
+        const T * m_end = nullptr;
+    };
+
+    using EdgeView = View<EdgeBasePtr>;
+
     Graph();
 
     Graph(const Graph & other) = delete;
@@ -39,8 +95,44 @@ public:
 
     using EdgeVector = std::vector<EdgeBasePtr>;
 
+    using ChangeBatch = std::vector<GraphChange>;
+
+    using ChangeObserver = std::function<void(const ChangeBatch &)>;
+
+    /*! Registers an observer for changes. Outside of a transaction every change is delivered right away as
+     *  a batch of one. Nothing is recorded while there are no observers.
+     *  \return Id for removeChangeObserver(). */
+    size_t addChangeObserver(ChangeObserver observer);
+
+    void removeChangeObserver(size_t id);
+
+    /*! Starts a transaction. Changes are collected and delivered as a single batch at the matching
+     *  endChanges(). Repeated moves or modifications of the same item are reported only once per batch.
+     *  Transactions can be nested and only the outermost one delivers. */
+    void beginChanges();
+
+    void endChanges();
+
+    //! Reports a change of state not owned by the graph itself, e.g. the map-wide styles of MindMapData.
+    void reportChange(const GraphChange & change);
+
     void clear();
 
+    //! Reserves capacity for the given total amounts of nodes and edges.
+    void reserve(size_t nodeCount, size_t edgeCount);
+
+    //! Appends a node for bulk construction. The node is not indexed nor validated before finalize().
+    void appendNode(NodeBasePtr node);
+
+    //! Appends an edge for bulk construction. The edge is not indexed nor validated before finalize().
+    void appendEdge(EdgeBasePtr edge);
+
+    /*! Indexes all appended nodes and edges in a single pass. Nodes without an index get one after the
+     *  biggest existing index. Nodes with an already used index, edges with an endpoint not in the graph
+     *  and duplicate edges are rejected.
+     *  \return Number of rejected nodes and edges. */
+    size_t finalize();
+
     void addNode(NodeBasePtr node);
 
     void deleteNode(int index);
@@ -51,6 +143,8 @@ public:
 
     bool areDirectlyConnected(NodeBasePtr node0, NodeBasePtr node1);
 
+    bool areDirectlyConnected(NodeId id0, NodeId id1) const;
+
     //! Warning: this should not be used outside unit tests as it creates a pure EdgeBase
 #ifdef HEIMER_UNIT_TEST
     void addEdge(int node0, int node1);
@@ -61,19 +155,174 @@ public:
 
     EdgeVector getEdgesToNode(NodeBasePtr node);
 
+    //! \return View to the edges starting from the given node. Empty if the handle is stale.
+    EdgeView edgesFrom(NodeId id) const;
+
+    //! \return View to the edges ending to the given node. Empty if the handle is stale.
+    EdgeView edgesTo(NodeId id) const;
+
+    //! \return Number of edges ending to the given node in O(1).
+    size_t inDegree(NodeId id) const;
+
+    //! \return Number of edges starting from the given node in O(1).
+    size_t outDegree(NodeId id) const;
+
     const EdgeVector & getEdges() const;
 
+    //! \return The edge or nullptr if there's no such edge. O(1), no refcounting.
+    EdgeBase * getEdge(NodeId sourceId, NodeId targetId) const;
+
     NodeBasePtr getNode(int index);
 
+    //! \return The node or nullptr if the handle is stale or wasn't issued by this graph. O(1), no refcounting.
+    NodeBase * getNode(NodeId id) const;
+
+    //! \return Handle of the node with the given index or an invalid handle if no such node.
+    NodeId getNodeId(int index) const;
+
+    //! \return True if the handle refers to a node currently in this graph.
+    bool contains(NodeId id) const;
+
     const NodeVector & getNodes() const;
 
     NodeVector getNodesConnectedToNode(NodeBasePtr node);
 
+    //! \return Id of the connected component (edge directions ignored) of the given node. Maintained incrementally.
+    uint32_t componentId(NodeId id) const;
+
+    //! \return Number of nodes in the connected component of the given node, or 0 if the handle is stale.
+    size_t componentSize(NodeId id) const;
+
+    size_t componentCount() const;
+
+    /*! \return Current state of the graph as plain data. Node i and edge i correspond to getNodes().at(i) and
+     *  getEdges().at(i). The records are maintained as the graph changes and shared with earlier snapshots,
+     *  so this costs O(number of changed items since the previous call) and the snapshot itself is O(1) to copy. */
+    GraphSnapshot snapshot();
+
+    //! Geometry of all nodes. Slot i corresponds to getNodes().at(i).
+    const NodeGeometryTable & geometry() const;
+
 private:
+    friend class EdgeBase;
+
+    friend class NodeBase;
+
+    //! Called by the node when its persistent state changes
+    void markChanged(const NodeBase & node, GraphChange::Type type);
+
+    //! Called by the edge when its persistent state changes
+    void markChanged(const EdgeBase & edge);
+
+    using EdgeKey = uint64_t;
+
+    static GraphChange nodeChange(GraphChange::Type type, const NodeBase & node);
+
+    static GraphChange edgeChange(GraphChange::Type type, const EdgeBase & edge);
+
+    void publishChanges();
+
+    static EdgeKey edgeKey(NodeId sourceId, NodeId targetId);
+
+    static EdgeKey edgeKey(const EdgeBase & edge);
+
+    bool isMember(const NodeBase & node) const;
+
+    NodeId allocateSlot(size_t position);
+
+    void releaseSlot(NodeId id);
+
+    bool insertNode(NodeBasePtr node);
+
+    bool insertEdge(EdgeBasePtr edge);
+
+    void removeEdgeAt(size_t position);
+
+    void removeFromAdjacency(EdgeVector & edges, const EdgeBase * edge);
+
+    void createComponent(uint32_t slot);
+
+    void joinComponents(uint32_t slot0, uint32_t slot1);
+
+    void splitComponents(std::vector<uint32_t> candidates);
+
+    bool splitIfDisconnected(uint32_t slot0, uint32_t slot1);
+
+    bool visitNeighbors(uint32_t slot, uint32_t stamp, uint32_t otherStamp, std::vector<uint32_t> & visited);
+
+    uint32_t nextVisitStamp();
+
+    static EdgeView view(const EdgeVector & edges);
+
     NodeVector m_nodes;
 
     EdgeVector m_edges;
 
+    struct Slot
+    {
+        uint32_t generation = 0;
+
+        //! Position in m_nodes
+        size_t position = 0;
+
+        bool used = false;
+
+        //! Node has changed since the previous snapshot
+        bool changed = false;
+
+        uint32_t component = 0;
+
+        //! Scratch marker for traversals
+        uint32_t visitStamp = 0;
+    };
+
+    //! NodeId::slot() => Slot
+    std::vector<Slot> m_slots;
+
+    std::vector<uint32_t> m_freeSlots;
+
+    //! Component id => number of nodes
+    std::unordered_map<uint32_t, size_t> m_componentSizes;
+
+    uint32_t m_nextComponentId = 0;
+
+    uint32_t m_visitStamp = 0;
+
+    //! Persistent node index => handle
+    std::unordered_map<int, NodeId> m_indexMap;
+
+    //! (source slot, target slot) => position in m_edges. Also used to reject duplicate edges.
+    std::unordered_map<EdgeKey, size_t> m_edgeMap;
+
+    //! NodeId::slot() => edges starting from that node
+    std::vector<EdgeVector> m_edgesFrom;
+
+    //! NodeId::slot() => edges ending to that node
+    std::vector<EdgeVector> m_edgesTo;
+
+    NodeGeometryTable m_geometry;
+
+    GraphSnapshot m_snapshot;
+
+    std::vector<uint32_t> m_changedNodes;
+
+    std::unordered_set<EdgeKey> m_changedEdges;
+
+    std::vector<std::pair<size_t, ChangeObserver>> m_observers;
+
+    size_t m_nextObserverId = 0;
+
+    int m_transactionDepth = 0;
+
+    ChangeBatch m_pendingChanges;
+
+    //! (type, node, target node) of the changes in m_pendingChanges that are reported only once per batch
+    std::set<std::tuple<int, uint64_t, uint64_t>> m_pendingChangeKeys;
+
+    NodeVector m_pendingNodes;
+
+    EdgeVector m_pendingEdges;
+
     int m_count = 0;
 };
 
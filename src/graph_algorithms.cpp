@@ -0,0 +1,275 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_algorithms.hpp"
+#include "graph.hpp"
+#include "graph_snapshot.hpp"
+#include "parallel.hpp"
+
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+void countDegree(std::vector<size_t> & histogram, size_t degree)
+{
+    if (degree >= histogram.size()) {
+        histogram.resize(degree + 1);
+    }
+    histogram[degree]++;
+}
+
+void addHistogram(std::vector<size_t> & result, const std::vector<size_t> & partial)
+{
+    result.resize(std::max(result.size(), partial.size()));
+    for (size_t degree = 0; degree < partial.size(); degree++) {
+        result[degree] += partial[degree];
+    }
+}
+
+} // namespace
+
+namespace GraphAlgorithms {
+
+std::vector<NodeId> subtree(const Graph & graph, NodeId root, Order order)
+{
+    std::vector<NodeId> result;
+    if (!graph.contains(root)) {
+        return result;
+    }
+
+    std::unordered_set<NodeId> visited;
+    if (order == Order::BreadthFirst) {
+        visited.insert(root);
+        result.push_back(root);
+        for (size_t i = 0; i < result.size(); i++) {
+            for (auto && edge : graph.edgesFrom(result.at(i))) {
+                const auto target = edge->targetNodeBase().id();
+                if (visited.insert(target).second) {
+                    result.push_back(target);
+                }
+            }
+        }
+    } else {
+        std::vector<NodeId> stack = { root };
+        while (!stack.empty()) {
+            const auto id = stack.back();
+            stack.pop_back();
+            if (visited.insert(id).second) {
+                result.push_back(id);
+                // Push in reverse so that children are visited in edge order
+                const auto edges = graph.edgesFrom(id);
+                for (size_t i = edges.size(); i > 0; i--) {
+                    const auto target = edges[i - 1]->targetNodeBase().id();
+                    if (!visited.count(target)) {
+                        stack.push_back(target);
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<NodeId> component(const Graph & graph, NodeId node)
+{
+    std::vector<NodeId> result;
+    if (!graph.contains(node)) {
+        return result;
+    }
+
+    result.reserve(graph.componentSize(node));
+    result.push_back(node);
+    std::unordered_set<NodeId> visited = { node };
+    for (size_t i = 0; i < result.size(); i++) {
+        for (auto && edge : graph.edgesFrom(result.at(i))) {
+            const auto target = edge->targetNodeBase().id();
+            if (visited.insert(target).second) {
+                result.push_back(target);
+            }
+        }
+        for (auto && edge : graph.edgesTo(result.at(i))) {
+            const auto source = edge->sourceNodeBase().id();
+            if (visited.insert(source).second) {
+                result.push_back(source);
+            }
+        }
+    }
+
+    return result;
+}
+
+std::unordered_map<NodeId, size_t> depths(const Graph & graph, NodeId root)
+{
+    std::unordered_map<NodeId, size_t> result;
+    if (!graph.contains(root)) {
+        return result;
+    }
+
+    std::vector<NodeId> queue = { root };
+    result[root] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+        const auto depth = result.at(queue.at(i)) + 1;
+        for (auto && edge : graph.edgesFrom(queue.at(i))) {
+            const auto target = edge->targetNodeBase().id();
+            if (result.emplace(target, depth).second) {
+                queue.push_back(target);
+            }
+        }
+    }
+
+    return result;
+}
+
+NodeId root(const Graph & graph, NodeId node)
+{
+    if (!graph.contains(node)) {
+        return {};
+    }
+
+    std::unordered_set<NodeId> visited = { node };
+    while (graph.inDegree(node)) {
+        const auto parent = graph.edgesTo(node)[0]->sourceNodeBase().id();
+        if (!visited.insert(parent).second) {
+            break;
+        }
+        node = parent;
+    }
+
+    return node;
+}
+
+std::vector<NodeId> roots(const Graph & graph)
+{
+    auto && nodes = graph.getNodes();
+    return Parallel::blockingMapReduce<std::vector<NodeId>>(
+      nodes.size(),
+      [&](size_t begin, size_t end) {
+          std::vector<NodeId> roots;
+          for (size_t i = begin; i < end; i++) {
+              if (!graph.inDegree(nodes[i]->id())) {
+                  roots.push_back(nodes[i]->id());
+              }
+          }
+          return roots;
+      },
+      [](std::vector<NodeId> & result, const std::vector<NodeId> & partial) {
+          result.insert(result.end(), partial.begin(), partial.end());
+      });
+}
+
+std::vector<size_t> degreeHistogram(const Graph & graph)
+{
+    auto && nodes = graph.getNodes();
+    return Parallel::blockingMapReduce<std::vector<size_t>>(
+      nodes.size(),
+      [&](size_t begin, size_t end) {
+          std::vector<size_t> histogram;
+          for (size_t i = begin; i < end; i++) {
+              countDegree(histogram, graph.inDegree(nodes[i]->id()) + graph.outDegree(nodes[i]->id()));
+          }
+          return histogram;
+      },
+      addHistogram);
+}
+
+QFuture<std::vector<size_t>> degreeHistogram(const GraphSnapshot & snapshot)
+{
+    // Copying the snapshot is O(1) and the copy is not affected by later changes to the graph. The copy is made
+    // here in the calling thread and released by the task, as PersistentVector allows.
+    return QtConcurrent::run([snapshot]() {
+        // The edges refer to the nodes by index
+        std::unordered_map<int, size_t> degrees;
+        for (size_t i = 0; i < snapshot.edges.size(); i++) {
+            degrees[snapshot.edges.at(i).sourceIndex]++;
+            degrees[snapshot.edges.at(i).targetIndex]++;
+        }
+
+        return Parallel::blockingMapReduce<std::vector<size_t>>(
+          snapshot.nodes.size(),
+          [&](size_t begin, size_t end) {
+              std::vector<size_t> histogram;
+              for (size_t i = begin; i < end; i++) {
+                  const auto degree = degrees.find(snapshot.nodes.at(i).index);
+                  countDegree(histogram, degree != degrees.end() ? degree->second : 0);
+              }
+              return histogram;
+          },
+          addHistogram);
+    });
+}
+
+namespace {
+
+enum class Mark
+{
+    Active,
+    Done
+};
+
+bool hasCycle(const Graph & graph, NodeId root, std::unordered_map<NodeId, Mark> & marks)
+{
+    if (marks.count(root)) {
+        return false;
+    }
+
+    // Iterative depth-first search: an edge to an active node closes a cycle
+    std::vector<std::pair<NodeId, size_t>> stack = { { root, 0 } };
+    marks[root] = Mark::Active;
+    while (!stack.empty()) {
+        auto && top = stack.back();
+        const auto edges = graph.edgesFrom(top.first);
+        if (top.second < edges.size()) {
+            const auto target = edges[top.second++]->targetNodeBase().id();
+            const auto iter = marks.find(target);
+            if (iter == marks.end()) {
+                marks[target] = Mark::Active;
+                stack.push_back({ target, 0 });
+            } else if (iter->second == Mark::Active) {
+                return true;
+            }
+        } else {
+            marks[top.first] = Mark::Done;
+            stack.pop_back();
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+bool hasCycle(const Graph & graph, NodeId root)
+{
+    std::unordered_map<NodeId, Mark> marks;
+    return hasCycle(graph, root, marks);
+}
+
+bool hasCycle(const Graph & graph)
+{
+    std::unordered_map<NodeId, Mark> marks;
+    for (auto && node : graph.getNodes()) {
+        if (hasCycle(graph, node->id(), marks)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace GraphAlgorithms
@@ -0,0 +1,72 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_ALGORITHMS_HPP
+#define GRAPH_ALGORITHMS_HPP
+
+#include "node_id.hpp"
+
+#include <QFuture>
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class Graph;
+struct GraphSnapshot;
+
+//! Traversals over the edges of a Graph. All functions take time proportional to the part of the graph they visit.
+//! Connected components are not computed here as Graph maintains them incrementally, see Graph::componentId().
+namespace GraphAlgorithms {
+
+enum class Order
+{
+    BreadthFirst,
+    DepthFirst
+};
+
+//! \return The given node and all nodes reachable from it via outgoing edges, each only once.
+std::vector<NodeId> subtree(const Graph & graph, NodeId root, Order order = Order::BreadthFirst);
+
+//! \return All nodes in the same connected component as the given node, edge directions ignored.
+std::vector<NodeId> component(const Graph & graph, NodeId node);
+
+//! \return Nodes of the subtree of the given root mapped to their distance from the root.
+std::unordered_map<NodeId, size_t> depths(const Graph & graph, NodeId root);
+
+//! \return Root of the given node found by following incoming edges. On a cycle the walk stops at the
+//! node where the cycle would be re-entered.
+NodeId root(const Graph & graph, NodeId node);
+
+//! \return All nodes without incoming edges in the order of Graph::getNodes(). Runs in parallel on large graphs.
+std::vector<NodeId> roots(const Graph & graph);
+
+//! \return Number of nodes by degree (incoming plus outgoing edges), i.e. item i is the number of nodes
+//! with i edges. Runs in parallel on large graphs and blocks until done.
+std::vector<size_t> degreeHistogram(const Graph & graph);
+
+//! Like degreeHistogram(const Graph &), but runs on the snapshot in the background and returns at once,
+//! so that the graph can change meanwhile. Use a QFutureWatcher to get the result in the GUI thread.
+QFuture<std::vector<size_t>> degreeHistogram(const GraphSnapshot & snapshot);
+
+//! \return True if there is a directed cycle reachable from the given node.
+bool hasCycle(const Graph & graph, NodeId root);
+
+//! \return True if there is a directed cycle anywhere in the graph.
+bool hasCycle(const Graph & graph);
+
+} // namespace GraphAlgorithms
+
+#endif // GRAPH_ALGORITHMS_HPP
@@ -0,0 +1,59 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_CHANGE_HPP
+#define GRAPH_CHANGE_HPP
+
+#include "node_id.hpp"
+
+//! A single change in a Graph or in the map-wide state of its MindMapData, as delivered to change observers.
+struct GraphChange
+{
+    enum class Type
+    {
+        NodeAdded,
+        NodeRemoved,
+        NodeMoved,
+        NodeChanged,
+        EdgeAdded,
+        EdgeRemoved,
+        EdgeChanged,
+        StyleChanged,
+        Cleared
+    };
+
+    GraphChange(Type type, NodeId node = {}, int index = -1, NodeId targetNode = {}, int targetIndex = -1)
+      : type(type)
+      , node(node)
+      , index(index)
+      , targetNode(targetNode)
+      , targetIndex(targetIndex)
+    {
+    }
+
+    Type type;
+
+    //! The node of a node change or the source node of an edge change. Stale for removals.
+    NodeId node;
+
+    int index = -1;
+
+    //! The target node of an edge change
+    NodeId targetNode;
+
+    int targetIndex = -1;
+};
+
+#endif // GRAPH_CHANGE_HPP
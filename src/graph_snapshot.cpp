@@ -0,0 +1,141 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_snapshot.hpp"
+#include "node_base.hpp"
+
+NodeRecord::NodeRecord(const NodeBase & node)
+  : index(node.index())
+  , text(node.text())
+  , color(node.color())
+  , textColor(node.textColor())
+  , textSize(node.textSize())
+  , cornerRadius(node.cornerRadius())
+  , location(node.location())
+  , size(node.size())
+  , imageRef(node.imageRef())
+{
+}
+
+void NodeRecord::applyTo(NodeBase & node) const
+{
+    node.setColor(color);
+
+    node.setCornerRadius(cornerRadius);
+
+    node.setImageRef(imageRef);
+
+    node.setIndex(index);
+
+    node.setLocation(location);
+
+    node.setSize(size);
+
+    node.setText(text);
+
+    node.setTextColor(textColor);
+
+    node.setTextSize(textSize);
+}
+
+void NodeRecord::applyTo(NodeBase & node, const NodeRecord & current) const
+{
+    if (color != current.color) {
+        node.setColor(color);
+    }
+
+    if (cornerRadius != current.cornerRadius) {
+        node.setCornerRadius(cornerRadius);
+    }
+
+    if (imageRef != current.imageRef) {
+        node.setImageRef(imageRef);
+    }
+
+    if (location != current.location) {
+        node.setLocation(location);
+    }
+
+    if (size != current.size) {
+        node.setSize(size);
+    }
+
+    if (text != current.text) {
+        node.setText(text);
+    }
+
+    if (textColor != current.textColor) {
+        node.setTextColor(textColor);
+    }
+
+    if (textSize != current.textSize) {
+        node.setTextSize(textSize);
+    }
+}
+
+bool NodeRecord::operator==(const NodeRecord & other) const
+{
+    return index == other.index && text == other.text && color == other.color && textColor == other.textColor && textSize == other.textSize
+      && cornerRadius == other.cornerRadius && location == other.location && size == other.size && imageRef == other.imageRef;
+}
+
+bool NodeRecord::operator!=(const NodeRecord & other) const
+{
+    return !(*this == other);
+}
+
+EdgeRecord::EdgeRecord(const EdgeBase & edge)
+  : sourceIndex(edge.sourceNodeBase().index())
+  , targetIndex(edge.targetNodeBase().index())
+  , text(edge.text())
+  , arrowMode(edge.arrowMode())
+  , reversed(edge.reversed())
+{
+}
+
+void EdgeRecord::applyTo(EdgeBase & edge) const
+{
+    edge.setArrowMode(arrowMode);
+
+    edge.setText(text);
+
+    edge.setReversed(reversed);
+}
+
+void EdgeRecord::applyTo(EdgeBase & edge, const EdgeRecord & current) const
+{
+    if (arrowMode != current.arrowMode) {
+        edge.setArrowMode(arrowMode);
+    }
+
+    if (text != current.text) {
+        edge.setText(text);
+    }
+
+    if (reversed != current.reversed) {
+        edge.setReversed(reversed);
+    }
+}
+
+bool EdgeRecord::operator==(const EdgeRecord & other) const
+{
+    return sourceIndex == other.sourceIndex && targetIndex == other.targetIndex && text == other.text && arrowMode == other.arrowMode
+      && reversed == other.reversed;
+}
+
+bool EdgeRecord::operator!=(const EdgeRecord & other) const
+{
+    return !(*this == other);
+}
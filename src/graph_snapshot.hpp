@@ -0,0 +1,100 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GRAPH_SNAPSHOT_HPP
+#define GRAPH_SNAPSHOT_HPP
+
+#include "edge_base.hpp"
+#include "persistent_vector.hpp"
+
+#include <QColor>
+#include <QPointF>
+#include <QSizeF>
+#include <QString>
+
+class NodeBase;
+
+//! Persistent state of a node as plain data, without any graphics objects.
+struct NodeRecord
+{
+    NodeRecord() = default;
+
+    explicit NodeRecord(const NodeBase & node);
+
+    void applyTo(NodeBase & node) const;
+
+    //! Applies only the fields that differ from the current state of the node, so that the unchanged
+    //! properties keep their caches, e.g. the text layout and the image.
+    void applyTo(NodeBase & node, const NodeRecord & current) const;
+
+    bool operator==(const NodeRecord & other) const;
+
+    bool operator!=(const NodeRecord & other) const;
+
+    int index = -1;
+
+    QString text;
+
+    QColor color;
+
+    QColor textColor;
+
+    int textSize = 0;
+
+    int cornerRadius = 0;
+
+    QPointF location;
+
+    QSizeF size;
+
+    size_t imageRef = 0;
+};
+
+//! Persistent state of an edge as plain data. The endpoints are referred to by node indices.
+struct EdgeRecord
+{
+    EdgeRecord() = default;
+
+    explicit EdgeRecord(const EdgeBase & edge);
+
+    void applyTo(EdgeBase & edge) const;
+
+    //! Applies only the fields that differ from the current state of the edge.
+    void applyTo(EdgeBase & edge, const EdgeRecord & current) const;
+
+    bool operator==(const EdgeRecord & other) const;
+
+    bool operator!=(const EdgeRecord & other) const;
+
+    int sourceIndex = -1;
+
+    int targetIndex = -1;
+
+    QString text;
+
+    EdgeBase::ArrowMode arrowMode = EdgeBase::ArrowMode::Single;
+
+    bool reversed = false;
+};
+
+//! Immutable state of a Graph. Copying is O(1) as the records are shared with the graph until either side changes.
+struct GraphSnapshot
+{
+    PersistentVector<NodeRecord> nodes;
+
+    PersistentVector<EdgeRecord> edges;
+};
+
+#endif // GRAPH_SNAPSHOT_HPP
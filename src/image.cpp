@@ -25,9 +25,25 @@ Image::Image(QImage image, std::string path)
 {
 }
 
+Image::Image(QByteArray data, std::string path)
+  : m_data(data)
+  , m_path(path)
+{
+}
+
 QImage Image::image() const
 {
-    return m_image;
+    return isDecoded() ? m_image : QImage::fromData(m_data);
+}
+
+QByteArray Image::data() const
+{
+    return m_data;
+}
+
+bool Image::isDecoded() const
+{
+    return m_data.isEmpty();
 }
 
 std::string Image::path() const
@@ -16,6 +16,7 @@
 #ifndef IMAGE_HPP
 #define IMAGE_HPP
 
+#include <QByteArray>
 #include <QImage>
 
 #include <string>
@@ -27,8 +28,17 @@ public:
 
     Image(QImage image, std::string path);
 
+    //! Image from the contents of an image file, e.g. one embedded in a mind map. It's decoded only when needed.
+    Image(QByteArray data, std::string path);
+
+    //! \return The image. Decodes the data if not decoded yet, which may take a while for large images.
     QImage image() const;
 
+    //! \return Contents of the image file if the image is not decoded yet.
+    QByteArray data() const;
+
+    bool isDecoded() const;
+
     std::string path() const;
 
     size_t id() const;
@@ -38,6 +48,8 @@ public:
 private:
     QImage m_image;
 
+    QByteArray m_data;
+
     std::string m_path;
 
     size_t m_id = 0;
@@ -17,6 +17,9 @@
 #include "contrib/SimpleLogger/src/simple_logger.hpp"
 #include "node.hpp"
 
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
 ImageManager::ImageManager()
 {
 }
@@ -26,7 +29,9 @@ void ImageManager::clear()
     juzzlin::L().debug() << "Clearing ImageManager";
 
     m_images.clear();
+    m_pendingRequests.clear();
     m_count = 0;
+    m_generation++;
 }
 
 size_t ImageManager::addImage(const Image & image)
@@ -62,12 +67,78 @@ std::pair<Image, bool> ImageManager::getImage(size_t id)
 
 void ImageManager::handleImageRequest(size_t id, Node & node)
 {
-    const auto && imagePair = getImage(id);
-    if (imagePair.second) {
-        juzzlin::L().debug() << "Applying image id=" << id << " to node " << node.index();
-        node.applyImage(imagePair.first);
-    } else {
+    const auto image = m_images.find(id);
+    if (image == m_images.end()) {
         juzzlin::L().warning() << "Cannot find image with id=" << id;
+        return;
+    }
+
+    if (image->second.isDecoded()) {
+        juzzlin::L().debug() << "Applying image id=" << id << " to node " << node.index();
+        node.applyImage(image->second);
+        return;
+    }
+
+    // Only the first request starts decoding, later ones just wait for it
+    auto && requests = m_pendingRequests[id];
+    requests.push_back(&node);
+    if (requests.size() == 1) {
+        juzzlin::L().debug() << "Decoding image id=" << id;
+        const auto generation = m_generation;
+        const auto watcher = new QFutureWatcher<QImage>(this);
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, id, generation, watcher] {
+            if (generation == m_generation) {
+                applyDecodedImage(id, watcher->result());
+            }
+            watcher->deleteLater();
+        });
+        watcher->setFuture(decode(image->second));
+    }
+}
+
+void ImageManager::decodeAll()
+{
+    std::vector<std::pair<size_t, QFuture<QImage>>> decodes;
+    for (auto && image : m_images) {
+        if (!image.second.isDecoded()) {
+            decodes.push_back({ image.first, decode(image.second) });
+        }
+    }
+
+    for (auto && pending : decodes) {
+        applyDecodedImage(pending.first, pending.second.result());
+    }
+}
+
+QFuture<QImage> ImageManager::decode(const Image & image)
+{
+    const auto data = image.data();
+    return QtConcurrent::run([data] {
+        return QImage::fromData(data);
+    });
+}
+
+void ImageManager::applyDecodedImage(size_t id, QImage decodedImage)
+{
+    const auto image = m_images.find(id);
+    if (image != m_images.end() && !image->second.isDecoded()) {
+        Image decoded(decodedImage, image->second.path());
+        decoded.setId(id);
+        image->second = decoded;
+    }
+
+    const auto requests = m_pendingRequests.find(id);
+    if (requests != m_pendingRequests.end()) {
+        const auto nodes = requests->second;
+        m_pendingRequests.erase(requests);
+        if (image != m_images.end()) {
+            for (auto && node : nodes) {
+                // The node may have been deleted or got another image meanwhile
+                if (node && node->imageRef() == id) {
+                    node->applyImage(image->second);
+                }
+            }
+        }
     }
 }
 
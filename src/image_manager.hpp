@@ -16,9 +16,12 @@
 #ifndef IMAGE_MANAGER_HPP
 #define IMAGE_MANAGER_HPP
 
+#include <QFuture>
 #include <QObject>
+#include <QPointer>
 
 #include <map>
+#include <vector>
 
 #include "image.hpp"
 
@@ -39,15 +42,30 @@ public:
 
     std::pair<Image, bool> getImage(size_t id);
 
+    /*! Applies the image to the node. Images that are not decoded yet are decoded in the global thread pool
+     *  and applied when done, so that the nodes can be shown without waiting for their images. */
     void handleImageRequest(size_t id, Node & node);
 
+    //! Decodes all images that are not decoded yet in parallel and applies them. Blocks until done.
+    void decodeAll();
+
     using ImageVector = std::vector<Image>;
     ImageVector images() const;
 
 private:
+    static QFuture<QImage> decode(const Image & image);
+
+    void applyDecodedImage(size_t id, QImage decodedImage);
+
     std::map<size_t, Image> m_images;
 
+    //! Image id => nodes waiting for the image to be decoded
+    std::map<size_t, std::vector<QPointer<Node>>> m_pendingRequests;
+
     size_t m_count = 0;
+
+    //! Incremented on clear(), so that decodes started before are ignored
+    size_t m_generation = 0;
 };
 
 #endif // IMAGE_MANAGER_HPP
@@ -15,24 +15,18 @@
 
 #include "magic_zoom.hpp"
 
-#include "editor_scene.hpp"
-#include "node.hpp"
+#include "node_geometry_table.hpp"
 
+#include <algorithm>
 #include <cmath>
 
-QRectF MagicZoom::calculateRectangle(const EditorScene & scene, bool isForExport)
+QRectF MagicZoom::calculateRectangle(const NodeGeometryColumns & geometry, bool isForExport)
 {
-    double nodeArea = 0;
-    QRectF rect;
-    int nodes = 0;
-    for (auto && item : scene.items()) {
-        if (auto node = dynamic_cast<Node *>(item)) {
-            const auto nodeRect = node->placementBoundingRect();
-            rect = rect.united(nodeRect.translated(node->pos().x(), node->pos().y()));
-            nodeArea += nodeRect.width() * nodeRect.height();
-            nodes++;
-        }
-    }
+    const auto rect = geometry.boundingRect();
+
+    const double nodeArea = geometry.nodeArea();
+
+    const auto nodes = static_cast<int>(geometry.size());
 
     const int margin = 60;
 
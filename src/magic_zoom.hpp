@@ -18,11 +18,12 @@
 
 #include <QRectF>
 
-class EditorScene;
+struct NodeGeometryColumns;
 
 namespace MagicZoom {
 
-QRectF calculateRectangle(const EditorScene & scene, bool isForExport);
+//! Blocks until done, so zoom-to-fit runs it on a copy of the geometry in the background.
+QRectF calculateRectangle(const NodeGeometryColumns & geometry, bool isForExport);
 
 } // namespace MagicZoom
 
@@ -444,6 +444,12 @@ void MainWindow::disableUndoAndRedo()
     m_redoAction->setEnabled(false);
 }
 
+void MainWindow::updateUndoAndRedo()
+{
+    m_undoAction->setEnabled(m_mediator->isUndoable());
+    m_redoAction->setEnabled(m_mediator->isRedoable());
+}
+
 void MainWindow::setCornerRadius(int value)
 {
     if (m_cornerRadiusSpinBox->value() != value) {
@@ -507,8 +513,7 @@ void MainWindow::saveWindowSize()
 
 void MainWindow::setupMindMapAfterUndoOrRedo()
 {
-    m_undoAction->setEnabled(m_mediator->isUndoable());
-    m_redoAction->setEnabled(m_mediator->isRedoable());
+    updateUndoAndRedo();
 
     m_mediator->setupMindMapAfterUndoOrRedo();
 }
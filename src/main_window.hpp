@@ -52,6 +52,9 @@ public:
 
     void disableUndoAndRedo();
 
+    //! Enables undo and redo according to the history, e.g. after a history was restored on open.
+    void updateUndoAndRedo();
+
     void initialize();
 
     void initializeNewMindMap();
@@ -15,18 +15,23 @@
 
 #include "mediator.hpp"
 
+#include "constants.hpp"
 #include "editor_data.hpp"
 #include "editor_scene.hpp"
 #include "editor_view.hpp"
 #include "image_manager.hpp"
+#include "magic_zoom.hpp"
 #include "main_window.hpp"
 #include "mouse_action.hpp"
+#include "node_geometry_table.hpp"
 
 #include "simple_logger.hpp"
 
+#include <QFutureWatcher>
 #include <QGraphicsItem>
 #include <QGraphicsScene>
 #include <QSizePolicy>
+#include <QtConcurrentRun>
 
 #include <cassert>
 
@@ -45,32 +50,23 @@ void Mediator::addExistingGraphToScene()
 {
     for (auto && node : m_editorData->mindMapData()->graph().getNodes()) {
         if (dynamic_pointer_cast<QGraphicsItem>(node)->scene() != m_editorScene.get()) {
-            auto graphicsNode = dynamic_pointer_cast<Node>(node);
-            addItem(*graphicsNode);
-            graphicsNode->setCornerRadius(m_editorData->mindMapData()->cornerRadius());
-            graphicsNode->setTextSize(m_editorData->mindMapData()->textSize());
-            L().debug() << "Added existing node " << node->index() << " to scene";
+            addNodeToScene(*dynamic_pointer_cast<Node>(node));
         }
     }
 
     for (auto && edge : m_editorData->mindMapData()->graph().getEdges()) {
-        auto node0 = dynamic_pointer_cast<Node>(getNodeByIndex(edge->sourceNodeBase().index()));
-        auto node1 = dynamic_pointer_cast<Node>(getNodeByIndex(edge->targetNodeBase().index()));
-
-        if (!m_editorScene->hasEdge(*node0, *node1)) {
-            auto graphicsEdge = dynamic_pointer_cast<Edge>(edge);
-            assert(graphicsEdge);
-            addItem(*graphicsEdge);
-            graphicsEdge->setColor(m_editorData->mindMapData()->edgeColor());
-            graphicsEdge->setWidth(m_editorData->mindMapData()->edgeWidth());
-            graphicsEdge->setTextSize(m_editorData->mindMapData()->textSize());
-            node0->addGraphicsEdge(*graphicsEdge);
-            node1->addGraphicsEdge(*graphicsEdge);
-            graphicsEdge->updateLine();
-            L().debug() << "Added existing edge " << node0->index() << " -> " << node1->index() << " to scene";
+        auto graphicsEdge = dynamic_pointer_cast<Edge>(edge);
+        assert(graphicsEdge);
+        if (graphicsEdge->scene() != m_editorScene.get()) {
+            addEdgeToScene(*graphicsEdge);
         }
     }
 
+    updateSettingsFromMindMap();
+}
+
+void Mediator::updateSettingsFromMindMap()
+{
     m_mainWindow.setCornerRadius(m_editorData->mindMapData()->cornerRadius());
     m_mainWindow.setEdgeWidth(m_editorData->mindMapData()->edgeWidth());
     m_mainWindow.setTextSize(m_editorData->mindMapData()->textSize());
@@ -83,10 +79,20 @@ void Mediator::addExistingGraphToScene()
 void Mediator::addEdge(Node & node1, Node & node2)
 {
     // Add edge from node1 to node2
-    connectEdgeToUndoMechanism(m_editorData->addEdge(std::make_shared<Edge>(node1, node2)));
+    m_editorData->addEdge(std::make_shared<Edge>(node1, node2));
     L().debug() << "Created a new edge " << node1.index() << " -> " << node2.index();
+}
 
-    addExistingGraphToScene();
+void Mediator::addEdgeToScene(Edge & edge)
+{
+    addItem(edge);
+    edge.setColor(m_editorData->mindMapData()->edgeColor());
+    edge.setWidth(m_editorData->mindMapData()->edgeWidth());
+    edge.setTextSize(m_editorData->mindMapData()->textSize());
+    edge.sourceNode().addGraphicsEdge(edge);
+    edge.targetNode().addGraphicsEdge(edge);
+    edge.updateLine();
+    L().debug() << "Added edge " << edge.sourceNode().index() << " -> " << edge.targetNode().index() << " to scene";
 }
 
 void Mediator::addItem(QGraphicsItem & item)
@@ -94,6 +100,14 @@ void Mediator::addItem(QGraphicsItem & item)
     m_editorScene->addItem(&item);
 }
 
+void Mediator::addNodeToScene(Node & node)
+{
+    addItem(node);
+    node.setCornerRadius(m_editorData->mindMapData()->cornerRadius());
+    node.setTextSize(m_editorData->mindMapData()->textSize());
+    L().debug() << "Added node " << node.index() << " to scene";
+}
+
 void Mediator::clearSelectionGroup()
 {
     m_editorData->clearSelectionGroup();
@@ -104,14 +118,9 @@ bool Mediator::canBeSaved() const
     return !m_editorData->fileName().isEmpty();
 }
 
-void Mediator::clearScene()
+void Mediator::connectEdgeToUndoMechanism(Edge & edge)
 {
-    m_editorScene->initialize();
-}
-
-void Mediator::connectEdgeToUndoMechanism(EdgePtr edge)
-{
-    connect(edge.get(), &Edge::undoPointRequested, this, &Mediator::saveUndoPoint, Qt::UniqueConnection);
+    connect(&edge, &Edge::undoPointRequested, this, &Mediator::saveUndoPoint, Qt::UniqueConnection);
 }
 
 void Mediator::connectNodeToUndoMechanism(NodePtr node)
@@ -122,7 +131,7 @@ void Mediator::connectNodeToUndoMechanism(NodePtr node)
 void Mediator::connectNodeToImageManager(NodePtr node)
 {
     connect(node.get(), &Node::imageRequested, &m_editorData->mindMapData()->imageManager(), &ImageManager::handleImageRequest, Qt::UniqueConnection);
-    node->setImageRef(node->imageRef()); // This effectively results in a fetch from ImageManager
+    node->setImageRef(node->imageRef()); // This effectively results in a fetch from ImageManager when the node is painted
 }
 
 void Mediator::connectGraphToUndoMechanism()
@@ -132,7 +141,7 @@ void Mediator::connectGraphToUndoMechanism()
     }
 
     for (auto && edge : m_editorData->mindMapData()->graph().getEdges()) {
-        connectEdgeToUndoMechanism(std::dynamic_pointer_cast<Edge>(edge));
+        connectEdgeToUndoMechanism(*std::dynamic_pointer_cast<Edge>(edge));
     }
 }
 
@@ -143,23 +152,42 @@ void Mediator::connectGraphToImageManager()
     }
 }
 
+void Mediator::connectGraphToScene()
+{
+    // Items added after this get to the scene and get connected straight from the change stream, so single
+    // insertions, undo and redo don't need to walk the whole graph
+    auto && graph = m_editorData->mindMapData()->graph();
+    graph.addChangeObserver([this, &graph](const Graph::ChangeBatch & changes) {
+        for (auto && change : changes) {
+            if (change.type == GraphChange::Type::NodeAdded) {
+                if (const auto node = std::dynamic_pointer_cast<Node>(graph.getNode(change.index))) {
+                    addNodeToScene(*node);
+                    connectNodeToUndoMechanism(node);
+                    connectNodeToImageManager(node);
+                }
+            } else if (change.type == GraphChange::Type::EdgeAdded) {
+                if (const auto edge = dynamic_cast<Edge *>(graph.getEdge(change.node, change.targetNode))) {
+                    addEdgeToScene(*edge);
+                    connectEdgeToUndoMechanism(*edge);
+                }
+            }
+        }
+    });
+}
+
 NodeBasePtr Mediator::createAndAddNode(int sourceNodeIndex, QPointF pos)
 {
     auto node1 = m_editorData->addNodeAt(pos);
     assert(node1);
-    connectNodeToUndoMechanism(node1);
-    connectNodeToImageManager(node1);
     L().debug() << "Created a new node at (" << pos.x() << "," << pos.y() << ")";
 
     auto node0 = dynamic_pointer_cast<Node>(getNodeByIndex(sourceNodeIndex));
     assert(node0);
 
     // Add edge from the parent node.
-    connectEdgeToUndoMechanism(m_editorData->addEdge(std::make_shared<Edge>(*node0, *node1)));
+    m_editorData->addEdge(std::make_shared<Edge>(*node0, *node1));
     L().debug() << "Created a new edge " << node0->index() << " -> " << node1->index();
 
-    addExistingGraphToScene();
-
     node1->setTextInputActive();
 
     return std::move(node1); // Fix a static analyzer warning: avoid copy on older compilers
@@ -169,12 +197,8 @@ NodeBasePtr Mediator::createAndAddNode(QPointF pos)
 {
     auto node1 = m_editorData->addNodeAt(pos);
     assert(node1);
-    connectNodeToUndoMechanism(node1);
-    connectNodeToImageManager(node1);
     L().debug() << "Created a new node at (" << pos.x() << "," << pos.y() << ")";
 
-    addExistingGraphToScene();
-
     QTimer::singleShot(0, [node1]() { // Needed due to the context menu
         node1->setTextInputActive();
     });
@@ -186,12 +210,8 @@ NodeBasePtr Mediator::pasteNodeAt(Node & source, QPointF pos)
 {
     auto copiedNode = m_editorData->copyNodeAt(source, pos);
     assert(copiedNode);
-    connectNodeToUndoMechanism(copiedNode);
-    connectNodeToImageManager(copiedNode);
     L().debug() << "Pasted node at (" << pos.x() << "," << pos.y() << ")";
 
-    addExistingGraphToScene();
-
     QTimer::singleShot(0, [copiedNode]() { // Needed due to the context menu
         copiedNode->setTextInputActive();
     });
@@ -229,6 +249,15 @@ void Mediator::exportToPNG(QString filename, QSize size, bool transparentBackgro
     QImage image(size, QImage::Format_ARGB32);
     image.fill(transparentBackground ? Qt::transparent : m_editorData->backgroundColor());
 
+    // Nodes that were not shown yet have not got their images, as images are requested only when painted
+    auto && imageManager = m_editorData->mindMapData()->imageManager();
+    imageManager.decodeAll();
+    for (auto && node : m_editorData->mindMapData()->graph().getNodes()) {
+        if (node->imageRef()) {
+            imageManager.handleImageRequest(node->imageRef(), *std::dynamic_pointer_cast<Node>(node));
+        }
+    }
+
     QPainter painter(&image);
     painter.setRenderHint(QPainter::Antialiasing);
     painter.setRenderHint(QPainter::TextAntialiasing);
@@ -265,9 +294,9 @@ void Mediator::initializeNewMindMap()
 
     initializeView();
 
-    const auto node = m_editorData->addNodeAt(QPointF(0, 0));
-    connectNodeToUndoMechanism(node);
-    connectNodeToImageManager(node);
+    connectGraphToScene();
+
+    m_editorData->addNodeAt(QPointF(0, 0));
 
     addExistingGraphToScene();
 
@@ -294,22 +323,19 @@ void Mediator::initializeView()
 
 bool Mediator::areDirectlyConnected(const Node & node1, const Node & node2) const
 {
-    auto && graph = m_editorData->mindMapData()->graph();
-    auto node1Ptr = graph.getNode(node1.index());
-    auto node2Ptr = graph.getNode(node2.index());
-    return graph.areDirectlyConnected(node1Ptr, node2Ptr);
+    return m_editorData->mindMapData()->graph().areDirectlyConnected(node1.id(), node2.id());
 }
 
 bool Mediator::isLeafNode(Node & node)
 {
     auto && graph = m_editorData->mindMapData()->graph();
-    return graph.getEdgesFromNode(graph.getNode(node.index())).size() + graph.getEdgesToNode(graph.getNode(node.index())).size() <= 1;
+    return graph.inDegree(node.id()) + graph.outDegree(node.id()) <= 1;
 }
 
 bool Mediator::isInBetween(Node & node)
 {
     auto && graph = m_editorData->mindMapData()->graph();
-    return graph.getEdgesFromNode(graph.getNode(node.index())).size() + graph.getEdgesToNode(graph.getNode(node.index())).size() == 2;
+    return graph.inDegree(node.id()) + graph.outDegree(node.id()) == 2;
 }
 
 bool Mediator::isInSelectionGroup(Node & node)
@@ -355,6 +381,7 @@ bool Mediator::openMindMap(QString fileName)
 
         addExistingGraphToScene();
 
+        connectGraphToScene();
         connectGraphToUndoMechanism();
         connectGraphToImageManager();
 
@@ -402,6 +429,21 @@ void Mediator::saveUndoPoint()
     m_editorData->saveUndoPoint();
 }
 
+void Mediator::beginUndoTransaction()
+{
+    m_editorData->beginUndoTransaction();
+}
+
+void Mediator::endUndoTransaction()
+{
+    m_editorData->endUndoTransaction();
+}
+
+void Mediator::endAllUndoTransactions()
+{
+    m_editorData->endAllUndoTransactions();
+}
+
 QSize Mediator::sceneRectSize() const
 {
     return m_editorScene->sceneRect().size().toSize();
@@ -435,7 +477,8 @@ void Mediator::setCornerRadius(int value)
 {
     // Break loop with the spinbox
     if (m_editorData->mindMapData()->cornerRadius() != value) {
-        saveUndoPoint();
+        // Steps of the spin box make a single edit
+        m_editorData->saveUndoPoint("cornerRadius");
         m_editorData->mindMapData()->setCornerRadius(value);
         m_editorView->setCornerRadius(m_editorData->mindMapData()->cornerRadius());
     }
@@ -454,7 +497,8 @@ void Mediator::setEdgeWidth(double value)
 {
     // Break loop with the spinbox
     if (!qFuzzyCompare(m_editorData->mindMapData()->edgeWidth(), value)) {
-        saveUndoPoint();
+        // Steps of the spin box make a single edit
+        m_editorData->saveUndoPoint("edgeWidth");
         m_editorData->mindMapData()->setEdgeWidth(value);
         m_editorView->setEdgeWidth(m_editorData->mindMapData()->edgeWidth());
     }
@@ -464,8 +508,8 @@ void Mediator::setEditorData(std::shared_ptr<EditorData> editorData)
 {
     m_editorData = editorData;
 
-    connect(m_editorData.get(), &EditorData::sceneCleared, this, &Mediator::clearScene);
     connect(m_editorData.get(), &EditorData::undoEnabled, this, &Mediator::enableUndo);
+    connect(m_editorData.get(), &EditorData::bestOverlapNodeFound, this, &Mediator::bestOverlapNodeFound);
 }
 
 void Mediator::setEditorScene(std::shared_ptr<EditorScene> editorScene)
@@ -521,29 +565,19 @@ void Mediator::setTextSize(int textSize)
 {
     // Break loop with the spinbox
     if (m_editorData->mindMapData()->textSize() != textSize) {
-        saveUndoPoint();
+        // Steps of the spin box make a single edit
+        m_editorData->saveUndoPoint("textSize");
         m_editorData->mindMapData()->setTextSize(textSize);
     }
 }
 
 void Mediator::setupMindMapAfterUndoOrRedo()
 {
-    auto oldSceneRect = m_editorScene->sceneRect();
-    auto oldCenter = m_editorView->mapToScene(m_editorView->viewport()->rect()).boundingRect().center();
-
-    m_editorScene.reset(new EditorScene);
-    m_editorScene->initialize();
-
-    m_editorView->setScene(m_editorScene.get());
+    // Undo and redo modify the mind map in place and the graph observer keeps the scene in sync,
+    // so only the map-wide settings need to be refreshed
     m_editorView->setBackgroundBrush(QBrush(m_editorData->backgroundColor()));
 
-    addExistingGraphToScene();
-
-    connectGraphToUndoMechanism();
-    connectGraphToImageManager();
-
-    m_editorScene->setSceneRect(oldSceneRect);
-    m_editorView->centerOn(oldCenter);
+    updateSettingsFromMindMap();
 }
 
 void Mediator::undo()
@@ -570,36 +604,28 @@ QSize Mediator::zoomForExport()
 {
     clearSelectedNode();
     clearSelectionGroup();
-    m_editorScene->setSceneRect(m_editorScene->zoomToFit(true));
+    m_editorScene->setSceneRect(MagicZoom::calculateRectangle(m_editorData->mindMapData()->graph().geometry().columns(), true));
     return m_editorScene->sceneRect().size().toSize();
 }
 
 void Mediator::zoomToFit()
 {
     if (hasNodes()) {
-        m_editorView->zoomToFit(m_editorScene->zoomToFit());
-    }
-}
-
-double Mediator::calculateNodeOverlapScore(const Node & node1, const Node & node2) const
-{
-    if (&node1 == &node2) {
-        return 0;
-    }
-
-    const auto rect1 = node1.boundingRect().translated(node1.pos());
-    const auto rect2 = node2.boundingRect().translated(node2.pos());
-
-    if (rect1.intersects(rect2)) {
-        auto combined = rect1;
-        combined = combined.united(rect2);
-
-        const auto biggestArea = std::max(rect1.width() * rect1.height(), rect2.height() * rect2.width());
-
-        return biggestArea / combined.width() / combined.height();
+        // Calculated on a copy of the geometry in the background, so that large maps don't block the UI
+        const auto geometry = std::make_shared<const NodeGeometryColumns>(m_editorData->mindMapData()->graph().geometry().columns());
+        const auto generation = ++m_zoomToFitGeneration;
+        const auto watcher = new QFutureWatcher<QRectF>(this);
+        connect(watcher, &QFutureWatcher<QRectF>::finished, this, [this, generation, watcher] {
+            if (generation == m_zoomToFitGeneration) {
+                m_editorView->zoomToFit(watcher->result());
+                emit zoomedToFit();
+            }
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([geometry] {
+            return MagicZoom::calculateRectangle(*geometry, false);
+        }));
     }
-
-    return 0;
 }
 
 void Mediator::clearSelectedNode()
@@ -609,24 +635,14 @@ void Mediator::clearSelectedNode()
     }
 }
 
-NodePtr Mediator::getBestOverlapNode(const Node & source)
+void Mediator::findBestOverlapNode(const Node & source)
 {
-    NodePtr bestNode;
-    double bestScore = 0;
-
-    for (auto && nodeBase : m_editorData->mindMapData()->graph().getNodes()) {
-        if (const auto node = std::dynamic_pointer_cast<Node>(nodeBase)) {
-            if (node->index() != source.index() && node->index() != mouseAction().sourceNode()->index() && !areDirectlyConnected(*node, *mouseAction().sourceNode())) {
-                const auto score = calculateNodeOverlapScore(source, *node);
-                if (score > 0.75 && score > bestScore) {
-                    bestNode = node;
-                    bestScore = score;
-                }
-            }
-        }
-    }
+    m_editorData->findBestOverlapNode(source);
+}
 
-    return bestNode;
+NodePtr Mediator::bestOverlapNode(const Node & source)
+{
+    return m_editorData->bestOverlapNode(source);
 }
 
 Mediator::~Mediator() = default;
@@ -20,6 +20,8 @@
 #include <QPointF>
 #include <QString>
 
+#include <vector>
+
 #include "node.hpp"
 
 class MouseAction;
@@ -49,13 +51,16 @@ public:
 
     bool areDirectlyConnected(const Node & node1, const Node & node2) const;
 
+    //! Makes everything until the matching endUndoTransaction() a single edit, e.g. a drag.
+    void beginUndoTransaction();
+
     bool canBeSaved() const;
 
     void clearSelectedNode();
 
     void clearSelectionGroup();
 
-    void connectEdgeToUndoMechanism(EdgePtr edge);
+    void connectEdgeToUndoMechanism(Edge & edge);
 
     void connectNodeToUndoMechanism(NodePtr node);
 
@@ -73,9 +78,20 @@ public:
 
     void deleteNode(Node & node);
 
+    void endUndoTransaction();
+
+    //! Closes all open undo transactions, e.g. when a drag is aborted without the mouse release.
+    void endAllUndoTransactions();
+
     QString fileName() const;
 
-    NodePtr getBestOverlapNode(const Node & source);
+    /*! Finds the node that the source overlaps the most in the background, e.g. the dummy node of a new edge
+     *  being dragged. The result is delivered by bestOverlapNodeFound() unless a newer search was started or
+     *  the drag has ended. */
+    void findBestOverlapNode(const Node & source);
+
+    //! Like findBestOverlapNode(), but blocks and returns the result, e.g. for the final position when the drag ends.
+    NodePtr bestOverlapNode(const Node & source);
 
     NodeBasePtr getNodeByIndex(int index);
 
@@ -141,8 +157,6 @@ public:
 
 public slots:
 
-    void clearScene();
-
     void enableUndo(bool enable);
 
     void exportToPNG(QString filename, QSize size, bool transparentBackground);
@@ -171,17 +185,29 @@ private slots:
 
 signals:
 
+    //! The node is null if nothing overlaps enough.
+    void bestOverlapNodeFound(NodePtr node);
+
     void exportFinished(bool success);
 
+    //! The view has been zoomed to the rectangle calculated in the background by zoomToFit().
+    void zoomedToFit();
+
 private:
+    void addEdgeToScene(Edge & edge);
+
     void addExistingGraphToScene();
 
-    double calculateNodeOverlapScore(const Node & node1, const Node & node2) const;
+    void addNodeToScene(Node & node);
 
     void connectGraphToUndoMechanism();
 
     void connectGraphToImageManager();
 
+    void connectGraphToScene();
+
+    void updateSettingsFromMindMap();
+
     std::shared_ptr<EditorData> m_editorData;
 
     std::shared_ptr<EditorScene> m_editorScene;
@@ -189,6 +215,9 @@ private:
     EditorView * m_editorView = nullptr;
 
     MainWindow & m_mainWindow;
+
+    // Only the result of the latest background zoom-to-fit is used
+    size_t m_zoomToFitGeneration = 0;
 };
 
 #endif // MEDIATOR_HPP
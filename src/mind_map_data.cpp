@@ -26,39 +26,57 @@ MindMapData::MindMapData(QString name)
 {
 }
 
-MindMapData::MindMapData(const MindMapData & other)
-  : MindMapDataBase(other)
-  , m_fileName(other.m_fileName)
-  , m_version(other.m_version)
-  , m_backgroundColor(other.m_backgroundColor)
-  , m_edgeColor(other.m_edgeColor)
-  , m_edgeWidth(other.m_edgeWidth)
-  , m_textSize(other.m_textSize)
-  , m_cornerRadius(other.m_cornerRadius)
+MindMapData::MindMapData(const MindMapDataSnapshot & snapshot)
+  : MindMapDataBase(snapshot.name)
+  , m_fileName(snapshot.fileName)
+  , m_version(snapshot.version)
+  , m_backgroundColor(snapshot.backgroundColor)
+  , m_edgeColor(snapshot.edgeColor)
+  , m_edgeWidth(snapshot.edgeWidth)
+  , m_textSize(snapshot.textSize)
+  , m_cornerRadius(snapshot.cornerRadius)
 {
-    copyGraph(other);
+    restoreGraph(snapshot.graph);
 }
 
-void MindMapData::copyGraph(const MindMapData & other)
+MindMapDataSnapshot MindMapData::snapshot()
+{
+    MindMapDataSnapshot snapshot;
+    snapshot.name = name();
+    snapshot.fileName = m_fileName;
+    snapshot.version = m_version;
+    snapshot.backgroundColor = m_backgroundColor;
+    snapshot.edgeColor = m_edgeColor;
+    snapshot.edgeWidth = m_edgeWidth;
+    snapshot.textSize = m_textSize;
+    snapshot.cornerRadius = m_cornerRadius;
+    snapshot.graph = m_graph.snapshot();
+    return snapshot;
+}
+
+void MindMapData::restoreGraph(const GraphSnapshot & snapshot)
 {
     m_graph.clear();
+    m_graph.reserve(snapshot.nodes.size(), snapshot.edges.size());
 
-    // Use copy constructor for nodes
-    for (auto && nodeBase : other.m_graph.getNodes()) {
-        m_graph.addNode(std::make_shared<Node>(*std::dynamic_pointer_cast<Node>(nodeBase)));
+    for (size_t i = 0; i < snapshot.nodes.size(); i++) {
+        const auto node = std::make_shared<Node>();
+        snapshot.nodes.at(i).applyTo(*node);
+        m_graph.appendNode(node);
     }
-
-    // Create new edges
-    for (auto && edgeBase : other.m_graph.getEdges()) {
-        auto sourceNode = std::dynamic_pointer_cast<Node>(m_graph.getNode(edgeBase->sourceNodeBase().index()));
-        auto targetNode = std::dynamic_pointer_cast<Node>(m_graph.getNode(edgeBase->targetNodeBase().index()));
-
-        auto edge = std::make_shared<Edge>(*sourceNode, *targetNode);
-        edge->setArrowMode(edgeBase->arrowMode());
-        edge->setText(edgeBase->text());
-        edge->setReversed(edgeBase->reversed());
-        m_graph.addEdge(edge);
+    m_graph.finalize();
+
+    for (size_t i = 0; i < snapshot.edges.size(); i++) {
+        auto && record = snapshot.edges.at(i);
+        const auto sourceNode = std::dynamic_pointer_cast<Node>(m_graph.getNode(record.sourceIndex));
+        const auto targetNode = std::dynamic_pointer_cast<Node>(m_graph.getNode(record.targetIndex));
+        if (sourceNode && targetNode) {
+            const auto edge = std::make_shared<Edge>(*sourceNode, *targetNode);
+            record.applyTo(*edge);
+            m_graph.appendEdge(edge);
+        }
     }
+    m_graph.finalize();
 }
 
 QColor MindMapData::backgroundColor() const
@@ -69,6 +87,8 @@ QColor MindMapData::backgroundColor() const
 void MindMapData::setBackgroundColor(const QColor & backgroundColor)
 {
     m_backgroundColor = backgroundColor;
+
+    m_graph.reportChange({ GraphChange::Type::StyleChanged });
 }
 
 int MindMapData::cornerRadius() const
@@ -80,9 +100,12 @@ void MindMapData::setCornerRadius(int cornerRadius)
 {
     m_cornerRadius = cornerRadius;
 
+    m_graph.beginChanges();
     for (auto && node : m_graph.getNodes()) {
         node->setCornerRadius(cornerRadius);
     }
+    m_graph.reportChange({ GraphChange::Type::StyleChanged });
+    m_graph.endChanges();
 }
 
 QColor MindMapData::edgeColor() const
@@ -97,6 +120,8 @@ void MindMapData::setEdgeColor(const QColor & edgeColor)
     for (auto && edge : m_graph.getEdges()) {
         edge->setColor(edgeColor);
     }
+
+    m_graph.reportChange({ GraphChange::Type::StyleChanged });
 }
 
 double MindMapData::edgeWidth() const
@@ -111,6 +136,8 @@ void MindMapData::setEdgeWidth(double width)
     for (auto && edge : m_graph.getEdges()) {
         edge->setWidth(width);
     }
+
+    m_graph.reportChange({ GraphChange::Type::StyleChanged });
 }
 
 QString MindMapData::fileName() const
@@ -152,6 +179,7 @@ void MindMapData::setTextSize(int textSize)
 {
     m_textSize = textSize;
 
+    m_graph.beginChanges();
     for (auto && edge : m_graph.getEdges()) {
         edge->setTextSize(textSize);
     }
@@ -159,6 +187,8 @@ void MindMapData::setTextSize(int textSize)
     for (auto && node : m_graph.getNodes()) {
         node->setTextSize(textSize);
     }
+    m_graph.reportChange({ GraphChange::Type::StyleChanged });
+    m_graph.endChanges();
 }
 
 QString MindMapData::version() const
@@ -25,12 +25,43 @@
 
 class ObjectModelLoader;
 
+//! Immutable state of a MindMapData as plain data. Copying is O(1).
+struct MindMapDataSnapshot
+{
+    QString name;
+
+    QString fileName;
+
+    QString version;
+
+    QColor backgroundColor;
+
+    QColor edgeColor;
+
+    double edgeWidth = 0;
+
+    int textSize = 0;
+
+    int cornerRadius = 0;
+
+    GraphSnapshot graph;
+};
+
 class MindMapData : public MindMapDataBase
 {
 public:
     MindMapData(QString name = "");
 
-    MindMapData(const MindMapData & other);
+    //! Copying would construct graphics items for every node. Use snapshot() to keep a state instead.
+    MindMapData(const MindMapData & other) = delete;
+
+    MindMapData & operator=(const MindMapData & other) = delete;
+
+    //! Creates nodes and edges for the given state. Only this is O(n), taking the snapshot is not.
+    explicit MindMapData(const MindMapDataSnapshot & snapshot);
+
+    //! \return Current state without graphics items. See Graph::snapshot().
+    MindMapDataSnapshot snapshot();
 
     virtual ~MindMapData();
 
@@ -71,7 +102,7 @@ public:
     const ImageManager & imageManager() const;
 
 private:
-    void copyGraph(const MindMapData & other);
+    void restoreGraph(const GraphSnapshot & snapshot);
 
     QString m_fileName;
 
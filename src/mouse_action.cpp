@@ -32,12 +32,14 @@ void MouseAction::clear()
     m_sourcePos = QPointF();
     m_sourcePosOnNode = QPointF();
     m_action = Action::None;
+    m_geometry.reset();
 }
 
 void MouseAction::setSourceNode(Node * node, MouseAction::Action action)
 {
     m_sourceNode = node;
     m_action = action;
+    m_geometry.reset();
 }
 
 Node * MouseAction::sourceNode() const
@@ -95,3 +97,13 @@ QPointF MouseAction::sourcePosOnNode() const
 {
     return m_sourcePosOnNode;
 }
+
+std::shared_ptr<const NodeGeometryColumns> MouseAction::geometry() const
+{
+    return m_geometry;
+}
+
+void MouseAction::setGeometry(std::shared_ptr<const NodeGeometryColumns> geometry)
+{
+    m_geometry = geometry;
+}
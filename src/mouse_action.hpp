@@ -18,7 +18,10 @@
 
 #include <QPointF>
 
+#include <memory>
+
 class Node;
+struct NodeGeometryColumns;
 
 class MouseAction
 {
@@ -56,6 +59,9 @@ public:
     QPointF clickedScenePos() const;
     void setClickedScenePos(const QPointF & clickedScenePos);
 
+    std::shared_ptr<const NodeGeometryColumns> geometry() const;
+    void setGeometry(std::shared_ptr<const NodeGeometryColumns> geometry);
+
 private:
     Node * m_sourceNode = nullptr;
 
@@ -70,6 +76,9 @@ private:
     QPointF m_rubberBandOrigin;
 
     Action m_action = Action::None;
+
+    // Copy of the node geometry for passes in the background during the drag
+    std::shared_ptr<const NodeGeometryColumns> m_geometry;
 };
 
 #endif // MOUSE_ACTION_HPP
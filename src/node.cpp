@@ -326,6 +326,17 @@ void Node::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QW
     Q_UNUSED(widget)
     Q_UNUSED(option)
 
+    // Images are decoded only for nodes that are actually shown. The request is made after painting,
+    // as applying the image changes the pixmap and updates the node.
+    if (imageRef() && !m_imageRequested) {
+        m_imageRequested = true;
+        QTimer::singleShot(0, this, [this] {
+            if (imageRef()) {
+                emit imageRequested(imageRef(), *this);
+            }
+        });
+    }
+
     painter->save();
 
     // Background
@@ -471,7 +482,8 @@ void Node::setImageRef(size_t imageRef)
 {
     if (imageRef) {
         NodeBase::setImageRef(imageRef);
-        emit imageRequested(imageRef, *this);
+        m_imageRequested = false;
+        update();
     } else {
         if (NodeBase::imageRef()) {
             NodeBase::setImageRef(imageRef);
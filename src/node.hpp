@@ -133,6 +133,9 @@ private:
     bool m_mouseIn = false;
 
     QPixmap m_pixmap;
+
+    //! The image is requested when the node is painted for the first time
+    bool m_imageRequested = false;
 };
 
 using NodePtr = std::shared_ptr<Node>;
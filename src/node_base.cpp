@@ -14,6 +14,8 @@
 // along with Heimer. If not, see <http://www.gnu.org/licenses/>.
 
 #include "node_base.hpp"
+#include "graph.hpp"
+#include "node_geometry_table.hpp"
 
 NodeBase::NodeBase()
 {
@@ -31,22 +33,32 @@ void NodeBase::setSelected(bool selected)
 
 QSizeF NodeBase::size() const
 {
-    return m_size;
+    return m_geometryTable ? m_geometryTable->nodeSize(m_geometrySlot) : m_size;
 }
 
 void NodeBase::setSize(QSizeF size)
 {
-    m_size = size;
+    if (m_geometryTable) {
+        m_geometryTable->setNodeSize(m_geometrySlot, size);
+    } else {
+        m_size = size;
+    }
+    notifyChanged();
 }
 
 QPointF NodeBase::location() const
 {
-    return m_location;
+    return m_geometryTable ? m_geometryTable->location(m_geometrySlot) : m_location;
 }
 
 void NodeBase::setLocation(QPointF newLocation)
 {
-    m_location = newLocation;
+    if (m_geometryTable) {
+        m_geometryTable->setLocation(m_geometrySlot, newLocation);
+    } else {
+        m_location = newLocation;
+    }
+    notifyChanged(GraphChange::Type::NodeMoved);
 }
 
 QRectF NodeBase::placementBoundingRect() const
@@ -64,6 +76,11 @@ void NodeBase::setIndex(int index)
     m_index = index;
 }
 
+NodeId NodeBase::id() const
+{
+    return m_id;
+}
+
 QString NodeBase::text() const
 {
     return m_text;
@@ -72,6 +89,7 @@ QString NodeBase::text() const
 void NodeBase::setText(const QString & text)
 {
     m_text = text;
+    notifyChanged();
 }
 
 size_t NodeBase::imageRef() const
@@ -82,6 +100,7 @@ size_t NodeBase::imageRef() const
 void NodeBase::setImageRef(size_t imageRef)
 {
     m_imageRef = imageRef;
+    notifyChanged();
 }
 
 QColor NodeBase::color() const
@@ -91,17 +110,23 @@ QColor NodeBase::color() const
 
 int NodeBase::cornerRadius() const
 {
-    return m_cornerRadius;
+    return m_geometryTable ? m_geometryTable->cornerRadius(m_geometrySlot) : m_cornerRadius;
 }
 
 void NodeBase::setCornerRadius(int cornerRadius)
 {
-    m_cornerRadius = cornerRadius;
+    if (m_geometryTable) {
+        m_geometryTable->setCornerRadius(m_geometrySlot, cornerRadius);
+    } else {
+        m_cornerRadius = cornerRadius;
+    }
+    notifyChanged();
 }
 
 void NodeBase::setColor(const QColor & color)
 {
     m_color = color;
+    notifyChanged();
 }
 
 QColor NodeBase::textColor() const
@@ -112,6 +137,7 @@ QColor NodeBase::textColor() const
 void NodeBase::setTextColor(const QColor & color)
 {
     m_textColor = color;
+    notifyChanged();
 }
 
 int NodeBase::textSize() const
@@ -122,8 +148,19 @@ int NodeBase::textSize() const
 void NodeBase::setTextSize(int textSize)
 {
     m_textSize = textSize;
+    notifyChanged();
+}
+
+void NodeBase::notifyChanged(GraphChange::Type type)
+{
+    if (m_graph) {
+        m_graph->markChanged(*this, type);
+    }
 }
 
 NodeBase::~NodeBase()
 {
+    if (m_geometryTable) {
+        m_geometryTable->detach(*this);
+    }
 }
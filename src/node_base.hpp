@@ -16,6 +16,9 @@
 #ifndef NODEBASE_HPP
 #define NODEBASE_HPP
 
+#include "graph_change.hpp"
+#include "node_id.hpp"
+
 #include <QColor>
 #include <QPointF>
 #include <QRectF>
@@ -25,6 +28,9 @@
 #include <memory>
 #include <vector>
 
+class Graph;
+class NodeGeometryTable;
+
 //! Base class for freely placeable target nodes in the editor.
 class NodeBase
 {
@@ -73,6 +79,9 @@ public:
 
     virtual void setIndex(int index);
 
+    //! \return Handle assigned by the Graph the node belongs to, or an invalid handle if not in a graph.
+    NodeId id() const;
+
     virtual QString text() const;
 
     virtual void setText(const QString & text);
@@ -82,6 +91,12 @@ public:
     virtual void setImageRef(size_t imageRef);
 
 private:
+    void notifyChanged(GraphChange::Type type = GraphChange::Type::NodeChanged);
+
+    friend class Graph;
+
+    friend class NodeGeometryTable;
+
     QColor m_color = Qt::white;
 
     int m_cornerRadius = 0;
@@ -100,7 +115,17 @@ private:
 
     int m_index = -1;
 
+    NodeId m_id;
+
     size_t m_imageRef = 0;
+
+    //! Graph is notified about changes in the persistent state while the node belongs to it
+    Graph * m_graph = nullptr;
+
+    //! Location, size and corner radius are read from this table while attached to a Graph
+    NodeGeometryTable * m_geometryTable = nullptr;
+
+    size_t m_geometrySlot = 0;
 };
 
 using NodeBasePtr = std::shared_ptr<NodeBase>;
@@ -0,0 +1,297 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "node_geometry_table.hpp"
+#include "node_base.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace {
+
+struct Bounds
+{
+    double left = std::numeric_limits<double>::max();
+    double top = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest();
+    double bottom = std::numeric_limits<double>::lowest();
+};
+
+struct Range
+{
+    double left;
+    double right;
+    double top;
+    double bottom;
+    double margin;
+};
+
+std::vector<size_t> intersectingSlotsInBlock(const NodeGeometryColumns & columns, const Range & range, size_t begin, size_t end)
+{
+    std::vector<size_t> hits;
+    for (size_t slot = begin; slot < end; slot++) {
+        const double halfWidth = columns.width[slot] / 2 + range.margin;
+        const double halfHeight = columns.height[slot] / 2 + range.margin;
+        if (columns.x[slot] + halfWidth > range.left && columns.x[slot] - halfWidth < range.right && columns.y[slot] + halfHeight > range.top && columns.y[slot] - halfHeight < range.bottom) {
+            hits.push_back(slot);
+        }
+    }
+    return hits;
+}
+
+void appendSlots(std::vector<size_t> & result, const std::vector<size_t> & partial)
+{
+    result.insert(result.end(), partial.begin(), partial.end());
+}
+
+} // namespace
+
+size_t NodeGeometryColumns::size() const
+{
+    return x.size();
+}
+
+QRectF NodeGeometryColumns::boundingRect() const
+{
+    if (x.empty()) {
+        return {};
+    }
+
+    const auto bounds = Parallel::blockingMapReduce<Bounds>(
+      x.size(),
+      [this](size_t begin, size_t end) {
+          Bounds bounds;
+
+          // Plain loops over the arrays so that the compiler can vectorize them
+          for (size_t slot = begin; slot < end; slot++) {
+              bounds.left = std::min(bounds.left, x[slot] - width[slot] / 2);
+              bounds.right = std::max(bounds.right, x[slot] + width[slot] / 2);
+          }
+
+          for (size_t slot = begin; slot < end; slot++) {
+              bounds.top = std::min(bounds.top, y[slot] - height[slot] / 2);
+              bounds.bottom = std::max(bounds.bottom, y[slot] + height[slot] / 2);
+          }
+
+          return bounds;
+      },
+      [](Bounds & result, const Bounds & partial) {
+          result.left = std::min(result.left, partial.left);
+          result.top = std::min(result.top, partial.top);
+          result.right = std::max(result.right, partial.right);
+          result.bottom = std::max(result.bottom, partial.bottom);
+      });
+
+    return { bounds.left, bounds.top, bounds.right - bounds.left, bounds.bottom - bounds.top };
+}
+
+double NodeGeometryColumns::nodeArea() const
+{
+    return Parallel::blockingMapReduce<double>(
+      width.size(),
+      [this](size_t begin, size_t end) {
+          double area = 0;
+          for (size_t slot = begin; slot < end; slot++) {
+              area += width[slot] * height[slot];
+          }
+          return area;
+      },
+      [](double & result, double partial) {
+          result += partial;
+      });
+}
+
+std::vector<size_t> NodeGeometryColumns::intersectingSlots(const QRectF & rect, double margin) const
+{
+    const Range range { rect.left(), rect.right(), rect.top(), rect.bottom(), margin };
+    return Parallel::blockingMapReduce<std::vector<size_t>>(
+      x.size(),
+      [this, range](size_t begin, size_t end) {
+          return intersectingSlotsInBlock(*this, range, begin, end);
+      },
+      appendSlots);
+}
+
+QFuture<std::vector<size_t>> NodeGeometryColumns::intersectingSlots(std::shared_ptr<const NodeGeometryColumns> columns, const QRectF & rect, double margin)
+{
+    const Range range { rect.left(), rect.right(), rect.top(), rect.bottom(), margin };
+    return Parallel::mapReduce<std::vector<size_t>>(
+      columns->size(),
+      [columns, range](size_t begin, size_t end) {
+          return intersectingSlotsInBlock(*columns, range, begin, end);
+      },
+      appendSlots);
+}
+
+NodeGeometryTable::NodeGeometryTable()
+{
+}
+
+void NodeGeometryTable::attach(NodeBase & node)
+{
+    assert(!node.m_geometryTable);
+
+    m_columns.x.push_back(node.m_location.x());
+    m_columns.y.push_back(node.m_location.y());
+    m_columns.width.push_back(node.m_size.width());
+    m_columns.height.push_back(node.m_size.height());
+    m_cornerRadius.push_back(node.m_cornerRadius);
+    m_nodes.push_back(&node);
+
+    node.m_geometryTable = this;
+    node.m_geometrySlot = m_nodes.size() - 1;
+}
+
+void NodeGeometryTable::detach(NodeBase & node)
+{
+    assert(node.m_geometryTable == this);
+
+    const auto slot = node.m_geometrySlot;
+
+    node.m_location = location(slot);
+    node.m_size = nodeSize(slot);
+    node.m_cornerRadius = m_cornerRadius.at(slot);
+    node.m_geometryTable = nullptr;
+    node.m_geometrySlot = 0;
+
+    const auto last = m_nodes.size() - 1;
+    if (slot != last) {
+        m_columns.x.at(slot) = m_columns.x.at(last);
+        m_columns.y.at(slot) = m_columns.y.at(last);
+        m_columns.width.at(slot) = m_columns.width.at(last);
+        m_columns.height.at(slot) = m_columns.height.at(last);
+        m_cornerRadius.at(slot) = m_cornerRadius.at(last);
+        m_nodes.at(slot) = m_nodes.at(last);
+        m_nodes.at(slot)->m_geometrySlot = slot;
+    }
+
+    m_columns.x.pop_back();
+    m_columns.y.pop_back();
+    m_columns.width.pop_back();
+    m_columns.height.pop_back();
+    m_cornerRadius.pop_back();
+    m_nodes.pop_back();
+}
+
+void NodeGeometryTable::clear()
+{
+    while (!m_nodes.empty()) {
+        detach(*m_nodes.back());
+    }
+}
+
+void NodeGeometryTable::reserve(size_t nodeCount)
+{
+    m_columns.x.reserve(nodeCount);
+    m_columns.y.reserve(nodeCount);
+    m_columns.width.reserve(nodeCount);
+    m_columns.height.reserve(nodeCount);
+    m_cornerRadius.reserve(nodeCount);
+    m_nodes.reserve(nodeCount);
+}
+
+size_t NodeGeometryTable::size() const
+{
+    return m_nodes.size();
+}
+
+NodeBase & NodeGeometryTable::node(size_t slot) const
+{
+    return *m_nodes.at(slot);
+}
+
+QPointF NodeGeometryTable::location(size_t slot) const
+{
+    return { m_columns.x.at(slot), m_columns.y.at(slot) };
+}
+
+void NodeGeometryTable::setLocation(size_t slot, QPointF location)
+{
+    m_columns.x.at(slot) = location.x();
+    m_columns.y.at(slot) = location.y();
+}
+
+QSizeF NodeGeometryTable::nodeSize(size_t slot) const
+{
+    return { m_columns.width.at(slot), m_columns.height.at(slot) };
+}
+
+void NodeGeometryTable::setNodeSize(size_t slot, QSizeF size)
+{
+    m_columns.width.at(slot) = size.width();
+    m_columns.height.at(slot) = size.height();
+}
+
+int NodeGeometryTable::cornerRadius(size_t slot) const
+{
+    return m_cornerRadius.at(slot);
+}
+
+void NodeGeometryTable::setCornerRadius(size_t slot, int cornerRadius)
+{
+    m_cornerRadius.at(slot) = cornerRadius;
+}
+
+const std::vector<double> & NodeGeometryTable::x() const
+{
+    return m_columns.x;
+}
+
+const std::vector<double> & NodeGeometryTable::y() const
+{
+    return m_columns.y;
+}
+
+const std::vector<double> & NodeGeometryTable::width() const
+{
+    return m_columns.width;
+}
+
+const std::vector<double> & NodeGeometryTable::height() const
+{
+    return m_columns.height;
+}
+
+const std::vector<int> & NodeGeometryTable::cornerRadius() const
+{
+    return m_cornerRadius;
+}
+
+const NodeGeometryColumns & NodeGeometryTable::columns() const
+{
+    return m_columns;
+}
+
+QRectF NodeGeometryTable::boundingRect() const
+{
+    return m_columns.boundingRect();
+}
+
+double NodeGeometryTable::nodeArea() const
+{
+    return m_columns.nodeArea();
+}
+
+std::vector<size_t> NodeGeometryTable::intersectingSlots(const QRectF & rect, double margin) const
+{
+    return m_columns.intersectingSlots(rect, margin);
+}
+
+NodeGeometryTable::~NodeGeometryTable()
+{
+    clear();
+}
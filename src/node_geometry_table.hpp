@@ -0,0 +1,131 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NODE_GEOMETRY_TABLE_HPP
+#define NODE_GEOMETRY_TABLE_HPP
+
+#include <QFuture>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+
+#include <memory>
+#include <vector>
+
+class NodeBase;
+
+/*! Geometry of the nodes as plain arrays indexed by slot. Whole-table passes run over the arrays in parallel
+ *  on large maps, see Parallel::blockingMapReduce(). A copy can be taken with NodeGeometryTable::columns()
+ *  so that the passes can run in the background while the nodes move. */
+struct NodeGeometryColumns
+{
+    size_t size() const;
+
+    //! \return United placement bounding rect of all nodes in scene coordinates.
+    QRectF boundingRect() const;
+
+    //! \return Sum of the areas of all nodes.
+    double nodeArea() const;
+
+    //! \return Slots of nodes whose placement rect expanded by margin intersects with the given rect, in ascending order.
+    std::vector<size_t> intersectingSlots(const QRectF & rect, double margin = 0) const;
+
+    //! Like intersectingSlots(), but runs on the given columns in the background and returns at once.
+    static QFuture<std::vector<size_t>> intersectingSlots(std::shared_ptr<const NodeGeometryColumns> columns, const QRectF & rect, double margin = 0);
+
+    std::vector<double> x;
+
+    std::vector<double> y;
+
+    std::vector<double> width;
+
+    std::vector<double> height;
+};
+
+/*! Structure-of-arrays store for the geometry of the nodes in a Graph.
+ *
+ *  Nodes attached to the table read and write their location, size and corner radius
+ *  through it, so whole-graph passes (bounding box, overlap, export) can run over
+ *  contiguous arrays instead of chasing node pointers. Slots are dense: detaching a node
+ *  moves the node in the last slot to the freed slot. */
+class NodeGeometryTable
+{
+public:
+    NodeGeometryTable();
+
+    NodeGeometryTable(const NodeGeometryTable & other) = delete;
+
+    NodeGeometryTable & operator=(const NodeGeometryTable & other) = delete;
+
+    ~NodeGeometryTable();
+
+    //! Attaches the node to a new slot initialized from the current geometry of the node.
+    //! The node must not be attached to any table.
+    void attach(NodeBase & node);
+
+    //! Copies the geometry back to the node and frees its slot.
+    void detach(NodeBase & node);
+
+    //! Detaches all nodes.
+    void clear();
+
+    void reserve(size_t nodeCount);
+
+    size_t size() const;
+
+    NodeBase & node(size_t slot) const;
+
+    QPointF location(size_t slot) const;
+
+    void setLocation(size_t slot, QPointF location);
+
+    QSizeF nodeSize(size_t slot) const;
+
+    void setNodeSize(size_t slot, QSizeF size);
+
+    int cornerRadius(size_t slot) const;
+
+    void setCornerRadius(size_t slot, int cornerRadius);
+
+    const std::vector<double> & x() const;
+
+    const std::vector<double> & y() const;
+
+    const std::vector<double> & width() const;
+
+    const std::vector<double> & height() const;
+
+    const std::vector<int> & cornerRadius() const;
+
+    //! \return Location and size columns. Copy them to run passes in the background.
+    const NodeGeometryColumns & columns() const;
+
+    // The whole-table passes below block until done, see NodeGeometryColumns.
+
+    QRectF boundingRect() const;
+
+    double nodeArea() const;
+
+    std::vector<size_t> intersectingSlots(const QRectF & rect, double margin = 0) const;
+
+private:
+    NodeGeometryColumns m_columns;
+
+    std::vector<int> m_cornerRadius;
+
+    std::vector<NodeBase *> m_nodes;
+};
+
+#endif // NODE_GEOMETRY_TABLE_HPP
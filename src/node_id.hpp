@@ -0,0 +1,86 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef NODE_ID_HPP
+#define NODE_ID_HPP
+
+#include <cstdint>
+#include <functional>
+
+/*! Generational handle of a node in a Graph. The slot addresses the node in O(1) and the generation
+ *  is bumped every time the slot is freed, so a handle to a deleted node can always be detected as stale.
+ *  Unlike NodeBase::index(), the handle is not persistent: it's only meaningful for the graph that issued it. */
+class NodeId
+{
+public:
+    static const uint32_t INVALID_SLOT = UINT32_MAX;
+
+    NodeId() = default;
+
+    NodeId(uint32_t slot, uint32_t generation)
+      : m_slot(slot)
+      , m_generation(generation)
+    {
+    }
+
+    uint32_t slot() const
+    {
+        return m_slot;
+    }
+
+    uint32_t generation() const
+    {
+        return m_generation;
+    }
+
+    //! \return Slot and generation packed into a single 64-bit value.
+    uint64_t value() const
+    {
+        return (static_cast<uint64_t>(m_generation) << 32) | m_slot;
+    }
+
+    bool isValid() const
+    {
+        return m_slot != INVALID_SLOT;
+    }
+
+    bool operator==(const NodeId & other) const
+    {
+        return m_slot == other.m_slot && m_generation == other.m_generation;
+    }
+
+    bool operator!=(const NodeId & other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    uint32_t m_slot = INVALID_SLOT;
+
+    uint32_t m_generation = 0;
+};
+
+namespace std {
+template<>
+struct hash<NodeId>
+{
+    size_t operator()(const NodeId & id) const
+    {
+        return hash<uint64_t>()(id.value());
+    }
+};
+} // namespace std
+
+#endif // NODE_ID_HPP
@@ -0,0 +1,96 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+//! Helpers to run read-only passes over large arrays on all cores.
+namespace Parallel {
+
+//! Number of items mapped as a single task. Ranges smaller than this are processed in the calling thread.
+static const size_t BLOCK_SIZE = 16384;
+
+/*! Maps the range [0, size) in blocks of BLOCK_SIZE items on the global thread pool and reduces the partial
+ *  results in block order. The calling thread takes part and returns only after all blocks are done, so
+ *  this is meant for background tasks and for callers that need the result right away, e.g. an export.
+ *
+ *  Block boundaries depend only on size, so the result doesn't depend on the number of threads, e.g.
+ *  floating point sums are the same on every machine.
+ *
+ *  \param map Called as map(begin, end) and returns the partial result of the items in [begin, end).
+ *             Called concurrently, so it must only read shared data.
+ *  \param reduce Called as reduce(result, partial) in the calling thread, like a QtConcurrent reduce function.
+ *  \return Default-constructed T reduced with the partial result of each block. */
+template<typename T, typename MapFunction, typename ReduceFunction>
+T blockingMapReduce(size_t size, MapFunction map, ReduceFunction reduce)
+{
+    T result {};
+    const size_t blockCount = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (blockCount == 1) {
+        reduce(result, map(0, size));
+    } else if (blockCount > 1) {
+        std::vector<T> partials(blockCount);
+        std::atomic<size_t> nextBlock(0);
+        const auto worker = [&]() {
+            for (size_t block = nextBlock++; block < blockCount; block = nextBlock++) {
+                const size_t begin = block * BLOCK_SIZE;
+                partials[block] = map(begin, std::min(begin + BLOCK_SIZE, size));
+            }
+        };
+
+        const auto threadCount = static_cast<size_t>(std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+        std::vector<QFuture<void>> helpers;
+        for (size_t i = 1; i < std::min(threadCount, blockCount); i++) {
+            helpers.push_back(QtConcurrent::run(worker));
+        }
+
+        worker();
+
+        // Helpers that didn't start yet are run here, so a pass started from a pool thread can't deadlock
+        for (auto && helper : helpers) {
+            helper.waitForFinished();
+        }
+
+        for (auto && partial : partials) {
+            reduce(result, partial);
+        }
+    }
+    return result;
+}
+
+/*! Like blockingMapReduce(), but runs on the global thread pool and returns at once. Use a QFutureWatcher
+ *  to get the result in the GUI thread.
+ *
+ *  map and reduce are copied to the pool and may run after the caller has returned and changed its data,
+ *  so they must own what they read, e.g. capture a copy of the node geometry by value. */
+template<typename T, typename MapFunction, typename ReduceFunction>
+QFuture<T> mapReduce(size_t size, MapFunction map, ReduceFunction reduce)
+{
+    return QtConcurrent::run([=]() {
+        return blockingMapReduce<T>(size, map, reduce);
+    });
+}
+
+} // namespace Parallel
+
+#endif // PARALLEL_HPP
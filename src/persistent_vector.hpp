@@ -0,0 +1,244 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PERSISTENT_VECTOR_HPP
+#define PERSISTENT_VECTOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+/*! Vector with O(1) copies. Items are stored in a tree of 32-item chunks shared between copies,
+ *  and a modification copies only the chunks on the path to the modified item (copy-on-write).
+ *  Reading an item takes O(log32 n), so this is meant for snapshots rather than for hot loops.
+ *
+ *  Threads: a copy can be read and destroyed in another thread while the original is modified, e.g. a
+ *  snapshot passed to a background task. Each copy itself must be used by one thread at a time, so copy
+ *  the vector in the thread that owns it and hand the copy over. */
+template<typename T>
+class PersistentVector
+{
+public:
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return !m_size;
+    }
+
+    const T & at(size_t index) const
+    {
+        assert(index < m_size);
+        const Chunk * chunk = m_root.get();
+        for (unsigned int shift = m_shift; shift > 0; shift -= BITS) {
+            chunk = chunk->children[(index >> shift) & MASK].get();
+        }
+        return chunk->values[index & MASK];
+    }
+
+    void set(size_t index, const T & value)
+    {
+        assert(index < m_size);
+        mutableLeaf(index).values[index & MASK] = value;
+    }
+
+    void push_back(const T & value)
+    {
+        if (!m_root) {
+            m_root = std::make_shared<Chunk>();
+        } else if (m_size == (static_cast<size_t>(1) << (m_shift + BITS))) {
+            // The tree is full: add a level
+            auto root = std::make_shared<Chunk>();
+            root->children.push_back(m_root);
+            m_root = root;
+            m_shift += BITS;
+        }
+
+        auto chunk = &unique(m_root);
+        for (unsigned int shift = m_shift; shift > 0; shift -= BITS) {
+            auto && children = chunk->children;
+            const auto child = (m_size >> shift) & MASK;
+            if (child == children.size()) {
+                children.push_back(std::make_shared<Chunk>());
+            }
+            chunk = &unique(children[child]);
+        }
+        chunk->values.push_back(value);
+        m_size++;
+    }
+
+    void pop_back()
+    {
+        assert(m_size);
+        m_size--;
+        if (!m_size) {
+            clear();
+            return;
+        }
+
+        popBack(m_root, m_shift);
+
+        // Drop a level if the root has only one child left
+        while (m_shift > 0 && m_root->children.size() == 1) {
+            m_root = m_root->children.front();
+            m_shift -= BITS;
+        }
+    }
+
+    const T & back() const
+    {
+        return at(m_size - 1);
+    }
+
+    void clear()
+    {
+        m_root.reset();
+        m_size = 0;
+        m_shift = 0;
+    }
+
+    //! \return True if both vectors are the same snapshot, i.e. no modifications since one was copied from the other.
+    bool isSameAs(const PersistentVector & other) const
+    {
+        return m_root == other.m_root && m_size == other.m_size;
+    }
+
+    /*! Calls f(index) for every index whose item may differ in the other vector: the indices in chunks that are
+     *  not shared between the vectors and the indices beyond the end of the shorter vector. Shared chunks are
+     *  skipped, so for vectors copied from each other this takes time proportional to the modifications made
+     *  since the copy rather than to the size. */
+    template<typename Function>
+    void forEachDifference(const PersistentVector & other, Function f) const
+    {
+        forEachDifference(m_root.get(), m_shift, other.m_root.get(), other.m_shift, 0, f);
+    }
+
+private:
+    static const unsigned int BITS = 5;
+
+    static const size_t MASK = (1 << BITS) - 1;
+
+    struct Chunk
+    {
+        std::vector<std::shared_ptr<Chunk>> children;
+
+        std::vector<T> values;
+    };
+
+    using ChunkPtr = std::shared_ptr<Chunk>;
+
+    //! Copies the chunk if it's shared with another vector.
+    static Chunk & unique(ChunkPtr & chunk)
+    {
+        if (chunk.use_count() > 1) {
+            chunk = std::make_shared<Chunk>(*chunk);
+        } else {
+            // use_count() is a relaxed load. A copy released in another thread decrements the count with
+            // release ordering, so this fence makes the reads of that thread happen before the chunk is modified.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *chunk;
+    }
+
+    Chunk & mutableLeaf(size_t index)
+    {
+        auto chunk = &unique(m_root);
+        for (unsigned int shift = m_shift; shift > 0; shift -= BITS) {
+            chunk = &unique(chunk->children[(index >> shift) & MASK]);
+        }
+        return *chunk;
+    }
+
+    template<typename Function>
+    static void forEachDifference(const Chunk * chunk0, unsigned int shift0, const Chunk * chunk1, unsigned int shift1, size_t offset, Function & f)
+    {
+        if ((chunk0 == chunk1 && shift0 == shift1) || (!chunk0 && !chunk1)) {
+            return;
+        }
+
+        if (!chunk0 || !chunk1) {
+            forEachIndex(chunk0 ? chunk0 : chunk1, chunk0 ? shift0 : shift1, offset, f);
+        } else if (shift0 != shift1) {
+            // The first child of the taller tree covers the whole range of the lower one as levels are added
+            // and removed at the root
+            const auto taller = shift0 > shift1 ? chunk0 : chunk1;
+            const auto shift = std::max(shift0, shift1);
+            for (size_t i = 0; i < taller->children.size(); i++) {
+                const auto child = taller->children[i].get();
+                const auto childOffset = offset + (i << shift);
+                if (!i) {
+                    forEachDifference(shift0 > shift1 ? child : chunk0, shift0 > shift1 ? shift - BITS : shift0,
+                                      shift1 > shift0 ? child : chunk1, shift1 > shift0 ? shift - BITS : shift1, childOffset, f);
+                } else {
+                    forEachIndex(child, shift - BITS, childOffset, f);
+                }
+            }
+        } else if (shift0 > 0) {
+            const auto count = std::max(chunk0->children.size(), chunk1->children.size());
+            for (size_t i = 0; i < count; i++) {
+                forEachDifference(i < chunk0->children.size() ? chunk0->children[i].get() : nullptr, shift0 - BITS,
+                                  i < chunk1->children.size() ? chunk1->children[i].get() : nullptr, shift0 - BITS,
+                                  offset + (i << shift0), f);
+            }
+        } else {
+            const auto count = std::max(chunk0->values.size(), chunk1->values.size());
+            for (size_t i = 0; i < count; i++) {
+                f(offset + i);
+            }
+        }
+    }
+
+    template<typename Function>
+    static void forEachIndex(const Chunk * chunk, unsigned int shift, size_t offset, Function & f)
+    {
+        if (shift > 0) {
+            for (size_t i = 0; i < chunk->children.size(); i++) {
+                forEachIndex(chunk->children[i].get(), shift - BITS, offset + (i << shift), f);
+            }
+        } else {
+            for (size_t i = 0; i < chunk->values.size(); i++) {
+                f(offset + i);
+            }
+        }
+    }
+
+    //! Removes the last item below the given chunk and prunes chunks that became empty.
+    void popBack(ChunkPtr & chunkPtr, unsigned int shift)
+    {
+        auto && chunk = unique(chunkPtr);
+        if (shift > 0) {
+            popBack(chunk.children.back(), shift - BITS);
+            auto && last = chunk.children.back();
+            if (last->children.empty() && last->values.empty()) {
+                chunk.children.pop_back();
+            }
+        } else {
+            chunk.values.pop_back();
+        }
+    }
+
+    ChunkPtr m_root;
+
+    size_t m_size = 0;
+
+    unsigned int m_shift = 0;
+};
+
+#endif // PERSISTENT_VECTOR_HPP
@@ -14,26 +14,42 @@
 // along with Heimer. If not, see <http://www.gnu.org/licenses/>.
 
 #include "reader.hpp"
+#include "binary_serializer.hpp"
+#include "container_serializer.hpp"
+#include "serializer.hpp"
 
 #include <QFile>
 #include <QObject>
 
-QDomDocument Reader::readFromFile(QString filePath)
+MindMapDataPtr Reader::readFromFile(QString filePath)
 {
-    QDomDocument doc;
-
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         throw FileException(QObject::tr("Cannot open file: '") + filePath + "'");
     }
 
-    if (!doc.setContent(&file)) {
-        file.close();
-
-        throw FileException(QObject::tr("Corrupted file: '") + filePath + "'");
+    MindMapDataPtr data;
+    if (BinarySerializer::isBinary(file.peek(BinarySerializer::MAGIC_SIZE))) {
+        // Only the pages that are used get loaded
+        const auto size = file.size();
+        if (const auto mapped = file.map(0, size)) {
+            data = BinarySerializer::fromBinary(mapped, size);
+            file.unmap(mapped);
+        } else {
+            const auto bytes = file.readAll();
+            data = BinarySerializer::fromBinary(reinterpret_cast<const uchar *>(bytes.constData()), bytes.size());
+        }
+    } else if (ContainerSerializer::isContainer(file.peek(ContainerSerializer::MAGIC_SIZE))) {
+        data = ContainerSerializer::fromContainer(file);
+    } else {
+        data = Serializer::fromXml(file);
     }
 
     file.close();
 
-    return doc;
+    if (!data) {
+        throw FileException(QObject::tr("Corrupted file: '") + filePath + "'");
+    }
+
+    return data;
 }
@@ -16,13 +16,15 @@
 #ifndef READER_HPP
 #define READER_HPP
 
-#include <QDomDocument>
+#include <QString>
 
 #include "file_exception.hpp"
+#include "mind_map_data.hpp"
 
 namespace Reader {
 
-QDomDocument readFromFile(QString filePath);
+//! Reads the mind map from the file in the format it's in. Throws FileException if the file can't be opened or is corrupted.
+MindMapDataPtr readFromFile(QString filePath);
 
 }
 
@@ -17,7 +17,7 @@
 
 #include "node.hpp"
 
-#include <map>
+#include <vector>
 
 void SelectionGroup::clear()
 {
@@ -36,19 +36,18 @@ bool SelectionGroup::hasNode(Node & node) const
 
 void SelectionGroup::move(Node & reference, QPointF location)
 {
-    std::map<int, QPointF> delta;
+    std::vector<std::pair<Node *, QPointF>> delta;
+    delta.reserve(m_nodes.size());
     for (auto && node : m_nodes) {
-        if (node->index() != reference.index()) {
-            delta[node->index()] = node->location() - reference.location();
+        if (node != &reference) {
+            delta.push_back({ node, node->location() - reference.location() });
         }
     }
 
     reference.setLocation(location);
 
-    for (auto && node : m_nodes) {
-        if (node->index() != reference.index()) {
-            node->setLocation(reference.location() + delta[node->index()]);
-        }
+    for (auto && nodeAndDelta : delta) {
+        nodeAndDelta.first->setLocation(reference.location() + nodeAndDelta.second);
     }
 }
 
@@ -20,14 +20,15 @@
 #include "node.hpp"
 #include "simple_logger.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <functional>
-#include <map>
+#include <vector>
 
+#include <QBuffer>
 #include <QDebug>
-#include <QDomElement>
 #include <QFile>
-#include <QTemporaryDir>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 namespace Serializer {
 namespace DataKeywords {
@@ -108,6 +109,8 @@ static constexpr auto REVERSED = "reversed";
 
 namespace Image {
 
+static constexpr auto HASH = "hash";
+
 static constexpr auto ID = "id";
 
 static constexpr auto PATH = "path";
@@ -121,111 +124,96 @@ static const double SCALE = 1000; // https://bugreports.qt.io/browse/QTBUG-67129
 
 using std::make_shared;
 
-static void writeColor(QDomElement & parent, QDomDocument & doc, QColor color, QString elementName)
+static void writeColor(QXmlStreamWriter & writer, QColor color, const char * elementName)
 {
-    auto colorElement = doc.createElement(elementName);
-    colorElement.setAttribute(Serializer::DataKeywords::Design::Color::R, color.red());
-    colorElement.setAttribute(Serializer::DataKeywords::Design::Color::G, color.green());
-    colorElement.setAttribute(Serializer::DataKeywords::Design::Color::B, color.blue());
-    parent.appendChild(colorElement);
+    writer.writeEmptyElement(elementName);
+    writer.writeAttribute(Serializer::DataKeywords::Design::Color::R, QString::number(color.red()));
+    writer.writeAttribute(Serializer::DataKeywords::Design::Color::G, QString::number(color.green()));
+    writer.writeAttribute(Serializer::DataKeywords::Design::Color::B, QString::number(color.blue()));
 }
 
-static void writeImageRef(QDomElement & parent, QDomDocument & doc, size_t imageRef, QString elementName)
+static void writeImageRef(QXmlStreamWriter & writer, size_t imageRef, const char * elementName)
 {
-    auto colorElement = doc.createElement(elementName);
-    colorElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::Image::REF, static_cast<int>(imageRef));
-    parent.appendChild(colorElement);
+    writer.writeEmptyElement(elementName);
+    writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::Image::REF, QString::number(imageRef));
 }
 
-static void writeNodes(MindMapData & mindMapData, QDomElement & root, QDomDocument & doc)
+static void writeNodes(MindMapData & mindMapData, QXmlStreamWriter & writer)
 {
-    for (auto node : mindMapData.graph().getNodes()) {
-        auto nodeElement = doc.createElement(Serializer::DataKeywords::Design::Graph::NODE);
-        nodeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::INDEX, node->index());
-        nodeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::X, static_cast<int>(node->location().x() * SCALE));
-        nodeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::Y, static_cast<int>(node->location().y() * SCALE));
-        nodeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::W, static_cast<int>(node->size().width() * SCALE));
-        nodeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Node::H, static_cast<int>(node->size().height() * SCALE));
-        root.appendChild(nodeElement);
+    auto && nodes = mindMapData.graph().getNodes();
+    auto && geometry = mindMapData.graph().geometry();
+    for (size_t slot = 0; slot < nodes.size(); slot++) {
+        auto && node = nodes.at(slot);
+        writer.writeStartElement(Serializer::DataKeywords::Design::Graph::NODE);
+        writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::INDEX, QString::number(node->index()));
+        writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::X, QString::number(static_cast<int>(geometry.x()[slot] * SCALE)));
+        writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::Y, QString::number(static_cast<int>(geometry.y()[slot] * SCALE)));
+        writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::W, QString::number(static_cast<int>(geometry.width()[slot] * SCALE)));
+        writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Node::H, QString::number(static_cast<int>(geometry.height()[slot] * SCALE)));
 
         // Create a child node for the text content
-        auto textElement = doc.createElement(Serializer::DataKeywords::Design::Graph::Node::TEXT);
-        textElement.appendChild(doc.createTextNode(node->text()));
-        nodeElement.appendChild(textElement);
+        writer.writeTextElement(Serializer::DataKeywords::Design::Graph::Node::TEXT, node->text());
 
         // Create a child node for color
-        writeColor(nodeElement, doc, node->color(), Serializer::DataKeywords::Design::Graph::Node::COLOR);
+        writeColor(writer, node->color(), Serializer::DataKeywords::Design::Graph::Node::COLOR);
 
         // Create a child node for text color
-        writeColor(nodeElement, doc, node->textColor(), Serializer::DataKeywords::Design::Graph::Node::TEXT_COLOR);
+        writeColor(writer, node->textColor(), Serializer::DataKeywords::Design::Graph::Node::TEXT_COLOR);
 
         // Create a child node for image ref
         if (node->imageRef()) {
-            writeImageRef(nodeElement, doc, node->imageRef(), Serializer::DataKeywords::Design::Graph::Node::IMAGE);
+            writeImageRef(writer, node->imageRef(), Serializer::DataKeywords::Design::Graph::Node::IMAGE);
         }
+
+        writer.writeEndElement();
     }
 }
 
-static void writeEdges(MindMapData & mindMapData, QDomElement & root, QDomDocument & doc)
+static void writeEdges(MindMapData & mindMapData, QXmlStreamWriter & writer)
 {
-    for (auto node : mindMapData.graph().getNodes()) {
-        for (auto && edge : mindMapData.graph().getEdgesFromNode(node)) {
-            auto edgeElement = doc.createElement(Serializer::DataKeywords::Design::Graph::EDGE);
-            edgeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX0, edge->sourceNodeBase().index());
-            edgeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX1, edge->targetNodeBase().index());
-            edgeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Edge::ARROW_MODE, static_cast<int>(edge->arrowMode()));
-            edgeElement.setAttribute(Serializer::DataKeywords::Design::Graph::Edge::REVERSED, edge->reversed());
-            root.appendChild(edgeElement);
+    auto && graph = mindMapData.graph();
+    for (auto && node : graph.getNodes()) {
+        for (auto && edge : graph.edgesFrom(node->id())) {
+            writer.writeStartElement(Serializer::DataKeywords::Design::Graph::EDGE);
+            writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX0, QString::number(edge->sourceNodeBase().index()));
+            writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX1, QString::number(edge->targetNodeBase().index()));
+            writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Edge::ARROW_MODE, QString::number(static_cast<int>(edge->arrowMode())));
+            writer.writeAttribute(Serializer::DataKeywords::Design::Graph::Edge::REVERSED, QString::number(edge->reversed()));
 
             // Create a child node for the text content
-            auto textElement = doc.createElement(Serializer::DataKeywords::Design::Graph::Node::TEXT);
-            edgeElement.appendChild(textElement);
-            auto textNode = doc.createTextNode(edge->text());
-            textElement.appendChild(textNode);
+            writer.writeTextElement(Serializer::DataKeywords::Design::Graph::Node::TEXT, edge->text());
+
+            writer.writeEndElement();
         }
     }
 }
 
-static QString getBase64Data(std::string path)
+//! Writes the file as base64 in chunks, so that the whole file is never in memory.
+static void writeBase64Data(QXmlStreamWriter & writer, std::string path)
 {
 #ifndef HEIMER_UNIT_TEST
     QFile in(path.c_str());
     if (!in.open(QIODevice::ReadOnly)) {
         throw std::runtime_error("Cannot open file: '" + path + "'");
     }
-    return in.readAll().toBase64(QByteArray::Base64Encoding);
-#else
-    Q_UNUSED(path)
-    return "";
-#endif
-}
 
-static QImage base64ToQImage(const std::string & base64, size_t imageId, std::string imagePath)
-{
-#ifndef HEIMER_UNIT_TEST
-    QTemporaryDir dir;
-    if (dir.isValid()) {
-        QFileInfo info(imagePath.c_str());
-        const auto extractedFilePath = (dir.path() + QDir::separator() + info.fileName()).toStdString();
-        juzzlin::L().info() << "Extracting embedded image id=" << imageId << " to '" << extractedFilePath << "'";
-        QByteArray bytes = QByteArray::fromBase64(base64.c_str(), QByteArray::Base64Encoding);
-        QFile out(extractedFilePath.c_str());
-        if (!out.open(QIODevice::WriteOnly)) {
-            throw std::runtime_error("Cannot open file: '" + extractedFilePath + "' for write!");
-        }
-        auto bytesWritten = out.write(bytes);
-        juzzlin::L().info() << "Bytes written: " << bytesWritten << ", " << (bytesWritten == bytes.length() ? "OK" : "SIZE MISMATCH");
-        return QImage { extractedFilePath.c_str() };
+    // Only whole groups of three bytes encode without padding, so that the chunks can be concatenated
+    const qint64 chunkSize = 3 * 16384;
+    QByteArray pending;
+    while (!in.atEnd()) {
+        pending += in.read(chunkSize);
+        const auto wholeGroups = pending.size() - pending.size() % 3;
+        writer.writeCharacters(QString::fromLatin1(pending.left(wholeGroups).toBase64(QByteArray::Base64Encoding)));
+        pending.remove(0, wholeGroups);
     }
+    writer.writeCharacters(QString::fromLatin1(pending.toBase64(QByteArray::Base64Encoding)));
 #else
-    Q_UNUSED(base64)
-    Q_UNUSED(imageId)
-    Q_UNUSED(imagePath)
+    Q_UNUSED(writer)
+    Q_UNUSED(path)
 #endif
-    return QImage {};
 }
 
-static void writeImages(MindMapData & mindMapData, QDomElement & root, QDomDocument & doc)
+static void writeImages(MindMapData & mindMapData, QXmlStreamWriter & writer, const ImageHashes & imageHashes)
 {
     for (auto && node : mindMapData.graph().getNodes()) {
         if (node->imageRef()) {
@@ -233,72 +221,88 @@ static void writeImages(MindMapData & mindMapData, QDomElement & root, QDomDocum
             bool exists;
             std::tie(image, exists) = mindMapData.imageManager().getImage(node->imageRef());
             if (exists) {
-                auto imageElement = doc.createElement(Serializer::DataKeywords::Design::IMAGE);
-                imageElement.setAttribute(Serializer::DataKeywords::Design::Image::ID, static_cast<int>(image.id()));
-                imageElement.setAttribute(Serializer::DataKeywords::Design::Image::PATH, image.path().c_str());
-                root.appendChild(imageElement);
-
-                // Create a child node for the image content
-                imageElement.appendChild(doc.createTextNode(getBase64Data(image.path())));
+                const auto hash = imageHashes.find(image.id());
+                if (hash != imageHashes.end()) {
+                    writer.writeEmptyElement(Serializer::DataKeywords::Design::IMAGE);
+                    writer.writeAttribute(Serializer::DataKeywords::Design::Image::ID, QString::number(image.id()));
+                    writer.writeAttribute(Serializer::DataKeywords::Design::Image::PATH, image.path().c_str());
+                    writer.writeAttribute(Serializer::DataKeywords::Design::Image::HASH, QString::fromLatin1(hash->second));
+                } else {
+                    writer.writeStartElement(Serializer::DataKeywords::Design::IMAGE);
+                    writer.writeAttribute(Serializer::DataKeywords::Design::Image::ID, QString::number(image.id()));
+                    writer.writeAttribute(Serializer::DataKeywords::Design::Image::PATH, image.path().c_str());
+
+                    // Create a child node for the image content
+                    writeBase64Data(writer, image.path());
+
+                    writer.writeEndElement();
+                }
             }
         }
     }
 }
 
-static QColor readColorElement(const QDomElement & element)
+// Handlers consume their element up to its end element. They get all other state as arguments,
+// so that the dispatch tables can be static.
+template<typename Context>
+using ElementHandler = void (*)(QXmlStreamReader &, Context &);
+
+template<typename Context>
+using ElementHandlers = std::vector<std::pair<QLatin1String, ElementHandler<Context>>>;
+
+// Generic helper that loops through the children of the current element
+template<typename Context>
+static void readChildren(QXmlStreamReader & reader, const ElementHandlers<Context> & handlers, Context & context)
 {
-    return {
-        element.attribute(Serializer::DataKeywords::Design::Color::R, "255").toInt(),
-        element.attribute(Serializer::DataKeywords::Design::Color::G, "255").toInt(),
-        element.attribute(Serializer::DataKeywords::Design::Color::B, "255").toInt()
-    };
+    while (reader.readNextStartElement()) {
+        const auto name = reader.name();
+        const auto handler = std::find_if(handlers.begin(), handlers.end(), [&name](const std::pair<QLatin1String, ElementHandler<Context>> & entry) {
+            return name == entry.first;
+        });
+        if (handler != handlers.end()) {
+            handler->second(reader, context);
+        } else {
+            juzzlin::L().warning() << "Unknown element '" << name.toString().toStdString() << "'";
+            reader.skipCurrentElement();
+        }
+    }
 }
 
-static size_t readImageElement(const QDomElement & element)
+static int readIntAttribute(const QXmlStreamAttributes & attributes, const char * name, int defaultValue)
 {
-    return static_cast<size_t>(element.attribute(Serializer::DataKeywords::Design::Graph::Node::Image::REF, "0").toInt());
+    const auto value = attributes.value(QLatin1String(name));
+    return value.isNull() ? defaultValue : value.toInt();
 }
 
-static QString readFirstTextNodeContent(const QDomElement & element)
+static QColor readColorElement(QXmlStreamReader & reader)
 {
-    for (int i = 0; i < element.childNodes().count(); i++) {
-        const auto child = element.childNodes().at(i);
-        if (child.isText()) {
-            // See: https://github.com/juzzlin/Heimer/issues/73
-            return child.toText().nodeValue().replace(13, "");
-        }
-    }
-    return "";
+    const auto attributes = reader.attributes();
+    reader.skipCurrentElement();
+    return {
+        readIntAttribute(attributes, Serializer::DataKeywords::Design::Color::R, 255),
+        readIntAttribute(attributes, Serializer::DataKeywords::Design::Color::G, 255),
+        readIntAttribute(attributes, Serializer::DataKeywords::Design::Color::B, 255)
+    };
 }
 
-static void elementWarning(const QDomElement & element)
+static size_t readImageElement(QXmlStreamReader & reader)
 {
-    juzzlin::L().warning() << "Unknown element '" << element.nodeName().toStdString() << "'";
+    const auto imageRef = readIntAttribute(reader.attributes(), Serializer::DataKeywords::Design::Graph::Node::Image::REF, 0);
+    reader.skipCurrentElement();
+    return static_cast<size_t>(imageRef);
 }
 
-// Generic helper that loops through element's children
-static void readChildren(const QDomElement & root, std::map<QString, std::function<void(const QDomElement &)>> handlerMap)
+static QString readTextContent(QXmlStreamReader & reader)
 {
-    auto domNode = root.firstChild();
-    while (!domNode.isNull()) {
-        auto element = domNode.toElement();
-        if (!element.isNull()) {
-            if (handlerMap.count(element.nodeName())) {
-                handlerMap[element.nodeName()](element);
-            } else {
-                elementWarning(element);
-            }
-        }
-
-        domNode = domNode.nextSibling();
-    }
+    // See: https://github.com/juzzlin/Heimer/issues/73
+    return reader.readElementText(QXmlStreamReader::SkipChildElements).remove(QChar(13));
 }
 
 // The purpose of this #ifdef is to build GUILESS unit tests so that QTEST_GUILESS_MAIN can be used
 #ifdef HEIMER_UNIT_TEST
-static NodeBasePtr readNode(const QDomElement & element)
+static NodeBasePtr readNode(QXmlStreamReader & reader)
 #else
-static NodePtr readNode(const QDomElement & element)
+static NodePtr readNode(QXmlStreamReader & reader)
 #endif
 {
 #ifdef HEIMER_UNIT_TEST
@@ -307,153 +311,274 @@ static NodePtr readNode(const QDomElement & element)
     // Init a new node. QGraphicsScene will take the ownership eventually.
     auto node = make_shared<Node>();
 #endif
-    node->setIndex(element.attribute(Serializer::DataKeywords::Design::Graph::Node::INDEX, "-1").toInt());
+    const auto attributes = reader.attributes();
+    node->setIndex(readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Node::INDEX, -1));
     node->setLocation(QPointF(
-      element.attribute(Serializer::DataKeywords::Design::Graph::Node::X, "0").toInt() / SCALE,
-      element.attribute(Serializer::DataKeywords::Design::Graph::Node::Y, "0").toInt() / SCALE));
+      readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Node::X, 0) / SCALE,
+      readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Node::Y, 0) / SCALE));
 
-    if (element.hasAttribute(Serializer::DataKeywords::Design::Graph::Node::W) && element.hasAttribute(Serializer::DataKeywords::Design::Graph::Node::H)) {
+    if (attributes.hasAttribute(QLatin1String(Serializer::DataKeywords::Design::Graph::Node::W)) && attributes.hasAttribute(QLatin1String(Serializer::DataKeywords::Design::Graph::Node::H))) {
         node->setSize(QSizeF(
-          element.attribute(Serializer::DataKeywords::Design::Graph::Node::W).toInt() / SCALE,
-          element.attribute(Serializer::DataKeywords::Design::Graph::Node::H).toInt() / SCALE));
+          readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Node::W, 0) / SCALE,
+          readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Node::H, 0) / SCALE));
     }
 
-    readChildren(element, { { QString(Serializer::DataKeywords::Design::Graph::Node::TEXT), [=](const QDomElement & e) {
-                                 node->setText(readFirstTextNodeContent(e));
-                             } },
-                            { QString(Serializer::DataKeywords::Design::Graph::Node::COLOR), [=](const QDomElement & e) {
-                                 node->setColor(readColorElement(e));
-                             } },
-                            { QString(Serializer::DataKeywords::Design::Graph::Node::TEXT_COLOR), [=](const QDomElement & e) {
-                                 node->setTextColor(readColorElement(e));
-                             } },
-                            { QString(Serializer::DataKeywords::Design::Graph::Node::IMAGE), [=](const QDomElement & e) {
-                                 node->setImageRef(readImageElement(e));
-                             } } });
+    static const ElementHandlers<NodeBase> handlers = {
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::Node::TEXT), [](QXmlStreamReader & reader, NodeBase & node) {
+             node.setText(readTextContent(reader));
+         } },
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::Node::COLOR), [](QXmlStreamReader & reader, NodeBase & node) {
+             node.setColor(readColorElement(reader));
+         } },
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::Node::TEXT_COLOR), [](QXmlStreamReader & reader, NodeBase & node) {
+             node.setTextColor(readColorElement(reader));
+         } },
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::Node::IMAGE), [](QXmlStreamReader & reader, NodeBase & node) {
+             node.setImageRef(readImageElement(reader));
+         } }
+    };
+    readChildren<NodeBase>(reader, handlers, *node);
 
     return node;
 }
 
+//! Edge as read from the file. Edges are created after all nodes have been indexed.
+struct EdgeRecord
+{
+    int index0 = -1;
+
+    int index1 = -1;
+
+    int arrowMode = 0;
+
+    bool reversed = false;
+
+    QString text;
+};
+
+static EdgeRecord readEdge(QXmlStreamReader & reader)
+{
+    EdgeRecord record;
+    const auto attributes = reader.attributes();
+    record.index0 = readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Edge::INDEX0, -1);
+    record.index1 = readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Edge::INDEX1, -1);
+    record.reversed = readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Edge::REVERSED, 0);
+    record.arrowMode = readIntAttribute(attributes, Serializer::DataKeywords::Design::Graph::Edge::ARROW_MODE, 0);
+
+    static const ElementHandlers<EdgeRecord> handlers = {
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::Node::TEXT), [](QXmlStreamReader & reader, EdgeRecord & record) {
+             record.text = readTextContent(reader);
+         } }
+    };
+    readChildren(reader, handlers, record);
+
+    return record;
+}
+
 // The purpose of this #ifdef is to build GUILESS unit tests so that QTEST_GUILESS_MAIN can be used
 #ifdef HEIMER_UNIT_TEST
-static EdgeBasePtr readEdge(const QDomElement & element, MindMapDataPtr data)
+static EdgeBasePtr createEdge(const EdgeRecord & record, MindMapData & data)
 #else
-static EdgePtr readEdge(const QDomElement & element, MindMapDataPtr data)
+static EdgePtr createEdge(const EdgeRecord & record, MindMapData & data)
 #endif
 {
-    const int index0 = element.attribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX0, "-1").toInt();
-    const int index1 = element.attribute(Serializer::DataKeywords::Design::Graph::Edge::INDEX1, "-1").toInt();
-    const int reversed = element.attribute(Serializer::DataKeywords::Design::Graph::Edge::REVERSED, "0").toInt();
-    const int arrowMode = element.attribute(Serializer::DataKeywords::Design::Graph::Edge::ARROW_MODE, "0").toInt();
+#ifdef HEIMER_UNIT_TEST
+    auto node0 = data.graph().getNode(record.index0);
+    auto node1 = data.graph().getNode(record.index1);
+#else
+    auto node0 = std::dynamic_pointer_cast<Node>(data.graph().getNode(record.index0));
+    auto node1 = std::dynamic_pointer_cast<Node>(data.graph().getNode(record.index1));
+#endif
+    if (!node0 || !node1) {
+        juzzlin::L().warning() << "Skipping edge " << record.index0 << " -> " << record.index1 << " with a missing node";
+        return {};
+    }
 
 #ifdef HEIMER_UNIT_TEST
-    auto node0 = data->graph().getNode(index0);
-    assert(node0);
-    auto node1 = data->graph().getNode(index1);
-    assert(node1);
     auto edge = make_shared<EdgeBase>(*node0, *node1);
 #else
     // Init a new edge. QGraphicsScene will take the ownership eventually.
-    auto node0 = std::dynamic_pointer_cast<Node>(data->graph().getNode(index0));
-    assert(node0);
-    auto node1 = std::dynamic_pointer_cast<Node>(data->graph().getNode(index1));
-    assert(node1);
     auto edge = make_shared<Edge>(*node0, *node1);
 #endif
-    edge->setArrowMode(static_cast<EdgeBase::ArrowMode>(arrowMode));
-    edge->setReversed(reversed);
-
-    readChildren(element, { { QString(Serializer::DataKeywords::Design::Graph::Node::TEXT), [=](const QDomElement & e) {
-                                 edge->setText(readFirstTextNodeContent(e));
-                             } } });
+    edge->setArrowMode(static_cast<EdgeBase::ArrowMode>(record.arrowMode));
+    edge->setReversed(record.reversed);
+    edge->setText(record.text);
 
     return edge;
 }
 
-static void readGraph(const QDomElement & graph, MindMapDataPtr data)
+struct GraphRecord
+{
+    MindMapData & data;
+
+    std::vector<EdgeRecord> edges;
+};
+
+static void readGraph(QXmlStreamReader & reader, MindMapData & data)
 {
-    readChildren(graph, {
-                          { QString(Serializer::DataKeywords::Design::Graph::NODE), [=](const QDomElement & e) {
-                               data->graph().addNode(readNode(e));
-                           } },
-                          { QString(Serializer::DataKeywords::Design::Graph::EDGE), [=](const QDomElement & e) {
-                               data->graph().addEdge(readEdge(e, data));
-                           } },
-                        });
+    // Build the graph in bulk: nodes are indexed once before edges are resolved against them
+    static const ElementHandlers<GraphRecord> handlers = {
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::NODE), [](QXmlStreamReader & reader, GraphRecord & graph) {
+             graph.data.graph().appendNode(readNode(reader));
+         } },
+        { QLatin1String(Serializer::DataKeywords::Design::Graph::EDGE), [](QXmlStreamReader & reader, GraphRecord & graph) {
+             graph.edges.push_back(readEdge(reader));
+         } }
+    };
+    GraphRecord graph { data, {} };
+    readChildren(reader, handlers, graph);
+
+    size_t rejected = data.graph().finalize();
+
+    data.graph().reserve(data.graph().numNodes(), graph.edges.size());
+    for (auto && record : graph.edges) {
+        if (const auto edge = createEdge(record, data)) {
+            data.graph().appendEdge(edge);
+        }
+    }
+    graph.edges.clear();
+
+    rejected += data.graph().finalize();
+    if (rejected) {
+        juzzlin::L().warning() << "Rejected " << rejected << " invalid nodes or edges";
+    }
+}
+
+struct DesignRecord
+{
+    MindMapData & data;
+
+    const ImageFiles & imageFiles;
+};
+
+static void readImage(QXmlStreamReader & reader, DesignRecord & design)
+{
+    const auto attributes = reader.attributes();
+    const auto id = attributes.value(QLatin1String(Serializer::DataKeywords::Design::Image::ID)).toUInt();
+    const auto path = attributes.value(QLatin1String(Serializer::DataKeywords::Design::Image::PATH)).toString().toStdString();
+    const auto hash = attributes.value(QLatin1String(Serializer::DataKeywords::Design::Image::HASH));
+    QByteArray content;
+    if (hash.isNull()) {
+        content = QByteArray::fromBase64(readTextContent(reader).toLatin1(), QByteArray::Base64Encoding);
+    } else {
+        reader.skipCurrentElement();
+        const auto file = design.imageFiles.find(hash.toLatin1());
+        if (file == design.imageFiles.end()) {
+            juzzlin::L().warning() << "Missing file for image id=" << id;
+            return;
+        }
+        content = file->second;
+    }
+
+    // The image is decoded only when a node shows it
+    Image image(content, path);
+    image.setId(id);
+    design.data.imageManager().setImage(image);
 }
 
 MindMapDataPtr fromXml(QDomDocument document)
 {
-    const auto design = document.documentElement();
+    QBuffer buffer;
+    buffer.setData(document.toByteArray());
+    buffer.open(QIODevice::ReadOnly);
+    return fromXml(buffer);
+}
+
+MindMapDataPtr fromXml(QIODevice & device, const ImageFiles & imageFiles)
+{
+    QXmlStreamReader reader(&device);
 
     auto data = make_shared<MindMapData>();
-    data->setVersion(design.attribute(DataKeywords::Design::APPLICATION_VERSION, "UNDEFINED"));
-
-    readChildren(design, { { QString(Serializer::DataKeywords::Design::GRAPH), [=](const QDomElement & e) {
-                                readGraph(e, data);
-                            } },
-                           { QString(Serializer::DataKeywords::Design::COLOR), [=](const QDomElement & e) {
-                                data->setBackgroundColor(readColorElement(e));
-                            } },
-                           { QString(Serializer::DataKeywords::Design::EDGE_COLOR), [=](const QDomElement & e) {
-                                data->setEdgeColor(readColorElement(e));
-                            } },
-                           { QString(Serializer::DataKeywords::Design::EDGE_THICKNESS), [=](const QDomElement & e) {
-                                data->setEdgeWidth(readFirstTextNodeContent(e).toDouble() / SCALE);
-                            } },
-                           { QString(Serializer::DataKeywords::Design::IMAGE), [=](const QDomElement & e) {
-                                const auto id = e.attribute(Serializer::DataKeywords::Design::Image::ID).toUInt();
-                                const auto path = e.attribute(Serializer::DataKeywords::Design::Image::PATH).toStdString();
-                                Image image(base64ToQImage(readFirstTextNodeContent(e).toStdString(), id, path), path);
-                                image.setId(id);
-                                data->imageManager().setImage(image);
-                            } },
-                           { QString(Serializer::DataKeywords::Design::TEXT_SIZE), [=](const QDomElement & e) {
-                                data->setTextSize(static_cast<int>(readFirstTextNodeContent(e).toDouble() / SCALE));
-                            } },
-                           { QString(Serializer::DataKeywords::Design::CORNER_RADIUS), [=](const QDomElement & e) {
-                                data->setCornerRadius(static_cast<int>(readFirstTextNodeContent(e).toDouble() / SCALE));
-                            } } });
+    if (reader.readNextStartElement()) {
+        const auto version = reader.attributes().value(QLatin1String(DataKeywords::Design::APPLICATION_VERSION));
+        data->setVersion(version.isNull() ? QString("UNDEFINED") : version.toString());
+
+        static const ElementHandlers<DesignRecord> handlers = {
+            { QLatin1String(Serializer::DataKeywords::Design::GRAPH), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 readGraph(reader, design.data);
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::COLOR), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 design.data.setBackgroundColor(readColorElement(reader));
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::EDGE_COLOR), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 design.data.setEdgeColor(readColorElement(reader));
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::EDGE_THICKNESS), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 design.data.setEdgeWidth(readTextContent(reader).toDouble() / SCALE);
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::IMAGE), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 readImage(reader, design);
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::TEXT_SIZE), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 design.data.setTextSize(static_cast<int>(readTextContent(reader).toDouble() / SCALE));
+             } },
+            { QLatin1String(Serializer::DataKeywords::Design::CORNER_RADIUS), [](QXmlStreamReader & reader, DesignRecord & design) {
+                 design.data.setCornerRadius(static_cast<int>(readTextContent(reader).toDouble() / SCALE));
+             } }
+        };
+        DesignRecord design { *data, imageFiles };
+        readChildren(reader, handlers, design);
+    }
+
+    // Check that the rest of the document is well-formed, too
+    while (!reader.atEnd()) {
+        reader.readNext();
+    }
+
+    if (reader.hasError()) {
+        juzzlin::L().error() << "Invalid XML at line " << reader.lineNumber() << ": " << reader.errorString().toStdString();
+        return {};
+    }
 
     return data;
 }
 
 QDomDocument toXml(MindMapData & mindMapData)
 {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    toXml(mindMapData, buffer);
+
     QDomDocument doc;
+    doc.setContent(buffer.data());
+    return doc;
+}
 
-    doc.appendChild(doc.createProcessingInstruction("xml", "version='1.0' encoding='UTF-8'"));
+bool toXml(MindMapData & mindMapData, QIODevice & device, const ImageHashes & imageHashes)
+{
+    QXmlStreamWriter writer(&device);
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(1);
 
-    auto design = doc.createElement(Serializer::DataKeywords::Design::DESIGN);
-    design.setAttribute(Serializer::DataKeywords::Design::APPLICATION_VERSION, Constants::Application::APPLICATION_VERSION);
-    doc.appendChild(design);
+    writer.writeStartDocument();
 
-    writeColor(design, doc, mindMapData.backgroundColor(), Serializer::DataKeywords::Design::COLOR);
+    writer.writeStartElement(Serializer::DataKeywords::Design::DESIGN);
+    writer.writeAttribute(Serializer::DataKeywords::Design::APPLICATION_VERSION, Constants::Application::APPLICATION_VERSION);
 
-    writeColor(design, doc, mindMapData.edgeColor(), Serializer::DataKeywords::Design::EDGE_COLOR);
+    writeColor(writer, mindMapData.backgroundColor(), Serializer::DataKeywords::Design::COLOR);
 
-    auto edgeWidthElement = doc.createElement(Serializer::DataKeywords::Design::EDGE_THICKNESS);
-    edgeWidthElement.appendChild(doc.createTextNode(QString::number(static_cast<int>(mindMapData.edgeWidth() * SCALE))));
-    design.appendChild(edgeWidthElement);
+    writeColor(writer, mindMapData.edgeColor(), Serializer::DataKeywords::Design::EDGE_COLOR);
 
-    auto textSizeElement = doc.createElement(Serializer::DataKeywords::Design::TEXT_SIZE);
-    textSizeElement.appendChild(doc.createTextNode(QString::number(static_cast<int>(mindMapData.textSize() * SCALE))));
-    design.appendChild(textSizeElement);
+    writer.writeTextElement(Serializer::DataKeywords::Design::EDGE_THICKNESS, QString::number(static_cast<int>(mindMapData.edgeWidth() * SCALE)));
 
-    auto cornerRadiusElement = doc.createElement(Serializer::DataKeywords::Design::CORNER_RADIUS);
-    cornerRadiusElement.appendChild(doc.createTextNode(QString::number(static_cast<int>(mindMapData.cornerRadius() * SCALE))));
-    design.appendChild(cornerRadiusElement);
+    writer.writeTextElement(Serializer::DataKeywords::Design::TEXT_SIZE, QString::number(static_cast<int>(mindMapData.textSize() * SCALE)));
 
-    auto graph = doc.createElement(Serializer::DataKeywords::Design::GRAPH);
-    design.appendChild(graph);
+    writer.writeTextElement(Serializer::DataKeywords::Design::CORNER_RADIUS, QString::number(static_cast<int>(mindMapData.cornerRadius() * SCALE)));
 
-    writeNodes(mindMapData, graph, doc);
+    writer.writeStartElement(Serializer::DataKeywords::Design::GRAPH);
 
-    writeEdges(mindMapData, graph, doc);
+    writeNodes(mindMapData, writer);
 
-    writeImages(mindMapData, design, doc);
+    writeEdges(mindMapData, writer);
 
-    return doc;
+    writer.writeEndElement();
+
+    writeImages(mindMapData, writer, imageHashes);
+
+    // Closes the design element, too
+    writer.writeEndDocument();
+
+    return !writer.hasError();
 }
 
 } // namespace Serializer
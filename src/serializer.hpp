@@ -18,14 +18,35 @@
 
 #include "mind_map_data.hpp"
 
+#include <QByteArray>
 #include <QDomDocument>
+#include <QIODevice>
+
+#include <map>
 
 namespace Serializer {
 
+//! Image id => content hash of an image file that is stored next to the XML instead of in it.
+using ImageHashes = std::map<size_t, QByteArray>;
+
+//! Content hash => image file that is stored next to the XML instead of in it.
+using ImageFiles = std::map<QByteArray, QByteArray>;
+
 MindMapDataPtr fromXml(QDomDocument document);
 
+/*! Builds the mind map in a single pass over the XML without an intermediate DOM.
+ *  Images that refer to a content hash are decoded from the given image files.
+ *  \return The mind map or nullptr if the XML is not well-formed. */
+MindMapDataPtr fromXml(QIODevice & device, const ImageFiles & imageFiles = ImageFiles());
+
 QDomDocument toXml(MindMapData & mindMapData);
 
+/*! Writes the mind map as XML straight to the device. Only a constant amount of memory is used on top of
+ *  the mind map, as also embedded images are encoded in chunks. Images found in imageHashes are not
+ *  embedded but refer to their content hash.
+ *  \return False if writing to the device failed. */
+bool toXml(MindMapData & mindMapData, QIODevice & device, const ImageHashes & imageHashes = ImageHashes());
+
 } // namespace Serializer
 
 #endif // SERIALIZER_HPP
@@ -0,0 +1,158 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "mind_map_generator.hpp"
+
+#include "argengine.hpp"
+#include "simple_logger.hpp"
+#include "writer.hpp"
+
+#include <QApplication>
+#include <QTemporaryDir>
+
+#include <cstdlib>
+#include <iostream>
+
+using juzzlin::Argengine;
+using juzzlin::L;
+
+int main(int argc, char ** argv)
+{
+    // Nodes are graphics items even though nothing is shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    MindMapGenerator::Parameters parameters;
+    QString fileName;
+    auto valid = true;
+
+    Argengine ae(argc, argv);
+
+    ae.addOption(
+      { "-n", "--nodes" }, [&](std::string value) {
+          parameters.nodeCount = std::stoul(value);
+      },
+      false, "Number of nodes. Default: 1000.");
+
+    ae.addOption(
+      { "-b", "--branching" }, [&](std::string value) {
+          parameters.branchingFactor = std::stoul(value);
+      },
+      false, "Maximum number of children of a node, 0 for no limit. Default: 4.");
+
+    ae.addOption(
+      { "-d", "--depth" }, [&](std::string value) {
+          parameters.depth = std::stoul(value);
+      },
+      false, "Maximum depth of the tree, 0 for no limit. Default: 0.");
+
+    ae.addOption(
+      { "--cross-edges" }, [&](std::string value) {
+          parameters.crossEdgeCount = std::stoul(value);
+      },
+      false, "Number of edges between random nodes in addition to the tree. Default: 0.");
+
+    ae.addOption(
+      { "--text-length" }, [&](std::string value) {
+          parameters.textLength = std::stoi(value);
+          valid = valid && parameters.textLength >= 0;
+      },
+      false, "Mean length of node texts in characters. Default: 50.");
+
+    ae.addOption(
+      { "--text-distribution" }, [&](std::string value) {
+          if (value == "fixed") {
+              parameters.textDistribution = MindMapGenerator::TextDistribution::Fixed;
+          } else if (value == "uniform") {
+              parameters.textDistribution = MindMapGenerator::TextDistribution::Uniform;
+          } else if (value == "exponential") {
+              parameters.textDistribution = MindMapGenerator::TextDistribution::Exponential;
+          } else {
+              valid = false;
+          }
+      },
+      false, "Distribution of text lengths: fixed, uniform or exponential. Default: uniform.");
+
+    ae.addOption(
+      { "--edge-labels" }, [&](std::string value) {
+          parameters.edgeLabelRatio = std::stod(value);
+          valid = valid && parameters.edgeLabelRatio >= 0 && parameters.edgeLabelRatio <= 1;
+      },
+      false, "Probability of an edge having a label. Default: 0.1.");
+
+    ae.addOption(
+      { "--random-colors" }, [&] {
+          parameters.randomColors = true;
+      },
+      false, "Use random colors for the nodes, the edges and the background.");
+
+    ae.addOption(
+      { "--images" }, [&](std::string value) {
+          parameters.imageCount = std::stoul(value);
+      },
+      false, "Number of nodes with an image. Default: 0.");
+
+    ae.addOption(
+      { "--image-size" }, [&](std::string value) {
+          parameters.imageSize = std::stoi(value);
+          valid = valid && parameters.imageSize > 0;
+      },
+      false, "Width and height of the images in pixels. Default: 256.");
+
+    ae.addOption(
+      { "--spread" }, [&](std::string value) {
+          parameters.spread = std::stoi(value);
+      },
+      false, "Distance from a node to its children. Default: 200.");
+
+    ae.addOption(
+      { "--seed" }, [&](std::string value) {
+          parameters.seed = static_cast<unsigned int>(std::stoul(value));
+      },
+      false, "Seed of the random generator. Default: 1.");
+
+    ae.setPositionalArgumentCallback([&](Argengine::ArgumentVector args) {
+        fileName = args.at(0).c_str();
+    });
+
+    ae.setHelpText(std::string("\nUsage: ") + argv[0] + " [OPTIONS] MIND_MAP_FILE\n\nGenerates a synthetic mind map. The same options give the same map.");
+
+    ae.parse();
+
+    if (!valid || fileName.isEmpty()) {
+        std::cerr << "Invalid arguments, see --help" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    QTemporaryDir imageDirectory;
+    if (!imageDirectory.isValid()) {
+        L().error() << "Cannot create a temporary directory";
+        return EXIT_FAILURE;
+    }
+
+    const auto data = MindMapGenerator(parameters).generate(imageDirectory.path());
+    if (!data) {
+        return EXIT_FAILURE;
+    }
+
+    if (!Writer::writeToFile(*data, fileName)) {
+        L().error() << "Cannot write '" << fileName.toStdString() << "'";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
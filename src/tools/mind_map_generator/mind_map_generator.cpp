@@ -0,0 +1,200 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "mind_map_generator.hpp"
+
+#include "edge.hpp"
+#include "image.hpp"
+#include "node.hpp"
+#include "simple_logger.hpp"
+
+#include <QImage>
+#include <QStringList>
+
+#include <cmath>
+#include <set>
+#include <vector>
+
+using juzzlin::L;
+
+MindMapGenerator::MindMapGenerator(const Parameters & parameters)
+  : m_parameters(parameters)
+  , m_engine(parameters.seed)
+{
+}
+
+MindMapDataPtr MindMapGenerator::generate(const QString & imageDirectory)
+{
+    auto data = std::make_shared<MindMapData>();
+    data->imageManager().clear(); // Shared between maps
+    if (m_parameters.randomColors) {
+        data->setBackgroundColor(randomColor());
+        data->setEdgeColor(randomColor());
+    }
+
+    auto && graph = data->graph();
+    graph.reserve(m_parameters.nodeCount, m_parameters.nodeCount + m_parameters.crossEdgeCount);
+
+    // Nodes that can still get children with their depths and numbers of children
+    struct Parent
+    {
+        size_t node;
+
+        size_t depth;
+
+        size_t children;
+    };
+    std::vector<Parent> parents;
+
+    const double pi = std::acos(-1);
+    std::uniform_real_distribution<double> angle(0, 2 * pi);
+    std::vector<NodePtr> nodes;
+    std::set<std::pair<size_t, size_t>> pairs;
+    for (size_t i = 0; i < m_parameters.nodeCount; i++) {
+        const auto node = std::make_shared<Node>();
+        node->setText(randomText(textLength()));
+        if (m_parameters.randomColors) {
+            node->setColor(randomColor());
+            node->setTextColor(randomColor());
+        }
+
+        size_t depth = 0;
+        if (i) {
+            if (parents.empty()) {
+                L().error() << "Cannot fit " << m_parameters.nodeCount << " nodes in depth " << m_parameters.depth
+                            << " with branching factor " << m_parameters.branchingFactor;
+                return nullptr;
+            }
+
+            const auto position = std::uniform_int_distribution<size_t>(0, parents.size() - 1)(m_engine);
+            auto && parent = parents.at(position);
+            pairs.insert({ parent.node, i });
+            depth = parent.depth + 1;
+
+            const auto a = angle(m_engine);
+            const auto location = nodes.at(parent.node)->location();
+            node->setLocation({ location.x() + std::round(m_parameters.spread * std::cos(a)),
+                                location.y() + std::round(m_parameters.spread * std::sin(a)) });
+
+            if (++parent.children == m_parameters.branchingFactor) {
+                parent = parents.back();
+                parents.pop_back();
+            }
+        }
+
+        if (!m_parameters.depth || depth < m_parameters.depth) {
+            parents.push_back({ i, depth, 0 });
+        }
+
+        graph.addNode(node);
+        nodes.push_back(node);
+    }
+
+    // The tree is directed from parents to children, so a cross edge in either direction is a new one
+    const auto maxEdgeCount = nodes.size() * (nodes.size() - 1) / 2;
+    const auto edgeCount = std::min(pairs.size() + m_parameters.crossEdgeCount, maxEdgeCount);
+    std::uniform_int_distribution<size_t> randomNode(0, nodes.empty() ? 0 : nodes.size() - 1);
+    std::set<std::pair<size_t, size_t>> connected;
+    for (auto && pair : pairs) {
+        connected.insert({ std::min(pair.first, pair.second), std::max(pair.first, pair.second) });
+    }
+    while (pairs.size() < edgeCount) {
+        const auto node0 = randomNode(m_engine);
+        const auto node1 = randomNode(m_engine);
+        if (node0 != node1 && connected.insert({ std::min(node0, node1), std::max(node0, node1) }).second) {
+            pairs.insert({ node0, node1 });
+        }
+    }
+
+    std::bernoulli_distribution label(m_parameters.edgeLabelRatio);
+    std::uniform_int_distribution<int> arrowMode(0, 2);
+    std::bernoulli_distribution reversed(0.1);
+    for (auto && pair : pairs) {
+        const auto edge = std::make_shared<Edge>(*nodes.at(pair.first), *nodes.at(pair.second));
+        if (label(m_engine)) {
+            edge->setText(randomText(std::max(1, textLength() / 10)));
+        }
+        edge->setArrowMode(static_cast<EdgeBase::ArrowMode>(arrowMode(m_engine)));
+        edge->setReversed(reversed(m_engine));
+        graph.addEdge(edge);
+    }
+
+    // Noise doesn't compress, so the images are as big as they can get
+    std::uniform_int_distribution<unsigned int> pixel(0, 0xffffff);
+    const auto imageCount = std::min(m_parameters.imageCount, nodes.size());
+    for (size_t i = 0; i < imageCount; i++) {
+        QImage image(m_parameters.imageSize, m_parameters.imageSize, QImage::Format_RGB32);
+        for (int y = 0; y < image.height(); y++) {
+            for (int x = 0; x < image.width(); x++) {
+                image.setPixel(x, y, pixel(m_engine));
+            }
+        }
+
+        const auto path = QString("%1/image%2.png").arg(imageDirectory).arg(i);
+        if (!image.save(path)) {
+            L().error() << "Cannot write '" << path.toStdString() << "'";
+            return nullptr;
+        }
+
+        nodes.at(i * nodes.size() / imageCount)->setImageRef(data->imageManager().addImage(Image(image, path.toStdString())));
+    }
+
+    return data;
+}
+
+int MindMapGenerator::textLength()
+{
+    const auto mean = m_parameters.textLength;
+    switch (m_parameters.textDistribution) {
+    case TextDistribution::Fixed:
+        break;
+    case TextDistribution::Uniform:
+        return std::uniform_int_distribution<int>(0, 2 * mean)(m_engine);
+    case TextDistribution::Exponential:
+        // Mostly short texts with a long tail
+        return mean > 0 ? static_cast<int>(std::exponential_distribution<double>(1.0 / mean)(m_engine)) : 0;
+    }
+
+    return mean;
+}
+
+QString MindMapGenerator::randomText(int length)
+{
+    // Includes non-Latin scripts, line breaks and characters escaped in XML
+    static const QStringList words = {
+        "mind", "map", "node", "edge", "idea", "plan", "<tag>", "&amp;", "\"quoted\"", "line\nbreak",
+        QString("k%1%1nen").arg(QChar(0x00e4)),
+        QString(QChar(0x65e5)) + QChar(0x672c) + QChar(0x8a9e)
+    };
+    std::uniform_int_distribution<int> word(0, words.size() - 1);
+
+    QString text;
+    while (text.size() < length) {
+        if (!text.isEmpty()) {
+            text += ' ';
+        }
+        text += words.at(word(m_engine));
+    }
+    return text;
+}
+
+QColor MindMapGenerator::randomColor()
+{
+    std::uniform_int_distribution<int> component(0, 255);
+    const auto r = component(m_engine);
+    const auto g = component(m_engine);
+    const auto b = component(m_engine);
+    return { r, g, b };
+}
@@ -0,0 +1,93 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MIND_MAP_GENERATOR_HPP
+#define MIND_MAP_GENERATOR_HPP
+
+#include "mind_map_data.hpp"
+
+#include <QColor>
+#include <QString>
+
+#include <random>
+
+/*! Generates synthetic mind maps for benchmarks and tests. The same parameters give the same map.
+ *
+ *  The nodes form a random tree within the given branching factor and depth, and cross edges are added
+ *  between random pairs of nodes. Coordinates are integers and colors opaque, so that a generated map
+ *  survives a round-trip through the file format as it is. */
+class MindMapGenerator
+{
+public:
+    enum class TextDistribution
+    {
+        Fixed,
+        Uniform,
+        Exponential
+    };
+
+    struct Parameters
+    {
+        size_t nodeCount = 1000;
+
+        //! Maximum number of children of a node, 0 for no limit
+        size_t branchingFactor = 4;
+
+        //! Maximum depth of the tree, 0 for no limit
+        size_t depth = 0;
+
+        //! Number of edges in addition to the tree
+        size_t crossEdgeCount = 0;
+
+        //! Mean length of node texts in characters. Edge labels are a tenth of that.
+        int textLength = 50;
+
+        TextDistribution textDistribution = TextDistribution::Uniform;
+
+        //! Probability of an edge having a label
+        double edgeLabelRatio = 0.1;
+
+        bool randomColors = false;
+
+        size_t imageCount = 0;
+
+        int imageSize = 256;
+
+        //! Distance from a node to its children
+        int spread = 200;
+
+        unsigned int seed = 1;
+    };
+
+    explicit MindMapGenerator(const Parameters & parameters);
+
+    /*! The file format embeds images from files, so the images are written to the given directory.
+     *  \return The map or nullptr if the parameters can't be met, e.g. the depth and the branching factor
+     *  don't allow that many nodes. */
+    MindMapDataPtr generate(const QString & imageDirectory);
+
+private:
+    int textLength();
+
+    QString randomText(int length);
+
+    QColor randomColor();
+
+    Parameters m_parameters;
+
+    std::mt19937 m_engine;
+};
+
+#endif // MIND_MAP_GENERATOR_HPP
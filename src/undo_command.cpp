@@ -0,0 +1,619 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "undo_command.hpp"
+
+#include "edge.hpp"
+#include "mind_map_data.hpp"
+#include "node.hpp"
+
+#include <QDataStream>
+
+#include <map>
+
+namespace {
+
+EdgeBase * getEdge(Graph & graph, const EdgeRecord & edge)
+{
+    return graph.getEdge(graph.getNodeId(edge.sourceIndex), graph.getNodeId(edge.targetIndex));
+}
+
+SetStyleCommand::Style style(const MindMapDataSnapshot & snapshot)
+{
+    SetStyleCommand::Style style;
+    style.backgroundColor = snapshot.backgroundColor;
+    style.edgeColor = snapshot.edgeColor;
+    style.edgeWidth = snapshot.edgeWidth;
+    style.textSize = snapshot.textSize;
+    style.cornerRadius = snapshot.cornerRadius;
+    return style;
+}
+
+bool isSameStyle(const SetStyleCommand::Style & style0, const SetStyleCommand::Style & style1)
+{
+    return style0.backgroundColor == style1.backgroundColor && style0.edgeColor == style1.edgeColor && style0.edgeWidth == style1.edgeWidth
+      && style0.textSize == style1.textSize && style0.cornerRadius == style1.cornerRadius;
+}
+
+size_t textSize(const QString & text)
+{
+    return static_cast<size_t>(text.capacity()) * sizeof(QChar);
+}
+
+size_t recordSize(const NodeRecord & node)
+{
+    return sizeof(node) + textSize(node.text);
+}
+
+size_t recordSize(const EdgeRecord & edge)
+{
+    return sizeof(edge) + textSize(edge.text);
+}
+
+void writeRecord(QDataStream & stream, const NodeRecord & node)
+{
+    stream << node.index << node.text << node.color << node.textColor << node.textSize << node.cornerRadius << node.location << node.size
+           << static_cast<quint64>(node.imageRef);
+}
+
+NodeRecord readNodeRecord(QDataStream & stream)
+{
+    NodeRecord node;
+    quint64 imageRef = 0;
+    stream >> node.index >> node.text >> node.color >> node.textColor >> node.textSize >> node.cornerRadius >> node.location >> node.size >> imageRef;
+    node.imageRef = static_cast<size_t>(imageRef);
+    return node;
+}
+
+void writeRecord(QDataStream & stream, const EdgeRecord & edge)
+{
+    stream << edge.sourceIndex << edge.targetIndex << edge.text << static_cast<int>(edge.arrowMode) << edge.reversed;
+}
+
+EdgeRecord readEdgeRecord(QDataStream & stream)
+{
+    EdgeRecord edge;
+    int arrowMode = 0;
+    stream >> edge.sourceIndex >> edge.targetIndex >> edge.text >> arrowMode >> edge.reversed;
+    edge.arrowMode = static_cast<EdgeBase::ArrowMode>(arrowMode);
+    return edge;
+}
+
+void writeStyle(QDataStream & stream, const SetStyleCommand::Style & style)
+{
+    stream << style.backgroundColor << style.edgeColor << style.edgeWidth << style.textSize << style.cornerRadius;
+}
+
+SetStyleCommand::Style readStyle(QDataStream & stream)
+{
+    SetStyleCommand::Style style;
+    stream >> style.backgroundColor >> style.edgeColor >> style.edgeWidth >> style.textSize >> style.cornerRadius;
+    return style;
+}
+
+} // namespace
+
+UndoCommand::~UndoCommand() = default;
+
+UndoCommandPtr UndoCommand::read(QDataStream & stream)
+{
+    quint8 type = 0;
+    stream >> type;
+
+    UndoCommandPtr command;
+    switch (static_cast<Type>(type)) {
+    case Type::AddNode:
+        command.reset(new AddNodeCommand(readNodeRecord(stream)));
+        break;
+    case Type::RemoveNode:
+        command.reset(new RemoveNodeCommand(readNodeRecord(stream)));
+        break;
+    case Type::MoveNode: {
+        int index = -1;
+        QPointF from;
+        QPointF to;
+        stream >> index >> from >> to;
+        command.reset(new MoveNodeCommand(index, from, to));
+        break;
+    }
+    case Type::SetNode: {
+        const auto before = readNodeRecord(stream);
+        command.reset(new SetNodeCommand(before, readNodeRecord(stream)));
+        break;
+    }
+    case Type::AddEdge:
+        command.reset(new AddEdgeCommand(readEdgeRecord(stream)));
+        break;
+    case Type::RemoveEdge:
+        command.reset(new RemoveEdgeCommand(readEdgeRecord(stream)));
+        break;
+    case Type::SetEdge: {
+        const auto before = readEdgeRecord(stream);
+        command.reset(new SetEdgeCommand(before, readEdgeRecord(stream)));
+        break;
+    }
+    case Type::SetStyle: {
+        const auto before = readStyle(stream);
+        command.reset(new SetStyleCommand(before, readStyle(stream)));
+        break;
+    }
+    case Type::Compound: {
+        quint32 count = 0;
+        stream >> count;
+        std::unique_ptr<CompoundCommand> compound(new CompoundCommand);
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+            auto child = read(stream);
+            if (!child) {
+                return nullptr;
+            }
+            compound->add(std::move(child));
+        }
+        command = std::move(compound);
+        break;
+    }
+    case Type::Compressed: {
+        QByteArray data;
+        stream >> data;
+        QDataStream uncompressed(qUncompress(data));
+        command = read(uncompressed);
+        break;
+    }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        return nullptr;
+    }
+
+    return command;
+}
+
+AddNodeCommand::AddNodeCommand(const NodeRecord & node)
+  : m_node(node)
+{
+}
+
+const NodeRecord & AddNodeCommand::node() const
+{
+    return m_node;
+}
+
+void AddNodeCommand::redo(MindMapData & mindMapData) const
+{
+    const auto node = std::make_shared<Node>();
+    m_node.applyTo(*node);
+    mindMapData.graph().addNode(node);
+}
+
+void AddNodeCommand::undo(MindMapData & mindMapData) const
+{
+    mindMapData.graph().deleteNode(m_node.index);
+}
+
+size_t AddNodeCommand::byteSize() const
+{
+    return sizeof(*this) - sizeof(m_node) + recordSize(m_node);
+}
+
+void AddNodeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::AddNode);
+    writeRecord(stream, m_node);
+}
+
+RemoveNodeCommand::RemoveNodeCommand(const NodeRecord & node)
+  : m_addNode(node)
+{
+}
+
+void RemoveNodeCommand::redo(MindMapData & mindMapData) const
+{
+    m_addNode.undo(mindMapData);
+}
+
+void RemoveNodeCommand::undo(MindMapData & mindMapData) const
+{
+    m_addNode.redo(mindMapData);
+}
+
+size_t RemoveNodeCommand::byteSize() const
+{
+    return m_addNode.byteSize();
+}
+
+void RemoveNodeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::RemoveNode);
+    writeRecord(stream, m_addNode.node());
+}
+
+MoveNodeCommand::MoveNodeCommand(int index, QPointF from, QPointF to)
+  : m_index(index)
+  , m_from(from)
+  , m_to(to)
+{
+}
+
+void MoveNodeCommand::redo(MindMapData & mindMapData) const
+{
+    if (const auto node = mindMapData.graph().getNode(m_index)) {
+        node->setLocation(m_to);
+    }
+}
+
+void MoveNodeCommand::undo(MindMapData & mindMapData) const
+{
+    if (const auto node = mindMapData.graph().getNode(m_index)) {
+        node->setLocation(m_from);
+    }
+}
+
+size_t MoveNodeCommand::byteSize() const
+{
+    return sizeof(*this);
+}
+
+void MoveNodeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::MoveNode) << m_index << m_from << m_to;
+}
+
+SetNodeCommand::SetNodeCommand(const NodeRecord & before, const NodeRecord & after)
+  : m_before(before)
+  , m_after(after)
+{
+}
+
+void SetNodeCommand::redo(MindMapData & mindMapData) const
+{
+    if (const auto node = mindMapData.graph().getNode(m_after.index)) {
+        m_after.applyTo(*node, m_before);
+    }
+}
+
+void SetNodeCommand::undo(MindMapData & mindMapData) const
+{
+    if (const auto node = mindMapData.graph().getNode(m_before.index)) {
+        m_before.applyTo(*node, m_after);
+    }
+}
+
+size_t SetNodeCommand::byteSize() const
+{
+    return sizeof(*this) + textSize(m_before.text) + textSize(m_after.text);
+}
+
+void SetNodeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::SetNode);
+    writeRecord(stream, m_before);
+    writeRecord(stream, m_after);
+}
+
+AddEdgeCommand::AddEdgeCommand(const EdgeRecord & edge)
+  : m_edge(edge)
+{
+}
+
+const EdgeRecord & AddEdgeCommand::edge() const
+{
+    return m_edge;
+}
+
+void AddEdgeCommand::redo(MindMapData & mindMapData) const
+{
+    auto && graph = mindMapData.graph();
+    const auto sourceNode = std::dynamic_pointer_cast<Node>(graph.getNode(m_edge.sourceIndex));
+    const auto targetNode = std::dynamic_pointer_cast<Node>(graph.getNode(m_edge.targetIndex));
+    if (sourceNode && targetNode) {
+        const auto edge = std::make_shared<Edge>(*sourceNode, *targetNode);
+        m_edge.applyTo(*edge);
+        graph.addEdge(edge);
+    }
+}
+
+void AddEdgeCommand::undo(MindMapData & mindMapData) const
+{
+    mindMapData.graph().deleteEdge(m_edge.sourceIndex, m_edge.targetIndex);
+}
+
+size_t AddEdgeCommand::byteSize() const
+{
+    return sizeof(*this) - sizeof(m_edge) + recordSize(m_edge);
+}
+
+void AddEdgeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::AddEdge);
+    writeRecord(stream, m_edge);
+}
+
+RemoveEdgeCommand::RemoveEdgeCommand(const EdgeRecord & edge)
+  : m_addEdge(edge)
+{
+}
+
+void RemoveEdgeCommand::redo(MindMapData & mindMapData) const
+{
+    m_addEdge.undo(mindMapData);
+}
+
+void RemoveEdgeCommand::undo(MindMapData & mindMapData) const
+{
+    m_addEdge.redo(mindMapData);
+}
+
+size_t RemoveEdgeCommand::byteSize() const
+{
+    return m_addEdge.byteSize();
+}
+
+void RemoveEdgeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::RemoveEdge);
+    writeRecord(stream, m_addEdge.edge());
+}
+
+SetEdgeCommand::SetEdgeCommand(const EdgeRecord & before, const EdgeRecord & after)
+  : m_before(before)
+  , m_after(after)
+{
+}
+
+void SetEdgeCommand::redo(MindMapData & mindMapData) const
+{
+    if (const auto edge = getEdge(mindMapData.graph(), m_after)) {
+        m_after.applyTo(*edge, m_before);
+    }
+}
+
+void SetEdgeCommand::undo(MindMapData & mindMapData) const
+{
+    if (const auto edge = getEdge(mindMapData.graph(), m_before)) {
+        m_before.applyTo(*edge, m_after);
+    }
+}
+
+size_t SetEdgeCommand::byteSize() const
+{
+    return sizeof(*this) + textSize(m_before.text) + textSize(m_after.text);
+}
+
+void SetEdgeCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::SetEdge);
+    writeRecord(stream, m_before);
+    writeRecord(stream, m_after);
+}
+
+SetStyleCommand::SetStyleCommand(const Style & before, const Style & after)
+  : m_before(before)
+  , m_after(after)
+{
+}
+
+void SetStyleCommand::redo(MindMapData & mindMapData) const
+{
+    apply(mindMapData, m_after);
+}
+
+void SetStyleCommand::undo(MindMapData & mindMapData) const
+{
+    apply(mindMapData, m_before);
+}
+
+size_t SetStyleCommand::byteSize() const
+{
+    return sizeof(*this);
+}
+
+void SetStyleCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::SetStyle);
+    writeStyle(stream, m_before);
+    writeStyle(stream, m_after);
+}
+
+void SetStyleCommand::apply(MindMapData & mindMapData, const Style & style) const
+{
+    // Only the settings that differ are applied, as some of the setters touch every node or edge
+    if (mindMapData.backgroundColor() != style.backgroundColor) {
+        mindMapData.setBackgroundColor(style.backgroundColor);
+    }
+
+    if (mindMapData.edgeColor() != style.edgeColor) {
+        mindMapData.setEdgeColor(style.edgeColor);
+    }
+
+    if (mindMapData.edgeWidth() != style.edgeWidth) {
+        mindMapData.setEdgeWidth(style.edgeWidth);
+    }
+
+    if (mindMapData.textSize() != style.textSize) {
+        mindMapData.setTextSize(style.textSize);
+    }
+
+    if (mindMapData.cornerRadius() != style.cornerRadius) {
+        mindMapData.setCornerRadius(style.cornerRadius);
+    }
+}
+
+std::unique_ptr<CompoundCommand> CompoundCommand::fromSnapshots(const MindMapDataSnapshot & before, const MindMapDataSnapshot & after)
+{
+    // Collect the records at the positions that differ. Removals move items to other positions, so an unchanged
+    // item may be found at a differing position too, but then it's found on both sides and compares equal.
+    std::map<int, NodeRecord> nodesBefore;
+    std::map<int, NodeRecord> nodesAfter;
+    before.graph.nodes.forEachDifference(after.graph.nodes, [&](size_t position) {
+        if (position < before.graph.nodes.size()) {
+            auto && node = before.graph.nodes.at(position);
+            nodesBefore[node.index] = node;
+        }
+        if (position < after.graph.nodes.size()) {
+            auto && node = after.graph.nodes.at(position);
+            nodesAfter[node.index] = node;
+        }
+    });
+
+    using EdgeKey = std::pair<int, int>;
+    std::map<EdgeKey, EdgeRecord> edgesBefore;
+    std::map<EdgeKey, EdgeRecord> edgesAfter;
+    before.graph.edges.forEachDifference(after.graph.edges, [&](size_t position) {
+        if (position < before.graph.edges.size()) {
+            auto && edge = before.graph.edges.at(position);
+            edgesBefore[{ edge.sourceIndex, edge.targetIndex }] = edge;
+        }
+        if (position < after.graph.edges.size()) {
+            auto && edge = after.graph.edges.at(position);
+            edgesAfter[{ edge.sourceIndex, edge.targetIndex }] = edge;
+        }
+    });
+
+    std::unique_ptr<CompoundCommand> command(new CompoundCommand);
+
+    // Edges are removed before their nodes and added after them, in both directions
+    for (auto && edge : edgesBefore) {
+        if (!edgesAfter.count(edge.first)) {
+            command->add(UndoCommandPtr(new RemoveEdgeCommand(edge.second)));
+        }
+    }
+
+    for (auto && node : nodesBefore) {
+        if (!nodesAfter.count(node.first)) {
+            command->add(UndoCommandPtr(new RemoveNodeCommand(node.second)));
+        }
+    }
+
+    for (auto && node : nodesAfter) {
+        if (!nodesBefore.count(node.first)) {
+            command->add(UndoCommandPtr(new AddNodeCommand(node.second)));
+        }
+    }
+
+    for (auto && edge : edgesAfter) {
+        if (!edgesBefore.count(edge.first)) {
+            command->add(UndoCommandPtr(new AddEdgeCommand(edge.second)));
+        }
+    }
+
+    for (auto && node : nodesAfter) {
+        const auto nodeBefore = nodesBefore.find(node.first);
+        if (nodeBefore != nodesBefore.end() && nodeBefore->second != node.second) {
+            auto moved = nodeBefore->second;
+            moved.location = node.second.location;
+            if (moved == node.second) {
+                command->add(UndoCommandPtr(new MoveNodeCommand(node.first, nodeBefore->second.location, node.second.location)));
+            } else {
+                command->add(UndoCommandPtr(new SetNodeCommand(nodeBefore->second, node.second)));
+            }
+        }
+    }
+
+    for (auto && edge : edgesAfter) {
+        const auto edgeBefore = edgesBefore.find(edge.first);
+        if (edgeBefore != edgesBefore.end() && edgeBefore->second != edge.second) {
+            command->add(UndoCommandPtr(new SetEdgeCommand(edgeBefore->second, edge.second)));
+        }
+    }
+
+    // Last, so that undo applies the map-wide settings before the nodes get their own state back
+    const auto styleBefore = style(before);
+    const auto styleAfter = style(after);
+    if (!isSameStyle(styleBefore, styleAfter)) {
+        command->add(UndoCommandPtr(new SetStyleCommand(styleBefore, styleAfter)));
+    }
+
+    return command;
+}
+
+void CompoundCommand::add(UndoCommandPtr command)
+{
+    m_byteSize += sizeof(UndoCommandPtr) + command->byteSize();
+    m_commands.push_back(std::move(command));
+}
+
+bool CompoundCommand::isEmpty() const
+{
+    return m_commands.empty();
+}
+
+size_t CompoundCommand::size() const
+{
+    return m_commands.size();
+}
+
+void CompoundCommand::redo(MindMapData & mindMapData) const
+{
+    for (auto && command : m_commands) {
+        command->redo(mindMapData);
+    }
+}
+
+void CompoundCommand::undo(MindMapData & mindMapData) const
+{
+    for (auto command = m_commands.rbegin(); command != m_commands.rend(); command++) {
+        (*command)->undo(mindMapData);
+    }
+}
+
+size_t CompoundCommand::byteSize() const
+{
+    return m_byteSize;
+}
+
+void CompoundCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::Compound) << static_cast<quint32>(m_commands.size());
+    for (auto && command : m_commands) {
+        command->write(stream);
+    }
+}
+
+CompressedCommand::CompressedCommand(const UndoCommand & command)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    command.write(stream);
+    m_data = qCompress(data);
+}
+
+void CompressedCommand::redo(MindMapData & mindMapData) const
+{
+    decompress()->redo(mindMapData);
+}
+
+void CompressedCommand::undo(MindMapData & mindMapData) const
+{
+    decompress()->undo(mindMapData);
+}
+
+size_t CompressedCommand::byteSize() const
+{
+    return sizeof(*this) + static_cast<size_t>(m_data.capacity());
+}
+
+void CompressedCommand::write(QDataStream & stream) const
+{
+    stream << static_cast<quint8>(Type::Compressed) << m_data;
+}
+
+UndoCommandPtr CompressedCommand::decompress() const
+{
+    QDataStream stream(qUncompress(m_data));
+    auto command = read(stream);
+    if (!command) {
+        throw CorruptCommandException("Corrupt compressed undo command");
+    }
+    return command;
+}
@@ -0,0 +1,303 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UNDO_COMMAND_HPP
+#define UNDO_COMMAND_HPP
+
+#include "graph_snapshot.hpp"
+
+#include <QByteArray>
+#include <QColor>
+#include <QPointF>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class MindMapData;
+class QDataStream;
+struct MindMapDataSnapshot;
+
+//! Thrown by UndoCommand::redo() and UndoCommand::undo() when a stored command cannot be read back.
+//! The mind map is left unchanged.
+class CorruptCommandException : public std::runtime_error
+{
+public:
+    explicit CorruptCommandException(const std::string & what)
+      : std::runtime_error(what)
+    {
+    }
+};
+
+//! A reversible edit of a MindMapData. Commands modify the mind map in place and hold only the state of
+//! the items they change, so the memory used by the undo history is proportional to the size of the edits.
+class UndoCommand
+{
+public:
+    virtual ~UndoCommand();
+
+    //! \throws CorruptCommandException if the command is stored and cannot be read back.
+    virtual void redo(MindMapData & mindMapData) const = 0;
+
+    //! \throws CorruptCommandException if the command is stored and cannot be read back.
+    virtual void undo(MindMapData & mindMapData) const = 0;
+
+    //! \return Approximate memory taken by the command in bytes.
+    virtual size_t byteSize() const = 0;
+
+    //! Writes the command so that read() can recreate it.
+    virtual void write(QDataStream & stream) const = 0;
+
+    //! \return Command written by write() or nullptr if the data is corrupt.
+    static std::unique_ptr<UndoCommand> read(QDataStream & stream);
+
+protected:
+    enum class Type : quint8
+    {
+        AddNode,
+        RemoveNode,
+        MoveNode,
+        SetNode,
+        AddEdge,
+        RemoveEdge,
+        SetEdge,
+        SetStyle,
+        Compound,
+        Compressed
+    };
+};
+
+using UndoCommandPtr = std::unique_ptr<UndoCommand>;
+
+class AddNodeCommand : public UndoCommand
+{
+public:
+    explicit AddNodeCommand(const NodeRecord & node);
+
+    const NodeRecord & node() const;
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    NodeRecord m_node;
+};
+
+class RemoveNodeCommand : public UndoCommand
+{
+public:
+    //! Edges of the node must be removed with RemoveEdgeCommands before this command.
+    explicit RemoveNodeCommand(const NodeRecord & node);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    AddNodeCommand m_addNode;
+};
+
+class MoveNodeCommand : public UndoCommand
+{
+public:
+    MoveNodeCommand(int index, QPointF from, QPointF to);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    int m_index;
+
+    QPointF m_from;
+
+    QPointF m_to;
+};
+
+//! Changes any properties of a node. Only the changed properties are applied to the node.
+class SetNodeCommand : public UndoCommand
+{
+public:
+    SetNodeCommand(const NodeRecord & before, const NodeRecord & after);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    NodeRecord m_before;
+
+    NodeRecord m_after;
+};
+
+class AddEdgeCommand : public UndoCommand
+{
+public:
+    explicit AddEdgeCommand(const EdgeRecord & edge);
+
+    const EdgeRecord & edge() const;
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    EdgeRecord m_edge;
+};
+
+class RemoveEdgeCommand : public UndoCommand
+{
+public:
+    explicit RemoveEdgeCommand(const EdgeRecord & edge);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    AddEdgeCommand m_addEdge;
+};
+
+//! Changes any properties of an edge. Only the changed properties are applied to the edge.
+class SetEdgeCommand : public UndoCommand
+{
+public:
+    SetEdgeCommand(const EdgeRecord & before, const EdgeRecord & after);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    EdgeRecord m_before;
+
+    EdgeRecord m_after;
+};
+
+//! Changes the map-wide settings of a mind map
+class SetStyleCommand : public UndoCommand
+{
+public:
+    struct Style
+    {
+        QColor backgroundColor;
+
+        QColor edgeColor;
+
+        double edgeWidth = 0;
+
+        int textSize = 0;
+
+        int cornerRadius = 0;
+    };
+
+    SetStyleCommand(const Style & before, const Style & after);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    void apply(MindMapData & mindMapData, const Style & style) const;
+
+    Style m_before;
+
+    Style m_after;
+};
+
+//! Runs its commands in order on redo and in reverse order on undo
+class CompoundCommand : public UndoCommand
+{
+public:
+    /*! \return Command that turns the state before into the state after. The snapshots are compared chunk by
+     *  chunk, so this takes time proportional to the number of items changed in between when after was taken
+     *  from the same mind map as before. */
+    static std::unique_ptr<CompoundCommand> fromSnapshots(const MindMapDataSnapshot & before, const MindMapDataSnapshot & after);
+
+    void add(UndoCommandPtr command);
+
+    bool isEmpty() const;
+
+    size_t size() const;
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    std::vector<UndoCommandPtr> m_commands;
+
+    size_t m_byteSize = sizeof(CompoundCommand);
+};
+
+//! Holds another command serialized and compressed. Decompressed on each use, so meant for the rarely used
+//! end of the undo history.
+class CompressedCommand : public UndoCommand
+{
+public:
+    explicit CompressedCommand(const UndoCommand & command);
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    void write(QDataStream & stream) const override;
+
+private:
+    UndoCommandPtr decompress() const;
+
+    QByteArray m_data;
+};
+
+#endif // UNDO_COMMAND_HPP
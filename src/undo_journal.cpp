@@ -0,0 +1,627 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "undo_journal.hpp"
+
+#include "constants.hpp"
+#include "simple_logger.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QtConcurrentRun>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using juzzlin::L;
+
+namespace {
+
+const quint32 MAGIC = 0x484a4e31;
+
+const qint64 FILE_HEADER_SIZE = 4;
+
+//! Type, payload size and checksum
+const qint64 RECORD_HEADER_SIZE = 1 + 4 + 2;
+
+QByteArray encodeNumber(quint32 number)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << number;
+    return payload;
+}
+
+quint32 decodeNumber(const QByteArray & payload)
+{
+    return payload.size() == 4 ? qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(payload.constData())) : std::numeric_limits<quint32>::max();
+}
+
+bool moveLast(std::vector<qint64> & from, std::vector<qint64> & to)
+{
+    if (from.empty()) {
+        return false;
+    }
+
+    to.push_back(from.back());
+    from.pop_back();
+    return true;
+}
+
+bool dropFirst(std::vector<qint64> & ids)
+{
+    if (ids.empty()) {
+        return false;
+    }
+
+    ids.erase(ids.begin());
+    return true;
+}
+
+} // namespace
+
+UndoJournal::UndoJournal(const QString & documentFileName)
+  : m_fileName(fileName(documentFileName))
+  , m_lock(m_fileName + ".lock")
+  , m_file(m_fileName)
+{
+    // The lock is held as long as the document is open, so only a crashed instance leaves a stale lock
+    m_lock.setStaleLockTime(0);
+    if (!m_lock.tryLock()) {
+        L().warning() << "Undo journal '" << m_fileName.toStdString() << "' is in use by another instance";
+        return;
+    }
+
+    // A crash between the renames of a compaction leaves the old journal and the complete compacted one
+    const auto tempFileName = m_fileName + ".tmp";
+    const auto oldFileName = m_fileName + ".old";
+    if (!QFile::exists(m_fileName)) {
+        for (auto && name : { tempFileName, oldFileName }) {
+            if (QFile::exists(name)) {
+                if (!QFile::rename(name, m_fileName)) {
+                    L().warning() << "Cannot restore undo journal '" << name.toStdString() << "'";
+                }
+                break;
+            }
+        }
+    }
+    QFile::remove(oldFileName);
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        L().warning() << "Cannot open undo journal '" << m_fileName.toStdString() << "'";
+        return;
+    }
+
+    replay();
+}
+
+UndoJournal::~UndoJournal()
+{
+    if (m_isCompacting) {
+        m_compaction.waitForFinished();
+        finishCompaction();
+    }
+
+    unmap();
+}
+
+QString UndoJournal::fileName(const QString & documentFileName)
+{
+    return documentFileName + Constants::Undo::JOURNAL_FILE_EXTENSION;
+}
+
+QByteArray UndoJournal::documentHash(const QString & documentFileName)
+{
+    QFile file(documentFileName);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (file.open(QIODevice::ReadOnly) && hash.addData(&file)) {
+        return hash.result();
+    }
+
+    return {};
+}
+
+bool UndoJournal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+UndoJournal::History UndoJournal::savedHistory(const QByteArray & documentHash) const
+{
+    return !m_savedHash.isEmpty() && m_savedHash == documentHash ? m_savedHistory : History();
+}
+
+void UndoJournal::setHistory(const History & history)
+{
+    QByteArray data = record(Type::Clear);
+    appendHistory(history, m_commands, data);
+    append(data);
+
+    m_history = history;
+}
+
+void UndoJournal::reset()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    if (m_isCompacting) {
+        m_compaction.waitForFinished();
+        m_isCompacting = false;
+        QFile::remove(m_fileName + ".tmp");
+    }
+
+    unmap();
+    m_file.resize(0);
+    m_writeFailed = false;
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << MAGIC;
+    append(header);
+
+    m_commands.clear();
+    m_commandCount = 0;
+    m_history = {};
+    m_savedHistory = {};
+    m_savedHash.clear();
+    m_compactedSize = m_file.size();
+}
+
+bool UndoJournal::pushEdit(const UndoCommand & command, qint64 & id)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    command.write(stream);
+
+    Record location;
+    location.offset = m_file.size();
+    location.number = m_commandCount;
+    if (!append(record(Type::Command, payload) + record(Type::PushUndo, encodeNumber(location.number)))) {
+        return false;
+    }
+
+    m_commandCount++;
+    id = m_nextId++;
+    m_commands[id] = location;
+    m_history.undo.push_back(id);
+
+    startCompactionIfNeeded();
+
+    return true;
+}
+
+void UndoJournal::undo()
+{
+    if (moveLast(m_history.undo, m_history.redo)) {
+        append(record(Type::Undo));
+    }
+
+    startCompactionIfNeeded();
+}
+
+void UndoJournal::redo()
+{
+    if (moveLast(m_history.redo, m_history.undo)) {
+        append(record(Type::Redo));
+    }
+
+    startCompactionIfNeeded();
+}
+
+void UndoJournal::dropOldestUndo()
+{
+    if (dropFirst(m_history.undo)) {
+        append(record(Type::DropOldestUndo));
+    }
+
+    startCompactionIfNeeded();
+}
+
+void UndoJournal::dropOldestRedo()
+{
+    if (dropFirst(m_history.redo)) {
+        append(record(Type::DropOldestRedo));
+    }
+
+    startCompactionIfNeeded();
+}
+
+void UndoJournal::markSaved(const QByteArray & documentHash)
+{
+    append(record(Type::Saved, documentHash));
+
+    m_savedHistory = m_history;
+    m_savedHash = documentHash;
+}
+
+UndoCommandPtr UndoJournal::command(qint64 id) const
+{
+    const auto iter = m_commands.find(id);
+    auto type = Type::Command;
+    QByteArray payload;
+    if (iter == m_commands.end() || !readRecord(iter->second.offset, type, payload) || type != Type::Command) {
+        L().warning() << "Corrupt undo journal record " << id << " in '" << m_fileName.toStdString() << "'";
+        return nullptr;
+    }
+
+    QDataStream stream(payload);
+    return UndoCommand::read(stream);
+}
+
+QByteArray UndoJournal::record(Type type, const QByteArray & payload)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << static_cast<quint8>(type) << static_cast<quint32>(payload.size()) << qChecksum(payload.constData(), static_cast<uint>(payload.size()));
+    stream.writeRawData(payload.constData(), payload.size());
+    return record;
+}
+
+bool UndoJournal::appendHistory(const History & history, const std::unordered_map<qint64, Record> & commands, QByteArray & data)
+{
+    for (auto && ids : { std::make_pair(Type::PushUndo, &history.undo), std::make_pair(Type::PushRedo, &history.redo) }) {
+        for (auto && id : *ids.second) {
+            const auto iter = commands.find(id);
+            if (iter == commands.end()) {
+                return false;
+            }
+            data += record(ids.first, encodeNumber(iter->second.number));
+        }
+    }
+
+    return true;
+}
+
+UndoJournal::Compaction UndoJournal::compact(QString sourceFileName, QString targetFileName, std::vector<std::pair<qint64, qint64>> commands)
+{
+    QFile source(sourceFileName);
+    QFile target(targetFileName);
+    if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return {};
+    }
+
+    QDataStream stream(&target);
+    stream << MAGIC;
+
+    // The records are copied as they are, checksums included
+    Compaction compaction;
+    quint32 number = 0;
+    for (auto && command : commands) {
+        source.seek(command.second);
+        const auto header = source.read(RECORD_HEADER_SIZE);
+        if (header.size() != RECORD_HEADER_SIZE) {
+            return {};
+        }
+        const auto size = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(header.constData()) + 1);
+        const auto payload = source.read(size);
+        if (static_cast<quint32>(payload.size()) != size) {
+            return {};
+        }
+
+        Record location;
+        location.offset = target.pos();
+        location.number = number++;
+        compaction.commands[command.first] = location;
+
+        if (target.write(header) != header.size() || target.write(payload) != payload.size()) {
+            return {};
+        }
+    }
+
+    compaction.size = target.flush() ? target.size() : 0;
+    return compaction;
+}
+
+void UndoJournal::replay()
+{
+    const auto header = mapped(0, FILE_HEADER_SIZE);
+    if (!header || qFromBigEndian<quint32>(header) != MAGIC) {
+        reset();
+        return;
+    }
+
+    std::vector<qint64> ids; // Command number => id
+    qint64 offset = FILE_HEADER_SIZE;
+    auto type = Type::Command;
+    QByteArray payload;
+    while (offset < m_file.size() && readRecord(offset, type, payload)) {
+        auto valid = true;
+        switch (type) {
+        case Type::Command: {
+            Record location;
+            location.offset = offset;
+            location.number = m_commandCount++;
+            m_commands[m_nextId] = location;
+            ids.push_back(m_nextId++);
+            break;
+        }
+        case Type::PushUndo:
+        case Type::PushRedo: {
+            const auto number = decodeNumber(payload);
+            valid = number < ids.size();
+            if (valid) {
+                (type == Type::PushUndo ? m_history.undo : m_history.redo).push_back(ids.at(number));
+            }
+            break;
+        }
+        case Type::Undo:
+            valid = moveLast(m_history.undo, m_history.redo);
+            break;
+        case Type::Redo:
+            valid = moveLast(m_history.redo, m_history.undo);
+            break;
+        case Type::DropOldestUndo:
+            valid = dropFirst(m_history.undo);
+            break;
+        case Type::DropOldestRedo:
+            valid = dropFirst(m_history.redo);
+            break;
+        case Type::Clear:
+            m_history = {};
+            break;
+        case Type::Saved:
+            m_savedHistory = m_history;
+            m_savedHash = payload;
+            break;
+        default:
+            valid = false;
+            break;
+        }
+
+        if (!valid) {
+            break;
+        }
+
+        offset += RECORD_HEADER_SIZE + payload.size();
+    }
+
+    if (offset != m_file.size()) {
+        L().warning() << "Dropping corrupt end of undo journal '" << m_fileName.toStdString() << "' at " << offset;
+        unmap();
+        m_file.resize(offset);
+    }
+
+    m_compactedSize = m_file.size();
+}
+
+bool UndoJournal::readRecord(qint64 offset, Type & type, QByteArray & payload) const
+{
+    const auto header = mapped(offset, RECORD_HEADER_SIZE);
+    if (!header) {
+        return false;
+    }
+
+    type = static_cast<Type>(header[0]);
+    const auto size = qFromBigEndian<quint32>(header + 1);
+    const auto checksum = qFromBigEndian<quint16>(header + 5);
+
+    const auto data = mapped(offset + RECORD_HEADER_SIZE, size);
+    if (!data) {
+        return false;
+    }
+
+    payload = QByteArray(reinterpret_cast<const char *>(data), static_cast<int>(size));
+    return qChecksum(payload.constData(), static_cast<uint>(payload.size())) == checksum;
+}
+
+const uchar * UndoJournal::mapped(qint64 offset, qint64 size) const
+{
+    // Appends go past the end of the map, so map again when needed
+    if (offset + size > m_mapSize && offset + size <= m_file.size()) {
+        unmap();
+        m_map = m_file.map(0, m_file.size());
+        m_mapSize = m_map ? m_file.size() : 0;
+    }
+
+    return m_map && offset + size <= m_mapSize ? m_map + offset : nullptr;
+}
+
+bool UndoJournal::append(const QByteArray & data)
+{
+    if (!isOpen() || m_writeFailed) {
+        return false;
+    }
+
+    const auto size = m_file.size();
+    if (!m_file.seek(size) || m_file.write(data) != data.size() || !m_file.flush()) {
+        // A partial record would hide the records after it on replay. Nothing is appended after a failure,
+        // so that a later save can't be recorded for a history that the file doesn't have.
+        L().warning() << "Cannot write undo journal '" << m_fileName.toStdString() << "'";
+        m_file.resize(size);
+        m_writeFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+void UndoJournal::startCompactionIfNeeded()
+{
+    if (m_isCompacting) {
+        if (m_compaction.isFinished()) {
+            finishCompaction();
+        }
+        return;
+    }
+
+    if (!isOpen() || m_writeFailed || m_file.size() < std::max(Constants::Undo::JOURNAL_COMPACTION_SIZE, 2 * m_compactedSize)) {
+        return;
+    }
+
+    // Only the commands in the histories are kept
+    std::vector<qint64> ids;
+    for (auto && history : { &m_history, &m_savedHistory }) {
+        ids.insert(ids.end(), history->undo.begin(), history->undo.end());
+        ids.insert(ids.end(), history->redo.begin(), history->redo.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::vector<std::pair<qint64, qint64>> commands;
+    for (auto && id : ids) {
+        commands.push_back({ id, m_commands.at(id).offset });
+    }
+
+    m_compactionStartId = m_nextId;
+    m_compaction = QtConcurrent::run(&UndoJournal::compact, m_fileName, m_fileName + ".tmp", commands);
+    m_isCompacting = true;
+}
+
+void UndoJournal::finishCompaction()
+{
+    m_isCompacting = false;
+
+    auto compaction = m_compaction.result();
+    const auto tempFileName = m_fileName + ".tmp";
+    QFile target(tempFileName);
+    if (!compaction.size || !target.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        L().warning() << "Failed to compact undo journal '" << m_fileName.toStdString() << "'";
+        QFile::remove(tempFileName);
+        m_compactedSize = m_file.size();
+        return;
+    }
+
+    // Commands appended while the compaction was running
+    QByteArray data;
+    auto number = static_cast<quint32>(compaction.commands.size());
+    for (auto id = m_compactionStartId; id < m_nextId; id++) {
+        const auto iter = m_commands.find(id);
+        auto type = Type::Command;
+        QByteArray payload;
+        if (iter != m_commands.end() && readRecord(iter->second.offset, type, payload)) {
+            Record location;
+            location.offset = compaction.size + data.size();
+            location.number = number++;
+            compaction.commands[id] = location;
+            data += record(Type::Command, payload);
+        }
+    }
+
+    // History operations that give the current histories and the saved ones when replayed
+    auto valid = true;
+    if (!m_savedHash.isEmpty()) {
+        valid = appendHistory(m_savedHistory, compaction.commands, data);
+        data += record(Type::Saved, m_savedHash);
+        data += record(Type::Clear);
+    }
+    valid = valid && appendHistory(m_history, compaction.commands, data);
+
+    if (!valid || target.write(data) != data.size() || !target.flush()) {
+        L().warning() << "Failed to compact undo journal '" << m_fileName.toStdString() << "'";
+        target.close();
+        QFile::remove(tempFileName);
+        m_compactedSize = m_file.size();
+        return;
+    }
+    target.close();
+
+    // The old journal is kept until the compacted one is in place, so that a crash or a failed rename
+    // never leaves no journal at all
+    unmap();
+    m_file.close();
+    const auto oldFileName = m_fileName + ".old";
+    QFile::remove(oldFileName);
+    const auto replaced = QFile::rename(m_fileName, oldFileName) && QFile::rename(tempFileName, m_fileName);
+    if (replaced) {
+        QFile::remove(oldFileName);
+    } else {
+        L().warning() << "Cannot replace undo journal '" << m_fileName.toStdString() << "'";
+        if (!QFile::exists(m_fileName) && !QFile::rename(oldFileName, m_fileName)) {
+            L().warning() << "Cannot restore undo journal '" << oldFileName.toStdString() << "'";
+        }
+        QFile::remove(tempFileName);
+    }
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        L().warning() << "Cannot open undo journal '" << m_fileName.toStdString() << "'";
+    }
+
+    if (replaced) {
+        m_commands = compaction.commands;
+        m_commandCount = number;
+    }
+    m_compactedSize = m_file.size();
+}
+
+void UndoJournal::unmap() const
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_mapSize = 0;
+}
+
+JournaledCommand::JournaledCommand(std::shared_ptr<UndoJournal> journal, qint64 id, UndoCommandPtr command)
+  : m_journal(journal)
+  , m_id(id)
+  , m_command(std::move(command))
+{
+}
+
+qint64 JournaledCommand::id() const
+{
+    return m_id;
+}
+
+void JournaledCommand::evict()
+{
+    m_command.reset();
+}
+
+void JournaledCommand::redo(MindMapData & mindMapData) const
+{
+    if (m_command) {
+        m_command->redo(mindMapData);
+    } else {
+        load()->redo(mindMapData);
+    }
+}
+
+void JournaledCommand::undo(MindMapData & mindMapData) const
+{
+    if (m_command) {
+        m_command->undo(mindMapData);
+    } else {
+        load()->undo(mindMapData);
+    }
+}
+
+size_t JournaledCommand::byteSize() const
+{
+    return sizeof(*this) + (m_command ? m_command->byteSize() : 0);
+}
+
+void JournaledCommand::write(QDataStream & stream) const
+{
+    if (m_command) {
+        m_command->write(stream);
+    } else {
+        load()->write(stream);
+    }
+}
+
+UndoCommandPtr JournaledCommand::load() const
+{
+    auto command = m_journal->command(m_id);
+    if (!command) {
+        throw CorruptCommandException("Corrupt undo journal record");
+    }
+    return command;
+}
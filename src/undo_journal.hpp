@@ -0,0 +1,221 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UNDO_JOURNAL_HPP
+#define UNDO_JOURNAL_HPP
+
+#include "undo_command.hpp"
+
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QLockFile>
+#include <QString>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*! Append-only file of the undo history kept next to the document.
+ *
+ *  Edits are stored as serialized commands together with the operations done on the undo and redo
+ *  histories, and the latest save of the document is marked with a hash of the saved file. Replaying the
+ *  journal gives the histories at the latest save, so the history survives restarts and crashes as long
+ *  as the document hasn't changed since.
+ *
+ *  Records are checksummed and read through a memory map. A torn record at the end, e.g. after a crash,
+ *  is dropped when the journal is opened. When the file has grown enough, it is rewritten in the background
+ *  with only the commands still in the histories.
+ *
+ *  The journal is locked while open. If another instance has the same document open, the journal is not
+ *  opened and the history is kept only in memory. */
+class UndoJournal
+{
+public:
+    //! Undo and redo histories as command ids in the same order as in UndoStack
+    struct History
+    {
+        std::vector<qint64> undo;
+
+        std::vector<qint64> redo;
+    };
+
+    //! Opens the journal of the given document. Creates the file if it doesn't exist.
+    //! The journal is not opened if it's locked by another instance.
+    explicit UndoJournal(const QString & documentFileName);
+
+    UndoJournal(const UndoJournal & other) = delete;
+
+    UndoJournal & operator=(const UndoJournal & other) = delete;
+
+    ~UndoJournal();
+
+    static QString fileName(const QString & documentFileName);
+
+    //! \return Hash of the file contents used to tell whether the document has changed since a save.
+    static QByteArray documentHash(const QString & documentFileName);
+
+    bool isOpen() const;
+
+    //! \return History at the latest save if it was of a document with the given hash, otherwise an empty history.
+    History savedHistory(const QByteArray & documentHash) const;
+
+    //! Replaces the current history, e.g. with the saved one to drop edits made after the save.
+    void setHistory(const History & history);
+
+    //! Removes everything from the journal.
+    void reset();
+
+    //! Appends a command to the undo history and sets id to the id of the command for command().
+    //! \return False if the command could not be written, e.g. as the disk is full. Then the history is unchanged.
+    bool pushEdit(const UndoCommand & command, qint64 & id);
+
+    //! Moves the latest command of the undo history to the redo history.
+    void undo();
+
+    //! Moves the latest command of the redo history to the undo history.
+    void redo();
+
+    void dropOldestUndo();
+
+    void dropOldestRedo();
+
+    //! Marks the current history as the one of the saved document with the given hash.
+    void markSaved(const QByteArray & documentHash);
+
+    //! \return The command or nullptr if its record is corrupt.
+    UndoCommandPtr command(qint64 id) const;
+
+private:
+    enum class Type : quint8
+    {
+        Command,
+        PushUndo,
+        PushRedo,
+        Undo,
+        Redo,
+        DropOldestUndo,
+        DropOldestRedo,
+        Clear,
+        Saved
+    };
+
+    struct Record
+    {
+        qint64 offset = 0;
+
+        //! Commands are numbered in the order they are in the file, and the history operations refer to the numbers.
+        quint32 number = 0;
+    };
+
+    struct Compaction
+    {
+        std::unordered_map<qint64, Record> commands;
+
+        qint64 size = 0;
+    };
+
+    static QByteArray record(Type type, const QByteArray & payload = {});
+
+    static Compaction compact(QString sourceFileName, QString targetFileName, std::vector<std::pair<qint64, qint64>> commands);
+
+    //! Appends the operations that give the history when replayed from an empty one.
+    //! \return False if a command of the history is missing.
+    static bool appendHistory(const History & history, const std::unordered_map<qint64, Record> & commands, QByteArray & data);
+
+    void replay();
+
+    bool readRecord(qint64 offset, Type & type, QByteArray & payload) const;
+
+    //! \return Pointer to the mapped file contents or nullptr if the range is beyond the end of the file.
+    const uchar * mapped(qint64 offset, qint64 size) const;
+
+    //! \return False if the data could not be written. Then nothing is appended anymore.
+    bool append(const QByteArray & data);
+
+    void startCompactionIfNeeded();
+
+    void finishCompaction();
+
+    void unmap() const;
+
+    QString m_fileName;
+
+    QLockFile m_lock;
+
+    mutable QFile m_file;
+
+    mutable uchar * m_map = nullptr;
+
+    mutable qint64 m_mapSize = 0;
+
+    //! Command id => record of the command in the file
+    std::unordered_map<qint64, Record> m_commands;
+
+    quint32 m_commandCount = 0;
+
+    qint64 m_nextId = 0;
+
+    History m_history;
+
+    History m_savedHistory;
+
+    QByteArray m_savedHash;
+
+    QFuture<Compaction> m_compaction;
+
+    bool m_isCompacting = false;
+
+    //! Commands with this id or bigger were added after the compaction was started
+    qint64 m_compactionStartId = 0;
+
+    //! File size after the previous compaction
+    qint64 m_compactedSize = 0;
+
+    bool m_writeFailed = false;
+};
+
+//! Command stored in an UndoJournal. The command is kept in memory only until evict().
+class JournaledCommand : public UndoCommand
+{
+public:
+    JournaledCommand(std::shared_ptr<UndoJournal> journal, qint64 id, UndoCommandPtr command = {});
+
+    qint64 id() const;
+
+    //! Frees the command from memory. It's read from the journal when needed.
+    void evict();
+
+    void redo(MindMapData & mindMapData) const override;
+
+    void undo(MindMapData & mindMapData) const override;
+
+    size_t byteSize() const override;
+
+    //! \throws CorruptCommandException if the command is evicted and cannot be read back.
+    void write(QDataStream & stream) const override;
+
+private:
+    //! \throws CorruptCommandException if the record of the command is corrupt.
+    UndoCommandPtr load() const;
+
+    std::shared_ptr<UndoJournal> m_journal;
+
+    qint64 m_id;
+
+    UndoCommandPtr m_command;
+};
+
+#endif // UNDO_JOURNAL_HPP
@@ -15,28 +15,180 @@
 
 #include "undo_stack.hpp"
 
+#include "simple_logger.hpp"
+
+#include <iterator>
+
 UndoStack::UndoStack(int maxHistorySize)
   : m_maxHistorySize(maxHistorySize)
 {
 }
 
-void UndoStack::pushUndoPoint(MindMapDataPtr mindMapData)
+void UndoStack::pushUndoPoint(MindMapData & mindMapData, const QString & mergeKey)
+{
+    if (m_transactionDepth) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto merge = m_undoPoint && !mergeKey.isEmpty() && mergeKey == m_mergeKey
+      && now - m_mergeTime < std::chrono::milliseconds(Constants::Undo::MERGE_INTERVAL_MS);
+    m_mergeKey = mergeKey;
+    m_mergeTime = now;
+    if (merge) {
+        return;
+    }
+
+    commitEdit(mindMapData, false);
+
+    m_undoPoint.reset(new MindMapDataSnapshot(mindMapData.snapshot()));
+}
+
+void UndoStack::beginTransaction(MindMapData & mindMapData)
+{
+    pushUndoPoint(mindMapData);
+
+    m_transactionDepth++;
+}
+
+void UndoStack::endTransaction()
+{
+    // Undo and redo close any open transactions
+    if (m_transactionDepth > 0) {
+        m_transactionDepth--;
+    }
+}
+
+void UndoStack::endAllTransactions()
+{
+    m_transactionDepth = 0;
+}
+
+void UndoStack::commitEdit(MindMapData & mindMapData, bool keepEmpty)
+{
+    if (m_undoPoint) {
+        auto command = CompoundCommand::fromSnapshots(*m_undoPoint, mindMapData.snapshot());
+        m_undoPoint.reset();
+        m_mergeKey.clear();
+        m_transactionDepth = 0;
+        if (!command->isEmpty()) {
+            dropAll(m_redoStack);
+            push(m_undoStack, journaled(std::move(command)));
+        } else if (keepEmpty) {
+            // An empty edit is recorded on undo so that each undo point can be undone and redone. It doesn't
+            // change anything, so the redo history stays valid.
+            push(m_undoStack, journaled(std::move(command)));
+        }
+    }
+}
+
+UndoCommandPtr UndoStack::journaled(UndoCommandPtr command)
+{
+    if (!m_journal) {
+        return command;
+    }
+
+    qint64 id = 0;
+    if (!m_journal->pushEdit(*command, id)) {
+        // The journal no longer matches the history, so the history is kept in memory from now on. Edits
+        // already in the journal are still read back from it.
+        juzzlin::L().warning() << "Keeping the undo history only in memory";
+        m_journal.reset();
+        return command;
+    }
+
+    return UndoCommandPtr(new JournaledCommand(m_journal, id, std::move(command)));
+}
+
+void UndoStack::push(CommandList & commands, UndoCommandPtr command)
+{
+    m_memoryUsage += command->byteSize();
+    commands.push_back(std::move(command));
+
+    // Edits deeper in the history are seldom needed, so they are compressed as they get pushed down
+    if (commands.size() > Constants::Undo::UNCOMPRESSED_EDITS) {
+        compress(*std::prev(commands.end(), static_cast<int>(Constants::Undo::UNCOMPRESSED_EDITS) + 1));
+    }
+
+    if (static_cast<int>(commands.size()) > m_maxHistorySize && m_maxHistorySize != -1) {
+        dropOldest(commands);
+    }
+
+    trim();
+}
+
+UndoCommandPtr UndoStack::pop(CommandList & commands)
+{
+    auto command = std::move(commands.back());
+    commands.pop_back();
+    m_memoryUsage -= command->byteSize();
+    return command;
+}
+
+void UndoStack::dropOldest(CommandList & commands)
 {
-    auto copyData = new MindMapData(*mindMapData);
-    m_undoStack.push_back(MindMapDataPtr(copyData));
+    if (m_journal) {
+        if (&commands == &m_undoStack) {
+            m_journal->dropOldestUndo();
+        } else {
+            m_journal->dropOldestRedo();
+        }
+    }
+
+    m_memoryUsage -= commands.front()->byteSize();
+    commands.pop_front();
+}
 
-    if (static_cast<int>(m_undoStack.size()) > m_maxHistorySize && m_maxHistorySize != -1) {
-        m_undoStack.pop_front();
+void UndoStack::dropAll(CommandList & commands)
+{
+    while (!commands.empty()) {
+        dropOldest(commands);
     }
 }
 
-void UndoStack::pushRedoPoint(MindMapDataPtr mindMapData)
+void UndoStack::compress(UndoCommandPtr & command)
 {
-    auto copyData = new MindMapData(*mindMapData);
-    m_redoStack.push_back(MindMapDataPtr(copyData));
+    // Journaled edits can be read back from the journal
+    if (const auto journaledCommand = dynamic_cast<JournaledCommand *>(command.get())) {
+        m_memoryUsage -= journaledCommand->byteSize();
+        journaledCommand->evict();
+        m_memoryUsage += journaledCommand->byteSize();
+    } else if (!dynamic_cast<CompressedCommand *>(command.get())) {
+        UndoCommandPtr compressed(new CompressedCommand(*command));
+        // Small edits may not get any smaller
+        if (compressed->byteSize() < command->byteSize()) {
+            m_memoryUsage = m_memoryUsage - command->byteSize() + compressed->byteSize();
+            command = std::move(compressed);
+        }
+    }
+}
 
-    if (static_cast<int>(m_redoStack.size()) > m_maxHistorySize && m_maxHistorySize != -1) {
-        m_redoStack.pop_front();
+void UndoStack::trim()
+{
+    // The edits farthest from the current state go first: the oldest undos, then the last redos
+    while (m_memoryUsage > m_memoryBudget) {
+        if (m_undoStack.size() > 1) {
+            dropOldest(m_undoStack);
+        } else if (m_redoStack.size() > (m_undoStack.empty() ? 1 : 0)) {
+            dropOldest(m_redoStack);
+        } else {
+            break;
+        }
+    }
+}
+
+void UndoStack::dropHistory(const CorruptCommandException & e)
+{
+    // The rest of the history was recorded against states that can't be reached anymore
+    juzzlin::L().error() << "Dropping the undo history: " << e.what();
+    m_undoStack.clear();
+    m_redoStack.clear();
+    m_memoryUsage = 0;
+
+    // A new journal is started at the next save
+    if (m_journal) {
+        m_journal->reset();
+        m_journal.reset();
     }
 }
 
@@ -44,22 +196,43 @@ void UndoStack::clear()
 {
     m_undoStack.clear();
     m_redoStack.clear();
+    m_undoPoint.reset();
+    m_mergeKey.clear();
+    m_transactionDepth = 0;
+    m_memoryUsage = 0;
+    m_journal.reset();
 }
 
 bool UndoStack::isUndoable() const
 {
-    return m_undoStack.size() > 0;
+    return m_undoPoint || m_undoStack.size() > 0;
 }
 
-MindMapDataPtr UndoStack::undo()
+bool UndoStack::undo(MindMapData & mindMapData)
 {
-    if (isUndoable()) {
-        auto head = m_undoStack.back();
-        m_undoStack.pop_back();
-        return head;
+    commitEdit(mindMapData, true);
+
+    if (m_undoStack.empty()) {
+        return false;
+    }
+
+    auto command = pop(m_undoStack);
+    if (m_journal) {
+        m_journal->undo();
     }
 
-    return MindMapDataPtr();
+    mindMapData.graph().beginChanges();
+    try {
+        command->undo(mindMapData);
+    } catch (const CorruptCommandException & e) {
+        mindMapData.graph().endChanges();
+        dropHistory(e);
+        return false;
+    }
+    mindMapData.graph().endChanges();
+
+    push(m_redoStack, std::move(command));
+    return true;
 }
 
 bool UndoStack::isRedoable() const
@@ -67,13 +240,147 @@ bool UndoStack::isRedoable() const
     return m_redoStack.size() > 0;
 }
 
-MindMapDataPtr UndoStack::redo()
+bool UndoStack::redo(MindMapData & mindMapData)
+{
+    // A pending edit with changes invalidates the redo history
+    commitEdit(mindMapData, false);
+
+    if (m_redoStack.empty()) {
+        return false;
+    }
+
+    auto command = pop(m_redoStack);
+    if (m_journal) {
+        m_journal->redo();
+    }
+
+    mindMapData.graph().beginChanges();
+    try {
+        command->redo(mindMapData);
+    } catch (const CorruptCommandException & e) {
+        mindMapData.graph().endChanges();
+        dropHistory(e);
+        return false;
+    }
+    mindMapData.graph().endChanges();
+
+    push(m_undoStack, std::move(command));
+    return true;
+}
+
+void UndoStack::setMemoryBudget(size_t bytes)
+{
+    m_memoryBudget = bytes;
+
+    trim();
+}
+
+size_t UndoStack::memoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+void UndoStack::restoreFromJournal(std::shared_ptr<UndoJournal> journal, const QByteArray & documentHash)
 {
-    if (isRedoable()) {
-        auto head = m_redoStack.back();
-        m_redoStack.pop_back();
-        return head;
+    clear();
+
+    if (!journal->isOpen()) {
+        return;
+    }
+
+    // Edits made after the save are dropped as they don't apply to the saved document
+    const auto history = journal->savedHistory(documentHash);
+    journal->setHistory(history);
+    m_journal = journal;
+
+    for (auto && id : history.undo) {
+        push(m_undoStack, UndoCommandPtr(new JournaledCommand(journal, id)));
+    }
+
+    for (auto && id : history.redo) {
+        push(m_redoStack, UndoCommandPtr(new JournaledCommand(journal, id)));
+    }
+}
+
+bool UndoStack::hasJournal() const
+{
+    return m_journal != nullptr;
+}
+
+void UndoStack::setJournal(std::shared_ptr<UndoJournal> journal)
+{
+    m_journal.reset();
+
+    if (!journal || !journal->isOpen()) {
+        return;
+    }
+
+    journal->reset();
+
+    // The commands are replaced only once all of them are in the journal, so that a failed write leaves
+    // the history as it was
+    std::vector<qint64> ids;
+    auto written = true;
+    try {
+        for (auto && command : m_undoStack) {
+            qint64 id = 0;
+            written = written && journal->pushEdit(*command, id);
+            ids.push_back(id);
+        }
+
+        // The redo history is recorded as edits that are then undone, so the next redo goes in last
+        for (auto iter = m_redoStack.rbegin(); iter != m_redoStack.rend(); iter++) {
+            qint64 id = 0;
+            written = written && journal->pushEdit(**iter, id);
+            ids.push_back(id);
+        }
+        for (size_t i = 0; i < m_redoStack.size(); i++) {
+            journal->undo();
+        }
+    } catch (const CorruptCommandException & e) {
+        // An evicted edit could not be read back from the previous journal, so the new one starts empty
+        dropHistory(e);
+        journal->reset();
+        ids.clear();
+    }
+
+    if (!written) {
+        juzzlin::L().warning() << "Keeping the undo history only in memory";
+        journal->reset();
+        return;
+    }
+
+    auto id = ids.begin();
+    for (auto && command : m_undoStack) {
+        command.reset(new JournaledCommand(journal, *id++));
+    }
+    for (auto iter = m_redoStack.rbegin(); iter != m_redoStack.rend(); iter++) {
+        iter->reset(new JournaledCommand(journal, *id++));
+    }
+
+    m_memoryUsage = 0;
+    for (auto && commands : { &m_undoStack, &m_redoStack }) {
+        for (auto && command : *commands) {
+            m_memoryUsage += command->byteSize();
+        }
+    }
+
+    m_journal = journal;
+}
+
+void UndoStack::markSaved(MindMapData & mindMapData, const QByteArray & documentHash)
+{
+    if (!m_journal) {
+        return;
+    }
+
+    // The pending edit is part of the saved document, so it's recorded and a new edit starts from here
+    if (m_undoPoint) {
+        const auto transactionDepth = m_transactionDepth;
+        commitEdit(mindMapData, false);
+        m_undoPoint.reset(new MindMapDataSnapshot(mindMapData.snapshot()));
+        m_transactionDepth = transactionDepth;
     }
 
-    return MindMapDataPtr();
+    m_journal->markSaved(documentHash);
 }
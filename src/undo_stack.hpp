@@ -16,37 +16,124 @@
 #ifndef UNDOSTACK_HPP
 #define UNDOSTACK_HPP
 
+#include "constants.hpp"
 #include "mind_map_data.hpp"
+#include "undo_command.hpp"
+#include "undo_journal.hpp"
 
+#include <chrono>
 #include <list>
-
+#include <memory>
+
+/*! History of edits as commands that are undone and redone in place.
+ *
+ *  An undo point is pushed before each edit. It takes an O(1) snapshot of the mind map, and the edit is
+ *  recorded as a CompoundCommand of the differences to that snapshot only when the next undo point is
+ *  pushed or when undo is requested. An edit that didn't change anything is dropped when the next undo point
+ *  is pushed, so e.g. plain clicks don't fill the history.
+ *
+ *  The history is bounded by a memory budget. Edits deeper in the history are kept compressed, and the oldest
+ *  edits are dropped when the budget is exceeded.
+ *
+ *  With a journal set, the history is also recorded in an UndoJournal next to the document. Then the deeper
+ *  edits are dropped from memory instead of compressed and read back from the journal when needed. */
 class UndoStack
 {
 public:
     UndoStack(int maxHistorySize = -1);
 
-    void pushUndoPoint(MindMapDataPtr mindMapData);
+    /*! Starts a new edit and records the previous one, if any. Recording a non-empty edit drops the redo history.
+     *  If the previous undo point had the same non-empty merge key and was pushed less than
+     *  Constants::Undo::MERGE_INTERVAL_MS ago, the previous edit continues instead, e.g. for the steps of a spin box.
+     *  Ignored inside a transaction. */
+    void pushUndoPoint(MindMapData & mindMapData, const QString & mergeKey = {});
+
+    //! Pushes an undo point and ignores the following ones until the matching endTransaction(), so that
+    //! everything in between becomes a single edit. Transactions can be nested.
+    void beginTransaction(MindMapData & mindMapData);
 
-    void pushRedoPoint(MindMapDataPtr mindMapData);
+    void endTransaction();
+
+    //! Closes all open transactions, e.g. when a drag is aborted without the matching endTransaction().
+    void endAllTransactions();
 
     void clear();
 
     bool isUndoable() const;
 
-    MindMapDataPtr undo();
+    //! Reverts the latest edit in place.
+    //! \return False if there was nothing to undo, or if the edit could not be read back. Then the whole history is dropped.
+    bool undo(MindMapData & mindMapData);
 
     bool isRedoable() const;
 
-    MindMapDataPtr redo();
+    //! Re-applies the latest undone edit in place.
+    //! \return False if there was nothing to redo, or if the edit could not be read back. Then the whole history is dropped.
+    bool redo(MindMapData & mindMapData);
+
+    //! The latest edit is kept even if it alone exceeds the budget.
+    void setMemoryBudget(size_t bytes);
+
+    //! \return Approximate memory taken by the recorded edits in bytes. The pending undo point shares its
+    //! state with the mind map and is not included.
+    size_t memoryUsage() const;
+
+    /*! Replaces the history with the one saved in the journal if the journal belongs to the document with the
+     *  given hash, i.e. the document hasn't changed since. The following edits are recorded in the journal. */
+    void restoreFromJournal(std::shared_ptr<UndoJournal> journal, const QByteArray & documentHash);
+
+    bool hasJournal() const;
+
+    //! Records the history in the given journal from now on, starting with the current history.
+    //! A null journal stops recording, but edits already in the previous journal are still read back from it.
+    void setJournal(std::shared_ptr<UndoJournal> journal);
+
+    //! Marks the current history as the one of the saved document. A pending edit is recorded first.
+    void markSaved(MindMapData & mindMapData, const QByteArray & documentHash);
 
 private:
-    using MindMapDataVector = std::list<MindMapDataPtr>;
+    using CommandList = std::list<UndoCommandPtr>;
+
+    void commitEdit(MindMapData & mindMapData, bool keepEmpty);
+
+    //! \return The command stored in the journal, or the command itself if there's no journal.
+    UndoCommandPtr journaled(UndoCommandPtr command);
+
+    void push(CommandList & commands, UndoCommandPtr command);
+
+    UndoCommandPtr pop(CommandList & commands);
 
-    MindMapDataVector m_undoStack;
+    void dropOldest(CommandList & commands);
 
-    MindMapDataVector m_redoStack;
+    void dropAll(CommandList & commands);
+
+    void compress(UndoCommandPtr & command);
+
+    void trim();
+
+    //! Drops the undo and redo histories, as they no longer match the mind map.
+    void dropHistory(const CorruptCommandException & e);
+
+    CommandList m_undoStack;
+
+    CommandList m_redoStack;
+
+    //! State at the latest undo point while the edit following it is not yet recorded
+    std::unique_ptr<MindMapDataSnapshot> m_undoPoint;
+
+    QString m_mergeKey;
+
+    std::chrono::steady_clock::time_point m_mergeTime;
+
+    int m_transactionDepth = 0;
 
     int m_maxHistorySize;
+
+    size_t m_memoryBudget = Constants::Undo::MEMORY_BUDGET;
+
+    size_t m_memoryUsage = 0;
+
+    std::shared_ptr<UndoJournal> m_journal;
 };
 
 #endif // UNDOSTACK_HPP
@@ -0,0 +1,155 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "binary_serializer_test.hpp"
+
+#include "binary_serializer.hpp"
+#include "mind_map_data.hpp"
+#include "node_base.hpp"
+#include "serializer.hpp"
+
+#include <QBuffer>
+#include <QtEndian>
+
+namespace {
+
+//! Map with everything that both formats store. Coordinates and colors survive the XML format as they are.
+void initializeMindMap(MindMapData & data)
+{
+    data.setBackgroundColor(QColor(1, 2, 3));
+    data.setEdgeColor(QColor(4, 5, 6));
+    data.setEdgeWidth(2.5);
+    data.setTextSize(14);
+    data.setCornerRadius(7);
+
+    const auto node0 = std::make_shared<NodeBase>();
+    node0->setColor(QColor(7, 8, 9));
+    node0->setTextColor(QColor(10, 11, 12));
+    node0->setImageRef(1);
+    node0->setLocation(QPointF(-100.5, 200.25));
+    node0->setSize(QSizeF(120, 40.125));
+    node0->setText("Lorem ipsum\n\"dolor\" <sit> & ämet");
+    data.graph().addNode(node0);
+
+    const auto node1 = std::make_shared<NodeBase>();
+    data.graph().addNode(node1);
+
+    const auto node2 = std::make_shared<NodeBase>();
+    node2->setText("consectetur");
+    data.graph().addNode(node2);
+
+    const auto edge0 = std::make_shared<EdgeBase>(*node0, *node1);
+    edge0->setText("adipiscing");
+    edge0->setArrowMode(EdgeBase::ArrowMode::Double);
+    data.graph().addEdge(edge0);
+
+    const auto edge1 = std::make_shared<EdgeBase>(*node2, *node0);
+    edge1->setReversed(true);
+    data.graph().addEdge(edge1);
+}
+
+QByteArray toXml(MindMapData & data)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    Serializer::toXml(data, buffer);
+    return buffer.data();
+}
+
+QByteArray toBinary(MindMapData & data)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    BinarySerializer::toBinary(data, buffer);
+    return buffer.data();
+}
+
+MindMapDataPtr fromXml(QByteArray xml)
+{
+    QBuffer buffer(&xml);
+    buffer.open(QIODevice::ReadOnly);
+    return Serializer::fromXml(buffer);
+}
+
+MindMapDataPtr fromBinary(const QByteArray & binary)
+{
+    return BinarySerializer::fromBinary(reinterpret_cast<const uchar *>(binary.constData()), binary.size());
+}
+
+} // namespace
+
+void BinarySerializerTest::testBinaryToXmlToBinary()
+{
+    MindMapData outData;
+    initializeMindMap(outData);
+
+    const auto binary = toBinary(outData);
+    const auto binaryData = fromBinary(binary);
+    QVERIFY(binaryData);
+    const auto xmlData = fromXml(toXml(*binaryData));
+    QVERIFY(xmlData);
+    QCOMPARE(toBinary(*xmlData), binary);
+}
+
+void BinarySerializerTest::testCorruptedData()
+{
+    MindMapData outData;
+    initializeMindMap(outData);
+    const auto binary = toBinary(outData);
+    QVERIFY(fromBinary(binary));
+
+    QVERIFY(!fromBinary(binary.left(binary.size() - 1)));
+
+    QVERIFY(!fromBinary(binary.left(50)));
+
+    auto unsupportedVersion = binary;
+    unsupportedVersion[4] = 2;
+    QVERIFY(!fromBinary(unsupportedVersion));
+
+    // Version string index of the header
+    auto invalidString = binary;
+    qToLittleEndian<quint32>(1000, reinterpret_cast<uchar *>(invalidString.data()) + 96);
+    QVERIFY(!fromBinary(invalidString));
+
+    // Node table offset of the header
+    auto invalidOffset = binary;
+    qToLittleEndian<quint64>(binary.size(), reinterpret_cast<uchar *>(invalidOffset.data()) + 24);
+    QVERIFY(!fromBinary(invalidOffset));
+}
+
+void BinarySerializerTest::testIsBinary()
+{
+    MindMapData outData;
+    QVERIFY(BinarySerializer::isBinary(toBinary(outData)));
+    QVERIFY(!BinarySerializer::isBinary(toXml(outData)));
+    QVERIFY(!BinarySerializer::isBinary("HMB"));
+}
+
+void BinarySerializerTest::testXmlToBinaryToXml()
+{
+    MindMapData outData;
+    initializeMindMap(outData);
+
+    const auto xml = toXml(outData);
+    const auto xmlData = fromXml(xml);
+    QVERIFY(xmlData);
+    const auto binaryData = fromBinary(toBinary(*xmlData));
+    QVERIFY(binaryData);
+    QCOMPARE(binaryData->graph().numNodes(), outData.graph().numNodes());
+    QCOMPARE(binaryData->graph().getEdges().size(), outData.graph().getEdges().size());
+    QCOMPARE(toXml(*binaryData), xml);
+}
+
+QTEST_GUILESS_MAIN(BinarySerializerTest)
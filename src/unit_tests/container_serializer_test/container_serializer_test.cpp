@@ -0,0 +1,152 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "container_serializer_test.hpp"
+
+#include "container_serializer.hpp"
+#include "mind_map_data.hpp"
+#include "node_base.hpp"
+#include "serializer.hpp"
+
+#include <QBuffer>
+
+namespace {
+
+QByteArray toContainer(MindMapData & data)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ContainerSerializer::toContainer(data, buffer);
+    return buffer.data();
+}
+
+MindMapDataPtr fromContainer(QByteArray container)
+{
+    QBuffer buffer(&container);
+    buffer.open(QIODevice::ReadOnly);
+    return ContainerSerializer::fromContainer(buffer);
+}
+
+} // namespace
+
+void ContainerSerializerTest::testContainerToContainer()
+{
+    MindMapData outData;
+    outData.setBackgroundColor(QColor(1, 2, 3));
+    outData.setEdgeWidth(2.5);
+    Image image(QImage(), "foo.png");
+    image.setId(1);
+    outData.imageManager().setImage(image);
+
+    const auto node0 = std::make_shared<NodeBase>();
+    node0->setImageRef(1);
+    node0->setLocation(QPointF(-100.5, 200.25));
+    node0->setText("Lorem ipsum\n\"dolor\" <sit> & ämet");
+    outData.graph().addNode(node0);
+    const auto node1 = std::make_shared<NodeBase>();
+    outData.graph().addNode(node1);
+    const auto edge = std::make_shared<EdgeBase>(*node0, *node1);
+    edge->setText("adipiscing");
+    outData.graph().addEdge(edge);
+    const auto xml = Serializer::toXml(outData).toString();
+
+    const auto container = toContainer(outData);
+    outData.imageManager().clear();
+    const auto inData = fromContainer(container);
+    QVERIFY(inData);
+    QCOMPARE(inData->graph().numNodes(), outData.graph().numNodes());
+    QCOMPARE(inData->graph().getEdges().size(), outData.graph().getEdges().size());
+    QCOMPARE(inData->imageManager().getImage(1).first.path(), std::string("foo.png"));
+    QCOMPARE(Serializer::toXml(*inData).toString(), xml);
+    QCOMPARE(toContainer(*inData), container);
+}
+
+void ContainerSerializerTest::testCorruptedContainer()
+{
+    MindMapData outData;
+    const auto node = std::make_shared<NodeBase>();
+    node->setText("Lorem ipsum");
+    outData.graph().addNode(node);
+    const auto container = toContainer(outData);
+    QVERIFY(fromContainer(container));
+
+    QVERIFY(!fromContainer(container.left(container.size() - 1)));
+
+    QVERIFY(!fromContainer(container.left(4)));
+
+    auto unsupportedVersion = container;
+    unsupportedVersion[4] = 2;
+    QVERIFY(!fromContainer(unsupportedVersion));
+
+    // Somewhere in the compressed model
+    auto invalidChunk = container;
+    invalidChunk[container.size() - 20] = static_cast<char>(~invalidChunk[container.size() - 20]);
+    QVERIFY(!fromContainer(invalidChunk));
+}
+
+void ContainerSerializerTest::testIdenticalImagesStoredOnce()
+{
+    // Image files are not read in unit tests, so both images have the same empty content
+    MindMapData outData;
+    Image image0(QImage(), "foo.png");
+    image0.setId(1);
+    outData.imageManager().setImage(image0);
+    Image image1(QImage(), "bar.png");
+    image1.setId(2);
+    outData.imageManager().setImage(image1);
+
+    const auto node0 = std::make_shared<NodeBase>();
+    node0->setImageRef(1);
+    outData.graph().addNode(node0);
+    const auto node1 = std::make_shared<NodeBase>();
+    node1->setImageRef(2);
+    outData.graph().addNode(node1);
+
+    const auto container = toContainer(outData);
+    QCOMPARE(container.count("images/"), 1);
+    outData.imageManager().clear();
+    const auto inData = fromContainer(container);
+    QVERIFY(inData);
+    QVERIFY(inData->imageManager().getImage(1).second);
+    QVERIFY(inData->imageManager().getImage(2).second);
+}
+
+void ContainerSerializerTest::testIsContainer()
+{
+    MindMapData outData;
+    QVERIFY(ContainerSerializer::isContainer(toContainer(outData)));
+    QVERIFY(!ContainerSerializer::isContainer(Serializer::toXml(outData).toByteArray()));
+    QVERIFY(!ContainerSerializer::isContainer("HMZ"));
+}
+
+void ContainerSerializerTest::testMultipleChunks()
+{
+    MindMapData outData;
+    for (int i = 0; i < 1000; i++) {
+        const auto node = std::make_shared<NodeBase>();
+        node->setText(QString(1000, QChar('a' + i % 26)));
+        outData.graph().addNode(node);
+    }
+    const auto xml = Serializer::toXml(outData).toByteArray();
+    QVERIFY(xml.size() > 1000000);
+
+    const auto container = toContainer(outData);
+    QVERIFY(container.size() < xml.size() / 10);
+    const auto inData = fromContainer(container);
+    QVERIFY(inData);
+    QCOMPARE(Serializer::toXml(*inData).toByteArray(), xml);
+}
+
+QTEST_GUILESS_MAIN(ContainerSerializerTest)
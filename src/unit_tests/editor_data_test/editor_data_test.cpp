@@ -19,11 +19,51 @@
 #include "mind_map_data.hpp"
 #include "node_base.hpp"
 #include "serializer.hpp"
+#include "undo_journal.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
 
 EditorDataTest::EditorDataTest()
 {
 }
 
+void EditorDataTest::testBestOverlapNodeOnRelease()
+{
+    EditorData editorData;
+    editorData.setMindMapData(std::make_shared<MindMapData>());
+    const auto source = editorData.addNodeAt(QPointF(0, 0));
+    const auto target = editorData.addNodeAt(QPointF(1000, 0));
+    editorData.mouseAction().setSourceNode(source.get(), MouseAction::Action::CreateOrConnectNode);
+
+    NodePtr found;
+    int foundCount = 0;
+    connect(&editorData, &EditorData::bestOverlapNodeFound, [&found, &foundCount](NodePtr node) {
+        found = node;
+        foundCount++;
+    });
+
+    // Moved next to the target and released on it without an event loop turn in between
+    Node dummyNode;
+    dummyNode.setLocation(QPointF(500, 500));
+    editorData.findBestOverlapNode(dummyNode);
+    dummyNode.setLocation(target->location());
+    QCOMPARE(editorData.bestOverlapNode(dummyNode), target);
+
+    // The result for the earlier position doesn't override the one for the release
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+    QCOMPARE(foundCount, 0);
+
+    editorData.findBestOverlapNode(dummyNode);
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+    QCOMPARE(foundCount, 1);
+    QCOMPARE(found, target);
+}
+
 void EditorDataTest::testGroupMove()
 {
     EditorData editorData;
@@ -288,6 +328,43 @@ void EditorDataTest::testUndoDeleteEdge()
     QCOMPARE(editorData.mindMapData()->graph().areDirectlyConnected(undoneNode0, undoneNode1), false);
 }
 
+void EditorDataTest::testUndoDeleteNode()
+{
+    EditorData editorData;
+    editorData.setMindMapData(std::make_shared<MindMapData>());
+
+    const auto node0 = editorData.addNodeAt(QPointF(0, 0));
+    const auto node1 = editorData.addNodeAt(QPointF(100, 0));
+    const auto node2 = editorData.addNodeAt(QPointF(200, 0));
+    editorData.addEdge(std::make_shared<Edge>(*node0, *node1));
+    editorData.addEdge(std::make_shared<Edge>(*node1, *node2));
+    node1->setText("foo");
+
+    editorData.saveUndoPoint();
+
+    editorData.deleteNode(*node1);
+
+    QCOMPARE(editorData.mindMapData()->graph().numNodes(), size_t(2));
+    QCOMPARE(editorData.mindMapData()->graph().getEdges().size(), size_t(0));
+
+    editorData.undo();
+
+    QCOMPARE(editorData.mindMapData()->graph().numNodes(), size_t(3));
+    QCOMPARE(editorData.mindMapData()->graph().getEdges().size(), size_t(2));
+
+    const auto undoneNode1 = editorData.getNodeByIndex(node1->index());
+    QVERIFY(undoneNode1);
+    QCOMPARE(undoneNode1->text(), QString("foo"));
+    QCOMPARE(undoneNode1->location(), QPointF(100, 0));
+    QCOMPARE(editorData.mindMapData()->graph().areDirectlyConnected(node0, undoneNode1), true);
+    QCOMPARE(editorData.mindMapData()->graph().areDirectlyConnected(undoneNode1, node2), true);
+
+    editorData.redo();
+
+    QCOMPARE(editorData.mindMapData()->graph().numNodes(), size_t(2));
+    QCOMPARE(editorData.mindMapData()->graph().getEdges().size(), size_t(0));
+}
+
 void EditorDataTest::testUndoBackgroundColor()
 {
     EditorData editorData;
@@ -578,6 +655,61 @@ void EditorDataTest::testUndoNodeTextColor()
     QCOMPARE(redoneNode->textColor(), color);
 }
 
+void EditorDataTest::testUndoKeepsUnchangedItems()
+{
+    EditorData editorData;
+    editorData.setMindMapData(std::make_shared<MindMapData>());
+
+    const auto node0 = editorData.addNodeAt(QPointF(0, 0));
+    const auto node1 = editorData.addNodeAt(QPointF(100, 0));
+    const auto edge01 = editorData.addEdge(std::make_shared<Edge>(*node0, *node1));
+
+    editorData.saveUndoPoint();
+
+    node1->setLocation(QPointF(200, 200));
+
+    editorData.undo();
+
+    // Undo is applied in place, so the items survive and only the changed state is restored
+    QCOMPARE(editorData.getNodeByIndex(node0->index()), NodeBasePtr(node0));
+    QCOMPARE(editorData.getNodeByIndex(node1->index()), NodeBasePtr(node1));
+    QCOMPARE(editorData.mindMapData()->graph().getEdges().at(0), EdgeBasePtr(edge01));
+    QCOMPARE(node1->location(), QPointF(100, 0));
+
+    editorData.redo();
+
+    QCOMPARE(editorData.getNodeByIndex(node1->index()), NodeBasePtr(node1));
+    QCOMPARE(node1->location(), QPointF(200, 200));
+}
+
+void EditorDataTest::testUndoPointClearsRedo()
+{
+    EditorData editorData;
+    editorData.setMindMapData(std::make_shared<MindMapData>());
+
+    const auto node = editorData.addNodeAt(QPointF(0, 0));
+
+    editorData.saveUndoPoint();
+
+    node->setText("foo");
+
+    editorData.undo();
+
+    QCOMPARE(node->text(), QString(""));
+
+    editorData.saveUndoPoint();
+
+    node->setText("bar");
+
+    editorData.redo();
+
+    QCOMPARE(node->text(), QString("bar"));
+
+    editorData.undo();
+
+    QCOMPARE(node->text(), QString(""));
+}
+
 void EditorDataTest::testUndoTextSize()
 {
     EditorData editorData;
@@ -723,4 +855,34 @@ void EditorDataTest::testUndoModificationFlagOnLoadDesign()
     QCOMPARE(editorData.isModified(), false);
 }
 
+void EditorDataTest::testUndoJournalIsOptional()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto fileName = dir.path() + "/test.alz";
+
+    EditorData editorData;
+    editorData.setMindMapData(std::make_shared<MindMapData>());
+    editorData.saveUndoPoint();
+    editorData.addNodeAt(QPointF(0, 0));
+    QVERIFY(editorData.saveMindMapAs(fileName));
+
+    editorData.loadMindMapData(fileName);
+    editorData.saveUndoPoint();
+    editorData.addNodeAt(QPointF(1, 1));
+
+    // Nothing but the document itself is left next to it by default
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files | QDir::Hidden), QStringList { "test.alz" });
+
+    // Opening doesn't create a journal even when enabled, only saving does
+    editorData.setUndoJournalEnabled(true);
+    editorData.loadMindMapData(fileName);
+    QCOMPARE(QFile::exists(UndoJournal::fileName(fileName)), false);
+
+    editorData.saveUndoPoint();
+    editorData.addNodeAt(QPointF(2, 2));
+    QVERIFY(editorData.saveMindMap());
+    QVERIFY(QFile::exists(UndoJournal::fileName(fileName)));
+}
+
 QTEST_GUILESS_MAIN(EditorDataTest)
@@ -24,6 +24,8 @@ public:
 
 private slots:
 
+    void testBestOverlapNodeOnRelease();
+
     void testGroupMove();
 
     void testGroupSelection();
@@ -42,6 +44,8 @@ private slots:
 
     void testUndoDeleteEdge();
 
+    void testUndoDeleteNode();
+
     void testUndoBackgroundColor();
 
     void testUndoCornerRadius();
@@ -62,6 +66,10 @@ private slots:
 
     void testUndoNodeTextColor();
 
+    void testUndoKeepsUnchangedItems();
+
+    void testUndoPointClearsRedo();
+
     void testUndoTextSize();
 
     void testUndoState();
@@ -73,4 +81,6 @@ private slots:
     void testUndoModificationFlagOnNewDesign();
 
     void testUndoModificationFlagOnLoadDesign();
+
+    void testUndoJournalIsOptional();
 };
@@ -0,0 +1,189 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_algorithms_test.hpp"
+
+#include "graph.hpp"
+#include "graph_algorithms.hpp"
+#include "node_base.hpp"
+#include "parallel.hpp"
+
+using std::make_shared;
+
+GraphAlgorithmsTest::GraphAlgorithmsTest()
+{
+}
+
+namespace {
+
+//! Builds the tree 0 -> 1, 0 -> 2, 1 -> 3, 1 -> 4 and returns the node ids in index order
+std::vector<NodeId> buildTree(Graph & graph)
+{
+    std::vector<NodeId> ids;
+    for (int i = 0; i < 5; i++) {
+        const auto node = make_shared<NodeBase>();
+        graph.addNode(node);
+        ids.push_back(node->id());
+    }
+
+    graph.addEdge(0, 1);
+    graph.addEdge(0, 2);
+    graph.addEdge(1, 3);
+    graph.addEdge(1, 4);
+
+    return ids;
+}
+
+} // namespace
+
+void GraphAlgorithmsTest::testSubtreeBreadthFirst()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    const std::vector<NodeId> expected = { ids.at(0), ids.at(1), ids.at(2), ids.at(3), ids.at(4) };
+    QVERIFY(GraphAlgorithms::subtree(graph, ids.at(0)) == expected);
+
+    const std::vector<NodeId> expectedBranch = { ids.at(1), ids.at(3), ids.at(4) };
+    QVERIFY(GraphAlgorithms::subtree(graph, ids.at(1)) == expectedBranch);
+
+    QVERIFY(GraphAlgorithms::subtree(graph, NodeId {}).empty());
+}
+
+void GraphAlgorithmsTest::testSubtreeDepthFirst()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    const std::vector<NodeId> expected = { ids.at(0), ids.at(1), ids.at(3), ids.at(4), ids.at(2) };
+    QVERIFY(GraphAlgorithms::subtree(graph, ids.at(0), GraphAlgorithms::Order::DepthFirst) == expected);
+}
+
+void GraphAlgorithmsTest::testSubtreeWithCycle()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+    graph.addEdge(4, 0);
+
+    QCOMPARE(GraphAlgorithms::subtree(graph, ids.at(1)).size(), static_cast<size_t>(5));
+    QCOMPARE(GraphAlgorithms::subtree(graph, ids.at(1), GraphAlgorithms::Order::DepthFirst).size(), static_cast<size_t>(5));
+}
+
+void GraphAlgorithmsTest::testComponent()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    const auto node5 = make_shared<NodeBase>();
+    graph.addNode(node5);
+
+    // Edge directions are ignored
+    QCOMPARE(GraphAlgorithms::component(graph, ids.at(3)).size(), static_cast<size_t>(5));
+    QCOMPARE(GraphAlgorithms::component(graph, node5->id()).size(), static_cast<size_t>(1));
+}
+
+void GraphAlgorithmsTest::testDepths()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    const auto depths = GraphAlgorithms::depths(graph, ids.at(0));
+    QCOMPARE(depths.size(), static_cast<size_t>(5));
+    QCOMPARE(depths.at(ids.at(0)), static_cast<size_t>(0));
+    QCOMPARE(depths.at(ids.at(2)), static_cast<size_t>(1));
+    QCOMPARE(depths.at(ids.at(4)), static_cast<size_t>(2));
+}
+
+void GraphAlgorithmsTest::testRoot()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    QCOMPARE(GraphAlgorithms::root(graph, ids.at(4)), ids.at(0));
+    QCOMPARE(GraphAlgorithms::root(graph, ids.at(0)), ids.at(0));
+
+    // Terminates on a cycle
+    graph.addEdge(4, 0);
+    QVERIFY(GraphAlgorithms::root(graph, ids.at(4)).isValid());
+}
+
+void GraphAlgorithmsTest::testRoots()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    const auto node5 = make_shared<NodeBase>();
+    graph.addNode(node5);
+
+    const std::vector<NodeId> expected = { ids.at(0), node5->id() };
+    QVERIFY(GraphAlgorithms::roots(graph) == expected);
+}
+
+void GraphAlgorithmsTest::testRootsOnLargeGraph()
+{
+    Graph graph;
+
+    // Chains of three nodes over several blocks
+    const size_t nodeCount = 3 * Parallel::BLOCK_SIZE;
+    std::vector<NodeId> expected;
+    for (size_t i = 0; i < nodeCount; i++) {
+        const auto node = make_shared<NodeBase>();
+        graph.addNode(node);
+        if (i % 3) {
+            graph.addEdge(node->index() - 1, node->index());
+        } else {
+            expected.push_back(node->id());
+        }
+    }
+
+    QVERIFY(GraphAlgorithms::roots(graph) == expected);
+}
+
+void GraphAlgorithmsTest::testDegreeHistogram()
+{
+    Graph graph;
+    QVERIFY(GraphAlgorithms::degreeHistogram(graph).empty());
+    QVERIFY(GraphAlgorithms::degreeHistogram(graph.snapshot()).result().empty());
+
+    buildTree(graph);
+    graph.addNode(make_shared<NodeBase>());
+
+    // Node 5 has no edges, 2, 3 and 4 have one, 0 has two and 1 has three
+    const std::vector<size_t> expected = { 1, 3, 1, 1 };
+    QVERIFY(GraphAlgorithms::degreeHistogram(graph) == expected);
+
+    // The background pass sees the graph as it was when started
+    const auto histogram = GraphAlgorithms::degreeHistogram(graph.snapshot());
+    graph.addNode(make_shared<NodeBase>());
+    QVERIFY(histogram.result() == expected);
+}
+
+void GraphAlgorithmsTest::testHasCycle()
+{
+    Graph graph;
+    const auto ids = buildTree(graph);
+
+    // A diamond is not a cycle
+    graph.addEdge(2, 4);
+    QVERIFY(!GraphAlgorithms::hasCycle(graph));
+    QVERIFY(!GraphAlgorithms::hasCycle(graph, ids.at(0)));
+
+    graph.addEdge(4, 1);
+    QVERIFY(GraphAlgorithms::hasCycle(graph));
+    QVERIFY(GraphAlgorithms::hasCycle(graph, ids.at(2)));
+    QVERIFY(!GraphAlgorithms::hasCycle(graph, ids.at(3)));
+}
+
+QTEST_GUILESS_MAIN(GraphAlgorithmsTest)
@@ -17,6 +17,12 @@
 
 #include "graph.hpp"
 #include "node_base.hpp"
+#include "parallel.hpp"
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <set>
 
 using std::make_shared;
 
@@ -167,6 +173,29 @@ void GraphTest::testDeleteEdge()
     QCOMPARE(dut.areDirectlyConnected(node0, node1), false);
 }
 
+void GraphTest::testDeleteEdgeKeepsReverseEdge()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+    dut.addEdge(make_shared<EdgeBase>(*node1, *node0));
+
+    dut.deleteEdge(node0->index(), node1->index());
+
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesFromNode(node0).size(), static_cast<size_t>(0));
+    QCOMPARE(dut.getEdgesToNode(node1).size(), static_cast<size_t>(0));
+    QCOMPARE(dut.getEdgesFromNode(node1).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesToNode(node0).size(), static_cast<size_t>(1));
+    QVERIFY(dut.areDirectlyConnected(node0, node1));
+}
+
 void GraphTest::testDeleteNode()
 {
     Graph dut;
@@ -206,6 +235,542 @@ void GraphTest::testDeleteNodeInvolvingEdge()
     QCOMPARE(dut.getEdgesToNode(node1).size(), static_cast<size_t>(0));
 }
 
+void GraphTest::testDeleteHubNode()
+{
+    Graph dut;
+
+    const auto hub = make_shared<NodeBase>();
+    dut.addNode(hub);
+
+    std::vector<NodeBasePtr> leaves;
+    for (int i = 0; i < 100; i++) {
+        const auto leaf = make_shared<NodeBase>();
+        dut.addNode(leaf);
+        leaves.push_back(leaf);
+        if (i % 2) {
+            dut.addEdge(make_shared<EdgeBase>(*hub, *leaf));
+        } else {
+            dut.addEdge(make_shared<EdgeBase>(*leaf, *hub));
+        }
+    }
+
+    dut.addEdge(make_shared<EdgeBase>(*leaves.at(0), *leaves.at(1)));
+
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(101));
+
+    dut.deleteNode(hub->index());
+
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(100));
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(1));
+    QVERIFY(dut.areDirectlyConnected(leaves.at(0), leaves.at(1)));
+
+    // Remaining nodes must still be reachable by index after the swap-and-pop
+    for (auto && leaf : leaves) {
+        QCOMPARE(dut.getNode(leaf->index()), leaf);
+    }
+
+    dut.deleteEdge(leaves.at(0)->index(), leaves.at(1)->index());
+
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(0));
+}
+
+void GraphTest::testDeleteNodeUpdatesNeighborAdjacency()
+{
+    Graph dut;
+
+    const auto hub = make_shared<NodeBase>();
+    dut.addNode(hub);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    const auto node2 = make_shared<NodeBase>();
+    dut.addNode(node2);
+
+    const auto node3 = make_shared<NodeBase>();
+    dut.addNode(node3);
+
+    dut.addEdge(make_shared<EdgeBase>(*hub, *node1));
+    dut.addEdge(make_shared<EdgeBase>(*hub, *node2));
+    dut.addEdge(make_shared<EdgeBase>(*node3, *hub));
+    dut.addEdge(make_shared<EdgeBase>(*node1, *node2));
+
+    dut.deleteNode(hub->index());
+
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(3));
+    QVERIFY(dut.getNode(hub->index()) == nullptr);
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(1));
+
+    QCOMPARE(dut.getEdgesToNode(node1).size(), static_cast<size_t>(0));
+    QCOMPARE(dut.getEdgesFromNode(node3).size(), static_cast<size_t>(0));
+
+    QCOMPARE(dut.getEdgesFromNode(node1).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesToNode(node2).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesToNode(node2).at(0)->sourceNodeBase().index(), node1->index());
+
+    QCOMPARE(dut.getNodesConnectedToNode(node3).size(), static_cast<size_t>(0));
+    QVERIFY(!dut.areDirectlyConnected(hub, node3));
+}
+
+void GraphTest::testBulkBuild()
+{
+    Graph dut;
+    dut.reserve(4, 4);
+
+    const auto node0 = make_shared<NodeBase>();
+    node0->setIndex(10);
+    const auto node1 = make_shared<NodeBase>();
+    const auto node2 = make_shared<NodeBase>();
+    node2->setIndex(5);
+
+    dut.appendNode(node0);
+    dut.appendNode(node1);
+    dut.appendNode(node2);
+
+    // Nothing is indexed before finalize()
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(0));
+
+    QCOMPARE(dut.finalize(), static_cast<size_t>(0));
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(3));
+    QCOMPARE(node1->index(), 11); // Assigned after the biggest index in the batch
+    QCOMPARE(dut.getNode(10), node0);
+    QCOMPARE(dut.getNode(5), node2);
+    QCOMPARE(dut.geometry().size(), static_cast<size_t>(3));
+
+    const auto notInGraph = make_shared<NodeBase>();
+    notInGraph->setIndex(6);
+
+    dut.appendEdge(make_shared<EdgeBase>(*node0, *node1));
+    dut.appendEdge(make_shared<EdgeBase>(*node0, *node1)); // Duplicate
+    dut.appendEdge(make_shared<EdgeBase>(*node1, *node2));
+    dut.appendEdge(make_shared<EdgeBase>(*node2, *notInGraph)); // Dangling
+
+    QCOMPARE(dut.finalize(), static_cast<size_t>(2));
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(2));
+    QCOMPARE(dut.getEdgesFromNode(node0).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesToNode(node2).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.getEdgesFromNode(node2).size(), static_cast<size_t>(0));
+
+    // Incremental additions continue after the bulk built nodes
+    const auto node3 = make_shared<NodeBase>();
+    dut.addNode(node3);
+    QCOMPARE(node3->index(), 12);
+}
+
+void GraphTest::testBulkBuildRejectsDuplicateNodeIndex()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    node0->setIndex(1);
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    node1->setIndex(1);
+    dut.appendNode(node1);
+
+    QCOMPARE(dut.finalize(), static_cast<size_t>(1));
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(1));
+    QCOMPARE(dut.getNode(1), node0);
+}
+
+void GraphTest::testComponents()
+{
+    Graph dut;
+
+    Graph::NodeVector nodes;
+    for (int i = 0; i < 6; i++) {
+        nodes.push_back(make_shared<NodeBase>());
+        dut.addNode(nodes.back());
+    }
+
+    QCOMPARE(dut.componentCount(), static_cast<size_t>(6));
+
+    // 0 -> 1 -> 2 <- 3, 4 -> 5
+    dut.addEdge(0, 1);
+    dut.addEdge(1, 2);
+    dut.addEdge(3, 2);
+    dut.addEdge(4, 5);
+
+    QCOMPARE(dut.componentCount(), static_cast<size_t>(2));
+    QCOMPARE(dut.componentId(nodes.at(0)->id()), dut.componentId(nodes.at(3)->id()));
+    QVERIFY(dut.componentId(nodes.at(0)->id()) != dut.componentId(nodes.at(4)->id()));
+    QCOMPARE(dut.componentSize(nodes.at(3)->id()), static_cast<size_t>(4));
+
+    // A reverse edge keeps 1 and 2 connected when 1 -> 2 is deleted
+    dut.addEdge(2, 1);
+    dut.deleteEdge(1, 2);
+    QCOMPARE(dut.componentCount(), static_cast<size_t>(2));
+
+    dut.deleteEdge(2, 1);
+    QCOMPARE(dut.componentCount(), static_cast<size_t>(3));
+    QCOMPARE(dut.componentSize(nodes.at(0)->id()), static_cast<size_t>(2));
+    QCOMPARE(dut.componentSize(nodes.at(2)->id()), static_cast<size_t>(2));
+
+    // Deleting the middle node splits 0 - 1 - 2 into two
+    dut.addEdge(1, 2);
+    dut.deleteNode(1);
+    QCOMPARE(dut.componentCount(), static_cast<size_t>(3));
+    QCOMPARE(dut.componentSize(nodes.at(0)->id()), static_cast<size_t>(1));
+    QCOMPARE(dut.componentSize(nodes.at(3)->id()), static_cast<size_t>(2));
+    QCOMPARE(dut.componentSize(nodes.at(1)->id()), static_cast<size_t>(0));
+}
+
+void GraphTest::testComponentsMatchFullRecomputation()
+{
+    Graph dut;
+
+    const int nodeCount = 40;
+    for (int i = 0; i < nodeCount; i++) {
+        dut.addNode(make_shared<NodeBase>());
+    }
+
+    // Deterministic pseudo random sequence of edge additions and deletions
+    unsigned int seed = 1;
+    const auto next = [&seed](int range) {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<int>((seed / 65536) % static_cast<unsigned int>(range));
+    };
+
+    for (int round = 0; round < 400; round++) {
+        const int index0 = next(nodeCount);
+        const int index1 = next(nodeCount);
+        if (!dut.getNode(index0) || !dut.getNode(index1)) {
+            continue;
+        }
+        if (next(3)) {
+            dut.addEdge(index0, index1);
+        } else if (next(10)) {
+            dut.deleteEdge(index0, index1);
+        } else {
+            dut.deleteNode(index0);
+            continue;
+        }
+
+        // Naive union-find over all edges as the reference
+        std::map<int, int> parent;
+        const std::function<int(int)> find = [&](int index) {
+            return parent[index] == index ? index : parent[index] = find(parent[index]);
+        };
+        for (auto && node : dut.getNodes()) {
+            parent[node->index()] = node->index();
+        }
+        for (auto && edge : dut.getEdges()) {
+            parent[find(edge->sourceNodeBase().index())] = find(edge->targetNodeBase().index());
+        }
+
+        std::set<int> roots;
+        for (auto && node : dut.getNodes()) {
+            roots.insert(find(node->index()));
+        }
+        QCOMPARE(dut.componentCount(), roots.size());
+
+        for (auto && edge : dut.getEdges()) {
+            QCOMPARE(dut.componentId(edge->sourceNodeBase().id()), dut.componentId(edge->targetNodeBase().id()));
+        }
+        for (auto && node0 : dut.getNodes()) {
+            for (auto && node1 : dut.getNodes()) {
+                QCOMPARE(dut.componentId(node0->id()) == dut.componentId(node1->id()), find(node0->index()) == find(node1->index()));
+            }
+        }
+    }
+}
+
+void GraphTest::testClear()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+
+    dut.clear();
+
+    QCOMPARE(dut.numNodes(), static_cast<size_t>(0));
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(0));
+    QVERIFY(dut.getNode(node0->index()) == nullptr);
+    QCOMPARE(dut.getEdgesFromNode(node0).size(), static_cast<size_t>(0));
+    QCOMPARE(dut.getEdgesToNode(node1).size(), static_cast<size_t>(0));
+}
+
+void GraphTest::testDuplicateEdgeAfterDelete()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    const auto node2 = make_shared<NodeBase>();
+    dut.addNode(node2);
+
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+    dut.addEdge(make_shared<EdgeBase>(*node1, *node2));
+    dut.deleteEdge(node0->index(), node1->index());
+
+    // The moved edge must still be recognized as a duplicate
+    dut.addEdge(make_shared<EdgeBase>(*node1, *node2));
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(1));
+
+    // A deleted edge can be added again
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(2));
+    QCOMPARE(dut.getEdgesFromNode(node0).size(), static_cast<size_t>(1));
+}
+
+void GraphTest::testGeometryReadsThroughTable()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    node0->setLocation({ 1, 2 });
+    node0->setSize({ 10, 20 });
+    node0->setCornerRadius(3);
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    node1->setLocation({ 100, 200 });
+    node1->setSize({ 30, 40 });
+    dut.addNode(node1);
+
+    QCOMPARE(dut.geometry().size(), static_cast<size_t>(2));
+    QCOMPARE(dut.geometry().location(0), QPointF(1, 2));
+    QCOMPARE(dut.geometry().nodeSize(1), QSizeF(30, 40));
+    QCOMPARE(dut.geometry().cornerRadius(0), 3);
+
+    node0->setLocation({ 5, 6 });
+    QCOMPARE(dut.geometry().x().at(0), 5.0);
+    QCOMPARE(dut.geometry().y().at(0), 6.0);
+    QCOMPARE(node0->location(), QPointF(5, 6));
+
+    QCOMPARE(dut.geometry().boundingRect(), QRectF(0, -4, 115, 224));
+}
+
+void GraphTest::testGeometryPassesOnLargeGraph()
+{
+    Graph dut;
+
+    // Enough nodes to split the passes into several blocks
+    const size_t nodeCount = 3 * Parallel::BLOCK_SIZE + 123;
+    dut.reserve(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; i++) {
+        const auto node = make_shared<NodeBase>();
+        node->setLocation({ static_cast<double>(i % 1000), static_cast<double>(i / 1000) });
+        node->setSize({ 0.5, 0.25 });
+        dut.appendNode(node);
+    }
+    dut.finalize();
+
+    QCOMPARE(dut.geometry().boundingRect(), QRectF(-0.25, -0.125, 999.5, nodeCount / 1000 + 0.25));
+
+    QVERIFY(std::fabs(dut.geometry().nodeArea() - nodeCount * 0.5 * 0.25) < 1e-6);
+
+    // Results are in ascending slot order across block boundaries
+    const auto hits = dut.geometry().intersectingSlots({ 9.9, -1, 0.2, 100 });
+    QCOMPARE(hits.size(), static_cast<size_t>(nodeCount / 1000 + 1));
+    for (size_t i = 0; i < hits.size(); i++) {
+        QCOMPARE(dut.geometry().x().at(hits.at(i)), 10.0);
+        QCOMPARE(dut.geometry().y().at(hits.at(i)), static_cast<double>(i));
+    }
+
+    // The background pass runs on a copy of the columns, so moving nodes meanwhile doesn't affect it
+    const auto columns = std::make_shared<const NodeGeometryColumns>(dut.geometry().columns());
+    const auto future = NodeGeometryColumns::intersectingSlots(columns, { 9.9, -1, 0.2, 100 });
+    dut.getNodes().at(hits.at(0))->setLocation({ -100, -100 });
+    QVERIFY(future.result() == hits);
+}
+
+void GraphTest::testGeometrySlotsFollowNodes()
+{
+    Graph dut;
+
+    std::vector<NodeBasePtr> nodes;
+    for (int i = 0; i < 5; i++) {
+        const auto node = make_shared<NodeBase>();
+        node->setLocation({ static_cast<double>(i), 0 });
+        node->setSize({ 1, 1 });
+        dut.addNode(node);
+        nodes.push_back(node);
+    }
+
+    dut.deleteNode(nodes.at(1)->index());
+
+    // The deleted node keeps its geometry after being detached
+    QCOMPARE(nodes.at(1)->location(), QPointF(1, 0));
+    nodes.at(1)->setLocation({ 42, 42 });
+    QCOMPARE(nodes.at(1)->location(), QPointF(42, 42));
+
+    QCOMPARE(dut.geometry().size(), dut.numNodes());
+    for (size_t slot = 0; slot < dut.numNodes(); slot++) {
+        QCOMPARE(&dut.geometry().node(slot), dut.getNodes().at(slot).get());
+        QCOMPARE(dut.geometry().location(slot), dut.getNodes().at(slot)->location());
+    }
+
+    QCOMPARE(dut.geometry().intersectingSlots(QRectF(3.5, -1, 1, 2)).size(), static_cast<size_t>(1));
+    QCOMPARE(dut.geometry().intersectingSlots(QRectF(3.5, -1, 1, 2), 1).size(), static_cast<size_t>(2));
+
+    dut.clear();
+
+    QCOMPARE(dut.geometry().size(), static_cast<size_t>(0));
+    QCOMPARE(nodes.at(4)->location(), QPointF(4, 0));
+}
+
+void GraphTest::testEdgeViewsAndDegrees()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    const auto node2 = make_shared<NodeBase>();
+    dut.addNode(node2);
+
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node2));
+    dut.addEdge(make_shared<EdgeBase>(*node2, *node1));
+
+    QCOMPARE(dut.outDegree(node0->id()), static_cast<size_t>(2));
+    QCOMPARE(dut.inDegree(node0->id()), static_cast<size_t>(0));
+    QCOMPARE(dut.inDegree(node1->id()), static_cast<size_t>(2));
+    QCOMPARE(dut.outDegree(node2->id()), static_cast<size_t>(1));
+
+    const auto from0 = dut.edgesFrom(node0->id());
+    QCOMPARE(from0.size(), static_cast<size_t>(2));
+    QCOMPARE(&from0[0]->targetNodeBase(), node1.get());
+    QCOMPARE(&from0[1]->targetNodeBase(), node2.get());
+
+    size_t count = 0;
+    for (auto && edge : dut.edgesTo(node1->id())) {
+        QCOMPARE(&edge->targetNodeBase(), node1.get());
+        count++;
+    }
+    QCOMPARE(count, static_cast<size_t>(2));
+
+    QVERIFY(dut.areDirectlyConnected(node1->id(), node0->id()));
+    QVERIFY(!dut.areDirectlyConnected(node1->id(), node1->id()));
+
+    const auto staleId = node2->id();
+    dut.deleteNode(node2->index());
+
+    QVERIFY(dut.edgesFrom(staleId).empty());
+    QCOMPARE(dut.outDegree(staleId), static_cast<size_t>(0));
+    QCOMPARE(dut.outDegree(node0->id()), static_cast<size_t>(1));
+    QCOMPARE(dut.inDegree(node1->id()), static_cast<size_t>(1));
+}
+
+void GraphTest::testSnapshot()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    node0->setText("0");
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    const auto node2 = make_shared<NodeBase>();
+    dut.addNode(node2);
+
+    const auto edge01 = make_shared<EdgeBase>(*node0, *node1);
+    dut.addEdge(edge01);
+    dut.addEdge(make_shared<EdgeBase>(*node1, *node2));
+
+    const auto snapshot0 = dut.snapshot();
+    QCOMPARE(snapshot0.nodes.size(), static_cast<size_t>(3));
+    QCOMPARE(snapshot0.edges.size(), static_cast<size_t>(2));
+    QCOMPARE(snapshot0.nodes.at(0).text, QString { "0" });
+
+    // Nothing changed: the same records are returned
+    QVERIFY(dut.snapshot().nodes.isSameAs(snapshot0.nodes));
+
+    node0->setText("changed");
+    node2->setLocation({ 1, 2 });
+    edge01->setText("edge");
+    dut.deleteNode(node1->index());
+
+    const auto snapshot1 = dut.snapshot();
+
+    // Records follow the order of the live nodes and edges
+    QCOMPARE(snapshot1.nodes.size(), dut.numNodes());
+    for (size_t i = 0; i < dut.numNodes(); i++) {
+        QCOMPARE(snapshot1.nodes.at(i).index, dut.getNodes().at(i)->index());
+        QCOMPARE(snapshot1.nodes.at(i).text, dut.getNodes().at(i)->text());
+        QCOMPARE(snapshot1.nodes.at(i).location, dut.getNodes().at(i)->location());
+    }
+    QCOMPARE(snapshot1.edges.size(), static_cast<size_t>(0));
+
+    // The earlier snapshot is intact
+    QCOMPARE(snapshot0.nodes.size(), static_cast<size_t>(3));
+    QCOMPARE(snapshot0.nodes.at(0).text, QString { "0" });
+    QCOMPARE(snapshot0.nodes.at(2).location, QPointF {});
+    QCOMPARE(snapshot0.edges.size(), static_cast<size_t>(2));
+    QCOMPARE(snapshot0.edges.at(0).text, QString {});
+
+    // Removed and cleared items no longer report changes
+    node1->setText("deleted");
+    dut.clear();
+    node0->setText("cleared");
+    QCOMPARE(dut.snapshot().nodes.size(), static_cast<size_t>(0));
+}
+
+void GraphTest::testSnapshotApplyDifference()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    const auto edge01 = make_shared<EdgeBase>(*node0, *node1);
+    dut.addEdge(edge01);
+
+    // Outside of a transaction every notifying setter call is delivered as its own batch
+    std::vector<GraphChange> changes;
+    dut.addChangeObserver([&](const Graph::ChangeBatch & batch) {
+        changes.insert(changes.end(), batch.begin(), batch.end());
+    });
+
+    const NodeRecord nodeBefore(*node0);
+    auto nodeAfter = nodeBefore;
+    nodeAfter.text = "changed";
+    nodeAfter.location = { 1, 2 };
+
+    nodeAfter.applyTo(*node0, nodeBefore);
+
+    QCOMPARE(node0->text(), QString("changed"));
+    QCOMPARE(node0->location(), QPointF(1, 2));
+    QCOMPARE(changes.size(), static_cast<size_t>(2));
+
+    changes.clear();
+    const EdgeRecord edgeBefore(*edge01);
+    auto edgeAfter = edgeBefore;
+    edgeAfter.reversed = true;
+
+    edgeAfter.applyTo(*edge01, edgeBefore);
+
+    QCOMPARE(edge01->reversed(), true);
+    QCOMPARE(edge01->text(), edgeBefore.text);
+    QCOMPARE(changes.size(), static_cast<size_t>(1));
+
+    changes.clear();
+    nodeAfter.applyTo(*node0, nodeAfter);
+    edgeAfter.applyTo(*edge01, edgeAfter);
+
+    QCOMPARE(changes.size(), static_cast<size_t>(0));
+}
+
 void GraphTest::testGetEdges()
 {
     Graph dut;
@@ -303,4 +868,242 @@ void GraphTest::testGetNodeByIndex_NotFound()
     QVERIFY(dut.getNode(1) == nullptr);
 }
 
+void GraphTest::testGetNodeByIndex_AfterDelete()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    node1->setIndex(42);
+    dut.addNode(node1);
+
+    dut.deleteNode(node0->index());
+
+    QVERIFY(dut.getNode(node0->index()) == nullptr);
+    QCOMPARE(dut.getNode(42), node1);
+}
+
+void GraphTest::testGetNodeById()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    QVERIFY(!node0->id().isValid());
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    QVERIFY(node0->id().isValid());
+    QVERIFY(node0->id() != node1->id());
+    QCOMPARE(dut.getNodeId(node0->index()), node0->id());
+    QCOMPARE(dut.getNode(node0->id()), node0.get());
+    QCOMPARE(dut.getNode(node1->id()), node1.get());
+    QVERIFY(dut.getNode(NodeId {}) == nullptr);
+    QVERIFY(!dut.getNodeId(666).isValid());
+}
+
+void GraphTest::testStaleNodeId()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+    const auto staleId = node0->id();
+
+    dut.deleteNode(node0->index());
+
+    QVERIFY(!node0->id().isValid());
+    QVERIFY(!dut.contains(staleId));
+
+    // The freed slot is reused with a new generation
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    QCOMPARE(node1->id().slot(), staleId.slot());
+    QVERIFY(node1->id() != staleId);
+    QVERIFY(dut.getNode(staleId) == nullptr);
+    QCOMPARE(dut.getNode(node1->id()), node1.get());
+
+    dut.clear();
+
+    QVERIFY(!dut.contains(staleId));
+    QVERIFY(!node1->id().isValid());
+}
+
+void GraphTest::testAddEdgeRejectsDanglingEdge()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+
+    const auto node1 = make_shared<NodeBase>();
+    node1->setIndex(1);
+
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+
+    QCOMPARE(dut.getEdges().size(), static_cast<size_t>(0));
+}
+
+void GraphTest::testChangeObserver()
+{
+    Graph dut;
+
+    std::vector<Graph::ChangeBatch> batches;
+    dut.addChangeObserver([&](const Graph::ChangeBatch & changes) {
+        batches.push_back(changes);
+    });
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+    const auto edge = make_shared<EdgeBase>(*node0, *node1);
+    dut.addEdge(edge);
+    node0->setLocation({ 1, 1 });
+    node1->setText("1");
+    edge->setText("edge");
+
+    // Outside of a transaction every change is its own batch
+    QCOMPARE(batches.size(), static_cast<size_t>(6));
+    for (auto && batch : batches) {
+        QCOMPARE(batch.size(), static_cast<size_t>(1));
+    }
+
+    QVERIFY(batches.at(0).at(0).type == GraphChange::Type::NodeAdded);
+    QCOMPARE(batches.at(0).at(0).node, node0->id());
+    QCOMPARE(batches.at(0).at(0).index, node0->index());
+
+    QVERIFY(batches.at(2).at(0).type == GraphChange::Type::EdgeAdded);
+    QCOMPARE(batches.at(2).at(0).node, node0->id());
+    QCOMPARE(batches.at(2).at(0).targetNode, node1->id());
+    QCOMPARE(dut.getEdge(batches.at(2).at(0).node, batches.at(2).at(0).targetNode), edge.get());
+
+    QVERIFY(batches.at(3).at(0).type == GraphChange::Type::NodeMoved);
+    QVERIFY(batches.at(4).at(0).type == GraphChange::Type::NodeChanged);
+    QVERIFY(batches.at(5).at(0).type == GraphChange::Type::EdgeChanged);
+
+    dut.clear();
+    QCOMPARE(batches.size(), static_cast<size_t>(7));
+    QVERIFY(batches.back().at(0).type == GraphChange::Type::Cleared);
+
+    // Clearing an empty graph is not a change
+    dut.clear();
+    QCOMPARE(batches.size(), static_cast<size_t>(7));
+}
+
+void GraphTest::testChangeTransaction()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+
+    std::vector<Graph::ChangeBatch> batches;
+    dut.addChangeObserver([&](const Graph::ChangeBatch & changes) {
+        batches.push_back(changes);
+    });
+
+    dut.beginChanges();
+    for (int i = 0; i < 10; i++) {
+        node0->setLocation({ static_cast<double>(i), 0 });
+        node1->setLocation({ 0, static_cast<double>(i) });
+    }
+
+    dut.beginChanges();
+    dut.reportChange({ GraphChange::Type::StyleChanged });
+    dut.reportChange({ GraphChange::Type::StyleChanged });
+    dut.endChanges();
+
+    // Only the outermost transaction delivers
+    QVERIFY(batches.empty());
+
+    dut.endChanges();
+
+    // Repeated moves of the same node are reported once
+    QCOMPARE(batches.size(), static_cast<size_t>(1));
+    QCOMPARE(batches.at(0).size(), static_cast<size_t>(3));
+    QVERIFY(batches.at(0).at(0).type == GraphChange::Type::NodeMoved);
+    QCOMPARE(batches.at(0).at(0).node, node0->id());
+    QVERIFY(batches.at(0).at(1).type == GraphChange::Type::NodeMoved);
+    QCOMPARE(batches.at(0).at(1).node, node1->id());
+    QVERIFY(batches.at(0).at(2).type == GraphChange::Type::StyleChanged);
+
+    // An empty transaction delivers nothing
+    dut.beginChanges();
+    dut.endChanges();
+    QCOMPARE(batches.size(), static_cast<size_t>(1));
+
+    // The next batch reports the same node again
+    node0->setLocation({ 1, 1 });
+    QCOMPARE(batches.size(), static_cast<size_t>(2));
+    QVERIFY(batches.at(1).at(0).type == GraphChange::Type::NodeMoved);
+}
+
+void GraphTest::testChangeObserver_DeleteNode()
+{
+    Graph dut;
+
+    const auto node0 = make_shared<NodeBase>();
+    dut.addNode(node0);
+    const auto node1 = make_shared<NodeBase>();
+    dut.addNode(node1);
+    const auto node2 = make_shared<NodeBase>();
+    dut.addNode(node2);
+    dut.addEdge(make_shared<EdgeBase>(*node0, *node1));
+    dut.addEdge(make_shared<EdgeBase>(*node2, *node1));
+
+    const auto id1 = node1->id();
+
+    std::vector<Graph::ChangeBatch> batches;
+    dut.addChangeObserver([&](const Graph::ChangeBatch & changes) {
+        batches.push_back(changes);
+    });
+
+    dut.deleteNode(node1->index());
+
+    // The node and its edges are reported as a single batch with the node last
+    QCOMPARE(batches.size(), static_cast<size_t>(1));
+    QCOMPARE(batches.at(0).size(), static_cast<size_t>(3));
+    QVERIFY(batches.at(0).at(0).type == GraphChange::Type::EdgeRemoved);
+    QCOMPARE(batches.at(0).at(0).targetNode, id1);
+    QVERIFY(batches.at(0).at(1).type == GraphChange::Type::EdgeRemoved);
+    QCOMPARE(batches.at(0).at(1).targetNode, id1);
+    QVERIFY(batches.at(0).at(2).type == GraphChange::Type::NodeRemoved);
+    QCOMPARE(batches.at(0).at(2).node, id1);
+    QCOMPARE(batches.at(0).at(2).index, node1->index());
+
+    // The handles in the batch are already stale
+    QVERIFY(!dut.contains(batches.at(0).at(2).node));
+}
+
+void GraphTest::testRemoveChangeObserver()
+{
+    Graph dut;
+
+    size_t count0 = 0;
+    size_t count1 = 0;
+    const auto id0 = dut.addChangeObserver([&](const Graph::ChangeBatch &) {
+        count0++;
+    });
+    dut.addChangeObserver([&](const Graph::ChangeBatch &) {
+        count1++;
+    });
+
+    dut.addNode(make_shared<NodeBase>());
+    QCOMPARE(count0, static_cast<size_t>(1));
+    QCOMPARE(count1, static_cast<size_t>(1));
+
+    dut.removeChangeObserver(id0);
+
+    dut.addNode(make_shared<NodeBase>());
+    QCOMPARE(count0, static_cast<size_t>(1));
+    QCOMPARE(count1, static_cast<size_t>(2));
+}
+
 QTEST_GUILESS_MAIN(GraphTest)
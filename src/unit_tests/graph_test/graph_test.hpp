@@ -36,10 +36,36 @@ private slots:
 
     void testDeleteEdge();
 
+    void testDeleteEdgeKeepsReverseEdge();
+
     void testDeleteNode();
 
     void testDeleteNodeInvolvingEdge();
 
+    void testDeleteHubNode();
+
+    void testDeleteNodeUpdatesNeighborAdjacency();
+
+    void testBulkBuild();
+
+    void testBulkBuildRejectsDuplicateNodeIndex();
+
+    void testClear();
+
+    void testComponents();
+
+    void testComponentsMatchFullRecomputation();
+
+    void testDuplicateEdgeAfterDelete();
+
+    void testGeometryReadsThroughTable();
+
+    void testGeometrySlotsFollowNodes();
+
+    void testGeometryPassesOnLargeGraph();
+
+    void testEdgeViewsAndDegrees();
+
     void testGetEdges();
 
     void testGetNodes();
@@ -49,4 +75,24 @@ private slots:
     void testGetNodeByIndex();
 
     void testGetNodeByIndex_NotFound();
+
+    void testGetNodeByIndex_AfterDelete();
+
+    void testSnapshot();
+
+    void testSnapshotApplyDifference();
+
+    void testGetNodeById();
+
+    void testStaleNodeId();
+
+    void testAddEdgeRejectsDanglingEdge();
+
+    void testChangeObserver();
+
+    void testChangeTransaction();
+
+    void testChangeObserver_DeleteNode();
+
+    void testRemoveChangeObserver();
 };
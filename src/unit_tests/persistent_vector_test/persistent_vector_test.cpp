@@ -0,0 +1,185 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "persistent_vector_test.hpp"
+
+#include "persistent_vector.hpp"
+
+#include <algorithm>
+#include <set>
+
+PersistentVectorTest::PersistentVectorTest()
+{
+}
+
+void PersistentVectorTest::testPushBackAndAt()
+{
+    PersistentVector<int> dut;
+    QVERIFY(dut.empty());
+
+    // Enough items for three levels of chunks
+    const int count = 32 * 32 + 5;
+    for (int i = 0; i < count; i++) {
+        dut.push_back(i);
+    }
+
+    QCOMPARE(dut.size(), static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        QCOMPARE(dut.at(static_cast<size_t>(i)), i);
+    }
+    QCOMPARE(dut.back(), count - 1);
+}
+
+void PersistentVectorTest::testPopBack()
+{
+    PersistentVector<int> dut;
+    const int count = 32 * 32 + 5;
+    for (int i = 0; i < count; i++) {
+        dut.push_back(i);
+    }
+
+    for (int i = count - 1; i >= 0; i--) {
+        QCOMPARE(dut.back(), i);
+        dut.pop_back();
+        QCOMPARE(dut.size(), static_cast<size_t>(i));
+    }
+    QVERIFY(dut.empty());
+
+    // Still usable after shrinking to nothing
+    dut.push_back(42);
+    QCOMPARE(dut.at(0), 42);
+}
+
+void PersistentVectorTest::testCopyIsIndependent()
+{
+    PersistentVector<int> dut;
+    for (int i = 0; i < 100; i++) {
+        dut.push_back(i);
+    }
+
+    const auto snapshot = dut;
+    QVERIFY(snapshot.isSameAs(dut));
+
+    dut.set(50, -1);
+    dut.pop_back();
+    dut.push_back(1000);
+    dut.push_back(1001);
+
+    QVERIFY(!snapshot.isSameAs(dut));
+    QCOMPARE(snapshot.size(), static_cast<size_t>(100));
+    for (int i = 0; i < 100; i++) {
+        QCOMPARE(snapshot.at(static_cast<size_t>(i)), i);
+    }
+
+    QCOMPARE(dut.size(), static_cast<size_t>(101));
+    QCOMPARE(dut.at(50), -1);
+    QCOMPARE(dut.at(99), 1000);
+    QCOMPARE(dut.at(100), 1001);
+}
+
+void PersistentVectorTest::testSetCopiesOnlyTouchedPath()
+{
+    PersistentVector<std::shared_ptr<int>> dut;
+    for (int i = 0; i < 1000; i++) {
+        dut.push_back(std::make_shared<int>(i));
+    }
+
+    const auto snapshot = dut;
+    dut.set(0, std::make_shared<int>(-1));
+
+    // Only the chunk holding item 0 was copied: its other items are now referenced from both versions,
+    // while the rest of the chunks are still shared as a whole
+    QCOMPARE(dut.at(0).use_count(), 1l);
+    QCOMPARE(snapshot.at(1).use_count(), 2l);
+    QCOMPARE(snapshot.at(999).use_count(), 1l);
+}
+
+void PersistentVectorTest::testForEachDifference()
+{
+    PersistentVector<int> dut;
+    for (int i = 0; i < 5000; i++) {
+        dut.push_back(i);
+    }
+
+    std::vector<size_t> differences;
+    const auto collect = [&](size_t index) {
+        differences.push_back(index);
+    };
+
+    auto copy = dut;
+    dut.forEachDifference(copy, collect);
+    QVERIFY(differences.empty());
+
+    // Only the chunk of the modified item is reported
+    copy.set(100, -1);
+    dut.forEachDifference(copy, collect);
+    QCOMPARE(differences.size(), static_cast<size_t>(32));
+    QCOMPARE(differences.front(), static_cast<size_t>(96));
+    QCOMPARE(differences.back(), static_cast<size_t>(127));
+
+    // Removed and added items are reported in both directions
+    differences.clear();
+    copy = dut;
+    copy.pop_back();
+    copy.pop_back();
+    dut.forEachDifference(copy, collect);
+    QVERIFY(std::find(differences.begin(), differences.end(), 4998) != differences.end());
+    QVERIFY(std::find(differences.begin(), differences.end(), 4999) != differences.end());
+    QVERIFY(differences.size() <= 32);
+
+    differences.clear();
+    copy.forEachDifference(dut, collect);
+    QVERIFY(std::find(differences.begin(), differences.end(), 4999) != differences.end());
+    QVERIFY(differences.size() <= 32);
+
+    differences.clear();
+    PersistentVector<int>().forEachDifference(dut, collect);
+    QCOMPARE(differences.size(), static_cast<size_t>(5000));
+}
+
+void PersistentVectorTest::testForEachDifferenceAcrossLevels()
+{
+    PersistentVector<int> dut;
+    for (int i = 0; i < 1024; i++) {
+        dut.push_back(i);
+    }
+
+    // Adds a level to the tree
+    auto copy = dut;
+    copy.push_back(1024);
+
+    std::set<size_t> differences;
+    const auto collect = [&](size_t index) {
+        differences.insert(index);
+    };
+
+    dut.forEachDifference(copy, collect);
+    QCOMPARE(differences, std::set<size_t>({ 1024 }));
+
+    differences.clear();
+    copy.forEachDifference(dut, collect);
+    QCOMPARE(differences, std::set<size_t>({ 1024 }));
+
+    // Removes the level again
+    differences.clear();
+    copy.pop_back();
+    copy.set(0, -1);
+    copy.forEachDifference(dut, collect);
+    QVERIFY(differences.count(0));
+    QVERIFY(!differences.count(1023));
+    QVERIFY(differences.size() <= 32);
+}
+
+QTEST_GUILESS_MAIN(PersistentVectorTest)
@@ -19,6 +19,8 @@
 #include "node_base.hpp"
 #include "serializer.hpp"
 
+#include <QBuffer>
+
 SerializerTest::SerializerTest()
 {
 }
@@ -62,6 +64,49 @@ void SerializerTest::testEdgeWidth()
     QCOMPARE(inData->edgeWidth(), outData.edgeWidth());
 }
 
+void SerializerTest::testEmbeddedImageDecodedLazily()
+{
+    QImage outImage(3, 2, QImage::Format_ARGB32);
+    outImage.fill(Qt::red);
+    QBuffer png;
+    png.open(QIODevice::WriteOnly);
+    QVERIFY(outImage.save(&png, "PNG"));
+
+    QBuffer buffer;
+    buffer.setData("<?xml version='1.0' encoding='UTF-8'?>"
+                   "<design version=\"1.0.0\"><image id=\"1\" path=\"foo.png\">"
+                   + png.data().toBase64() + "</image></design>");
+    buffer.open(QIODevice::ReadOnly);
+
+    const auto inData = Serializer::fromXml(buffer);
+    QVERIFY(inData);
+    auto image = inData->imageManager().getImage(1);
+    QVERIFY(image.second);
+    QVERIFY(!image.first.isDecoded());
+    QCOMPARE(image.first.image().size(), outImage.size());
+
+    inData->imageManager().decodeAll();
+    image = inData->imageManager().getImage(1);
+    QVERIFY(image.first.isDecoded());
+    QCOMPARE(image.first.image().size(), outImage.size());
+}
+
+void SerializerTest::testInvalidXml()
+{
+    MindMapData outData;
+    const auto xml = Serializer::toXml(outData).toByteArray();
+
+    QBuffer truncated;
+    truncated.setData(xml.left(xml.size() / 2));
+    truncated.open(QIODevice::ReadOnly);
+    QVERIFY(!Serializer::fromXml(truncated));
+
+    QBuffer trailingGarbage;
+    trailingGarbage.setData(xml + "<design>");
+    trailingGarbage.open(QIODevice::ReadOnly);
+    QVERIFY(!Serializer::fromXml(trailingGarbage));
+}
+
 void SerializerTest::testNotUsedImages()
 {
     MindMapData outData;
@@ -75,6 +120,23 @@ void SerializerTest::testNotUsedImages()
     QCOMPARE(outData.imageManager().images().size(), size_t { 0 });
 }
 
+void SerializerTest::testUnknownElements()
+{
+    QBuffer buffer;
+    buffer.setData("<?xml version='1.0' encoding='UTF-8'?>"
+                   "<design version=\"1.0.0\">"
+                   "<future><graph><node index=\"1\"/></graph></future>"
+                   "<graph><node index=\"0\"><future/><text>Lorem ipsum</text></node></graph>"
+                   "</design>");
+    buffer.open(QIODevice::ReadOnly);
+
+    const auto inData = Serializer::fromXml(buffer);
+    QVERIFY(inData);
+    QCOMPARE(inData->version(), QString("1.0.0"));
+    QCOMPARE(inData->graph().numNodes(), size_t(1));
+    QCOMPARE(inData->graph().getNode(0)->text(), QString("Lorem ipsum"));
+}
+
 void SerializerTest::testUsedImages()
 {
     MindMapData outData;
@@ -94,6 +156,34 @@ void SerializerTest::testUsedImages()
     QCOMPARE(outData.imageManager().images().size(), size_t { 2 });
 }
 
+void SerializerTest::testStreamedSpecialCharacters()
+{
+    MindMapData outData;
+
+    const auto outNode0 = std::make_shared<NodeBase>();
+    outNode0->setText("<\"Lorem\" & 'ipsum'>\n\tdolor ");
+    outData.graph().addNode(outNode0);
+
+    const auto outNode1 = std::make_shared<NodeBase>();
+    outData.graph().addNode(outNode1);
+
+    const auto outEdge = std::make_shared<EdgeBase>(*outNode0, *outNode1);
+    outEdge->setText("]]> &amp;");
+    outData.graph().addEdge(outEdge);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(Serializer::toXml(outData, buffer));
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    const auto inData = Serializer::fromXml(buffer);
+    QVERIFY(inData);
+    QCOMPARE(inData->graph().getNode(outNode0->index())->text(), outNode0->text());
+    QCOMPARE(inData->graph().getEdges().size(), size_t(1));
+    QCOMPARE(inData->graph().getEdges().at(0)->text(), outEdge->text());
+}
+
 void SerializerTest::testTextSize()
 {
     MindMapData outData;
@@ -34,6 +34,10 @@ private slots:
 
     void testEdgeWidth();
 
+    void testEmbeddedImageDecodedLazily();
+
+    void testInvalidXml();
+
     void testNotUsedImages();
 
     void testNodeDeletion();
@@ -42,7 +46,11 @@ private slots:
 
     void testSingleNode();
 
+    void testStreamedSpecialCharacters();
+
     void testTextSize();
 
+    void testUnknownElements();
+
     void testUsedImages();
 };
@@ -0,0 +1,593 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#include "undo_stack_test.hpp"
+
+#include "edge.hpp"
+#include "mind_map_data.hpp"
+#include "node.hpp"
+#include "undo_journal.hpp"
+#include "undo_stack.hpp"
+
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <type_traits>
+
+using std::make_shared;
+
+namespace {
+
+//! Command that writes data that can't be read back
+class UnreadableCommand : public UndoCommand
+{
+public:
+    void redo(MindMapData &) const override
+    {
+    }
+
+    void undo(MindMapData &) const override
+    {
+    }
+
+    size_t byteSize() const override
+    {
+        return sizeof(*this);
+    }
+
+    void write(QDataStream & stream) const override
+    {
+        stream << quint8(255);
+    }
+};
+
+} // namespace
+
+UndoStackTest::UndoStackTest()
+{
+}
+
+void UndoStackTest::testCompressedEdits()
+{
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+
+    const int editCount = static_cast<int>(Constants::Undo::UNCOMPRESSED_EDITS) * 3;
+    for (int i = 0; i < editCount; i++) {
+        undoStack.pushUndoPoint(data);
+        node->setText(QString("text %1 ").arg(i).repeated(100));
+    }
+
+    for (int i = editCount - 1; i >= 0; i--) {
+        QCOMPARE(node->text(), QString("text %1 ").arg(i).repeated(100));
+        QVERIFY(undoStack.undo(data));
+    }
+
+    QCOMPARE(node->text(), QString(""));
+    QCOMPARE(undoStack.undo(data), false);
+
+    for (int i = 0; i < editCount; i++) {
+        QVERIFY(undoStack.redo(data));
+        QCOMPARE(node->text(), QString("text %1 ").arg(i).repeated(100));
+    }
+
+    QCOMPARE(undoStack.redo(data), false);
+}
+
+void UndoStackTest::testCorruptCompressedCommand()
+{
+    MindMapData data;
+    const CompressedCommand command { UnreadableCommand() };
+    QVERIFY_EXCEPTION_THROWN(command.undo(data), CorruptCommandException);
+    QVERIFY_EXCEPTION_THROWN(command.redo(data), CorruptCommandException);
+}
+
+void UndoStackTest::testCorruptJournal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto fileName = dir.path() + "/test.mm";
+
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.setJournal(make_shared<UndoJournal>(fileName));
+    const int editCount = static_cast<int>(Constants::Undo::UNCOMPRESSED_EDITS) * 2;
+    for (int i = 0; i < editCount; i++) {
+        undoStack.pushUndoPoint(data);
+        node->setText(QString("text %1").arg(i));
+    }
+
+    // Past the file header and the record header is the payload of the first edit, which is evicted
+    // from memory and read back from the journal
+    QFile journalFile(UndoJournal::fileName(fileName));
+    QVERIFY(journalFile.open(QIODevice::ReadWrite));
+    QVERIFY(journalFile.seek(4 + 7));
+    journalFile.write("garbage");
+    journalFile.close();
+
+    for (int i = editCount - 1; i > 0; i--) {
+        QVERIFY(undoStack.undo(data));
+        QCOMPARE(node->text(), QString("text %1").arg(i - 1));
+    }
+
+    // The history is dropped instead of going on with a mind map that doesn't match it
+    QCOMPARE(undoStack.undo(data), false);
+    QCOMPARE(node->text(), QString("text 0"));
+    QCOMPARE(undoStack.isUndoable(), false);
+    QCOMPARE(undoStack.isRedoable(), false);
+    QCOMPARE(undoStack.hasJournal(), false);
+}
+
+void UndoStackTest::testEmptyEditsAreDropped()
+{
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.pushUndoPoint(data);
+    node->setText("foo");
+
+    // E.g. plain clicks
+    undoStack.pushUndoPoint(data);
+    undoStack.pushUndoPoint(data);
+    undoStack.pushUndoPoint(data);
+    node->setText("bar");
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString("foo"));
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+    QCOMPARE(undoStack.undo(data), false);
+
+    // Undo points without changes keep the redo history
+    QVERIFY(undoStack.redo(data));
+    undoStack.pushUndoPoint(data);
+    QVERIFY(undoStack.redo(data));
+    QCOMPARE(node->text(), QString("bar"));
+}
+
+void UndoStackTest::testJournal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Only the hash of the document matters here
+    const auto fileName = dir.path() + "/test.mm";
+    QFile document(fileName);
+    QVERIFY(document.open(QIODevice::WriteOnly));
+    document.write("saved");
+    document.close();
+    const auto hash = UndoJournal::documentHash(fileName);
+
+    const int editCount = static_cast<int>(Constants::Undo::UNCOMPRESSED_EDITS) * 2;
+    {
+        MindMapData data;
+        const auto node = make_shared<Node>();
+        data.graph().addNode(node);
+
+        UndoStack undoStack;
+        undoStack.setJournal(make_shared<UndoJournal>(fileName));
+        for (int i = 0; i < editCount; i++) {
+            undoStack.pushUndoPoint(data);
+            node->setText(QString("text %1").arg(i));
+        }
+        QVERIFY(undoStack.undo(data));
+
+        undoStack.markSaved(data, hash);
+
+        // Edits after the save are not restored
+        undoStack.pushUndoPoint(data);
+        node->setText("foo");
+        undoStack.pushUndoPoint(data);
+    }
+
+    // Torn record, e.g. after a crash
+    QFile journalFile(UndoJournal::fileName(fileName));
+    QVERIFY(journalFile.open(QIODevice::Append));
+    journalFile.write("garbage");
+    journalFile.close();
+
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+    node->setText(QString("text %1").arg(editCount - 2));
+
+    UndoStack undoStack;
+    undoStack.restoreFromJournal(make_shared<UndoJournal>(fileName), hash);
+    QVERIFY(undoStack.isUndoable());
+    QVERIFY(undoStack.isRedoable());
+
+    QVERIFY(undoStack.redo(data));
+    QCOMPARE(node->text(), QString("text %1").arg(editCount - 1));
+
+    for (int i = editCount - 2; i >= 0; i--) {
+        QVERIFY(undoStack.undo(data));
+        QCOMPARE(node->text(), QString("text %1").arg(i));
+    }
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+    QCOMPARE(undoStack.undo(data), false);
+
+    // The history of another version of the document is not restored. The journal is locked until released.
+    undoStack.clear();
+    undoStack.restoreFromJournal(make_shared<UndoJournal>(fileName), UndoJournal::documentHash(dir.path() + "/other.mm"));
+    QCOMPARE(undoStack.isUndoable(), false);
+    QCOMPARE(undoStack.isRedoable(), false);
+}
+
+void UndoStackTest::testJournalInterruptedCompaction()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const auto fileName = dir.path() + "/test.mm";
+    QFile document(fileName);
+    QVERIFY(document.open(QIODevice::WriteOnly));
+    document.write("saved");
+    document.close();
+    const auto hash = UndoJournal::documentHash(fileName);
+
+    {
+        MindMapData data;
+        const auto node = make_shared<Node>();
+        data.graph().addNode(node);
+
+        UndoStack undoStack;
+        undoStack.setJournal(make_shared<UndoJournal>(fileName));
+        undoStack.pushUndoPoint(data);
+        node->setText("foo");
+        undoStack.pushUndoPoint(data);
+        undoStack.markSaved(data, hash);
+    }
+
+    // A crash after the old journal was moved aside but before the compacted one was moved in place
+    const auto journalFileName = UndoJournal::fileName(fileName);
+    QVERIFY(QFile::copy(journalFileName, journalFileName + ".tmp"));
+    QVERIFY(QFile::rename(journalFileName, journalFileName + ".old"));
+
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+    node->setText("foo");
+
+    UndoStack undoStack;
+    undoStack.restoreFromJournal(make_shared<UndoJournal>(fileName), hash);
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+
+    QVERIFY(QFile::exists(journalFileName));
+    QVERIFY(!QFile::exists(journalFileName + ".tmp"));
+    QVERIFY(!QFile::exists(journalFileName + ".old"));
+}
+
+void UndoStackTest::testJournalInUse()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto fileName = dir.path() + "/test.mm";
+
+    // E.g. another instance with the same document open
+    const auto journal = make_shared<UndoJournal>(fileName);
+    QVERIFY(journal->isOpen());
+    QCOMPARE(UndoJournal(fileName).isOpen(), false);
+
+    // The history is kept in memory only
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.setJournal(make_shared<UndoJournal>(fileName));
+    QCOMPARE(undoStack.hasJournal(), false);
+    undoStack.pushUndoPoint(data);
+    node->setText("foo");
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+}
+
+void UndoStackTest::testJournalWriteFailure()
+{
+    if (!QFile::exists("/dev/full")) {
+        QSKIP("Needs /dev/full to fail writes");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto fileName = dir.path() + "/test.mm";
+
+    // Every write to the journal fails as if the disk was full
+    QVERIFY(QFile::link("/dev/full", UndoJournal::fileName(fileName)));
+
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.restoreFromJournal(make_shared<UndoJournal>(fileName), UndoJournal::documentHash(fileName));
+    QVERIFY(undoStack.hasJournal());
+
+    const int editCount = static_cast<int>(Constants::Undo::UNCOMPRESSED_EDITS) * 2;
+    for (int i = 0; i < editCount; i++) {
+        undoStack.pushUndoPoint(data);
+        node->setText(QString("text %1").arg(i));
+    }
+
+    // The edits are kept in memory instead, also the ones deep enough to be evicted
+    for (int i = editCount - 1; i > 0; i--) {
+        QVERIFY(undoStack.undo(data));
+        QCOMPARE(node->text(), QString("text %1").arg(i - 1));
+    }
+    QCOMPARE(undoStack.hasJournal(), false);
+
+    // Nor is the history moved to a journal that can't be written
+    undoStack.setJournal(make_shared<UndoJournal>(fileName));
+    QCOMPARE(undoStack.hasJournal(), false);
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+    for (int i = 0; i < editCount; i++) {
+        QVERIFY(undoStack.redo(data));
+    }
+    QCOMPARE(node->text(), QString("text %1").arg(editCount - 1));
+}
+
+void UndoStackTest::testMemoryBudget()
+{
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.pushUndoPoint(data);
+    node->setText("foo");
+    undoStack.pushUndoPoint(data);
+    node->setText("bar");
+    undoStack.pushUndoPoint(data);
+    node->setText("baz");
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString("bar"));
+
+    const auto usage = undoStack.memoryUsage();
+    undoStack.setMemoryBudget(1);
+
+    QVERIFY(undoStack.memoryUsage() < usage);
+
+    // Only the edit next to the current state is kept even if it alone exceeds the budget
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString("foo"));
+    QCOMPARE(undoStack.undo(data), false);
+
+    QVERIFY(undoStack.redo(data));
+    QCOMPARE(node->text(), QString("bar"));
+    QCOMPARE(undoStack.redo(data), false);
+}
+
+void UndoStackTest::testMemoryUsage()
+{
+    MindMapData data;
+    const auto node0 = make_shared<Node>();
+    data.graph().addNode(node0);
+
+    UndoStack undoStack;
+
+    QCOMPARE(undoStack.memoryUsage(), size_t(0));
+
+    undoStack.pushUndoPoint(data);
+    const auto node1 = make_shared<Node>();
+    data.graph().addNode(node1);
+    undoStack.pushUndoPoint(data);
+
+    const auto usage = undoStack.memoryUsage();
+    QVERIFY(usage > 0);
+
+    undoStack.pushUndoPoint(data);
+    node1->setText(QString("foo").repeated(1000));
+    undoStack.pushUndoPoint(data);
+
+    QVERIFY(undoStack.memoryUsage() > usage + 1000 * sizeof(QChar));
+
+    // Moving edits between undo and redo doesn't change the usage
+    const auto usageBeforeUndo = undoStack.memoryUsage();
+    QVERIFY(undoStack.undo(data));
+    QVERIFY(undoStack.redo(data));
+    QCOMPARE(undoStack.memoryUsage(), usageBeforeUndo);
+
+    // Pushing an undo point drops the redo history
+    QVERIFY(undoStack.undo(data));
+    QVERIFY(undoStack.undo(data));
+    undoStack.pushUndoPoint(data);
+    QVERIFY(undoStack.memoryUsage() < usageBeforeUndo);
+
+    undoStack.clear();
+
+    QCOMPARE(undoStack.memoryUsage(), size_t(0));
+}
+
+void UndoStackTest::testMergeUndoPoints()
+{
+    MindMapData data;
+
+    UndoStack undoStack;
+    for (int textSize = 12; textSize <= 20; textSize++) {
+        undoStack.pushUndoPoint(data, "textSize");
+        data.setTextSize(textSize);
+    }
+
+    undoStack.pushUndoPoint(data, "cornerRadius");
+    data.setCornerRadius(10);
+    undoStack.pushUndoPoint(data, "cornerRadius");
+    data.setCornerRadius(11);
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(data.cornerRadius(), Constants::Node::DEFAULT_CORNER_RADIUS);
+    QCOMPARE(data.textSize(), 20);
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(data.textSize(), Constants::MindMap::DEFAULT_TEXT_SIZE);
+    QCOMPARE(undoStack.undo(data), false);
+
+    QVERIFY(undoStack.redo(data));
+    QCOMPARE(data.textSize(), 20);
+}
+
+void UndoStackTest::testRestoreSnapshot()
+{
+    static_assert(!std::is_copy_constructible<MindMapData>::value, "Undo states must be kept as snapshots");
+
+    MindMapData data;
+    data.setEdgeWidth(3);
+    const auto node0 = make_shared<Node>();
+    node0->setText("foo");
+    data.graph().addNode(node0);
+    const auto node1 = make_shared<Node>();
+    node1->setLocation({ 1, 2 });
+    data.graph().addNode(node1);
+    data.graph().addEdge(make_shared<Edge>(*node0, *node1));
+
+    const auto snapshot = data.snapshot();
+
+    node0->setText("bar");
+    data.graph().deleteNode(node1->index());
+    data.setEdgeWidth(4);
+
+    // Graphics items are created only when a state is restored
+    MindMapData restored(snapshot);
+
+    QCOMPARE(restored.edgeWidth(), 3.0);
+    QCOMPARE(restored.graph().numNodes(), size_t(2));
+    QCOMPARE(restored.graph().getEdges().size(), size_t(1));
+    QCOMPARE(restored.graph().getNode(node0->index())->text(), QString("foo"));
+    QCOMPARE(restored.graph().getNode(node1->index())->location(), QPointF(1, 2));
+    QVERIFY(restored.graph().getNode(node0->index()) != node0);
+}
+
+void UndoStackTest::testSerializeCommand()
+{
+    MindMapData data;
+    const auto node0 = make_shared<Node>();
+    data.graph().addNode(node0);
+    const auto node1 = make_shared<Node>();
+    data.graph().addNode(node1);
+
+    const auto before = data.snapshot();
+
+    const auto node2 = make_shared<Node>();
+    node2->setText("foo");
+    data.graph().addNode(node2);
+    data.graph().addEdge(make_shared<Edge>(*node1, *node2));
+    node0->setLocation({ 1, 2 });
+    node1->setColor(Qt::red);
+    data.setEdgeWidth(3);
+
+    const auto command = CompoundCommand::fromSnapshots(before, data.snapshot());
+
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    command->write(out);
+
+    QDataStream in(bytes);
+    const auto readCommand = UndoCommand::read(in);
+    QVERIFY(readCommand);
+
+    readCommand->undo(data);
+
+    QCOMPARE(data.graph().numNodes(), size_t(2));
+    QCOMPARE(data.graph().getEdges().size(), size_t(0));
+    QCOMPARE(node0->location(), QPointF(0, 0));
+    QCOMPARE(node1->color(), before.graph.nodes.at(1).color);
+    QCOMPARE(data.edgeWidth(), before.edgeWidth);
+
+    readCommand->redo(data);
+
+    QCOMPARE(data.graph().numNodes(), size_t(3));
+    QCOMPARE(data.graph().getEdges().size(), size_t(1));
+    QCOMPARE(data.graph().getNode(node2->index())->text(), QString("foo"));
+    QCOMPARE(node0->location(), QPointF(1, 2));
+    QCOMPARE(node1->color(), QColor(Qt::red));
+    QCOMPARE(data.edgeWidth(), 3.0);
+}
+
+void UndoStackTest::testTransaction()
+{
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    UndoStack undoStack;
+    undoStack.beginTransaction(data);
+    node->setLocation({ 1, 1 });
+    undoStack.pushUndoPoint(data);
+    node->setLocation({ 2, 2 });
+    undoStack.beginTransaction(data);
+    node->setText("foo");
+    undoStack.endTransaction();
+    undoStack.pushUndoPoint(data);
+    undoStack.endTransaction();
+
+    undoStack.pushUndoPoint(data);
+    node->setText("bar");
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString("foo"));
+    QCOMPARE(node->location(), QPointF(2, 2));
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+    QCOMPARE(node->location(), QPointF(0, 0));
+    QCOMPARE(undoStack.undo(data), false);
+}
+
+void UndoStackTest::testUnbalancedTransaction()
+{
+    MindMapData data;
+    const auto node = make_shared<Node>();
+    data.graph().addNode(node);
+
+    // E.g. a drag whose mouse release never arrives
+    UndoStack undoStack;
+    undoStack.beginTransaction(data);
+    undoStack.beginTransaction(data);
+    node->setLocation({ 1, 1 });
+    undoStack.endTransaction();
+    undoStack.endAllTransactions();
+
+    undoStack.pushUndoPoint(data);
+    node->setText("foo");
+    undoStack.pushUndoPoint(data);
+    node->setText("bar");
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString("foo"));
+    QCOMPARE(node->location(), QPointF(1, 1));
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->text(), QString(""));
+    QCOMPARE(node->location(), QPointF(1, 1));
+
+    QVERIFY(undoStack.undo(data));
+    QCOMPARE(node->location(), QPointF(0, 0));
+    QCOMPARE(undoStack.undo(data), false);
+}
+
+QTEST_GUILESS_MAIN(UndoStackTest)
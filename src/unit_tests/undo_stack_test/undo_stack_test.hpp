@@ -0,0 +1,61 @@
+// This file is part of Heimer.
+// Copyright (C) 2020 Jussi Lind <jussi.lind@iki.fi>
+//
+// Heimer is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Heimer is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Heimer. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef UNDO_STACK_TEST_HPP
+#define UNDO_STACK_TEST_HPP
+
+#include <QTest>
+
+class UndoStackTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    UndoStackTest();
+
+private slots:
+
+    void testCompressedEdits();
+
+    void testCorruptCompressedCommand();
+
+    void testCorruptJournal();
+
+    void testEmptyEditsAreDropped();
+
+    void testJournal();
+
+    void testJournalInterruptedCompaction();
+
+    void testJournalInUse();
+
+    void testJournalWriteFailure();
+
+    void testMemoryBudget();
+
+    void testMemoryUsage();
+
+    void testMergeUndoPoints();
+
+    void testRestoreSnapshot();
+
+    void testSerializeCommand();
+
+    void testTransaction();
+
+    void testUnbalancedTransaction();
+};
+
+#endif // UNDO_STACK_TEST_HPP
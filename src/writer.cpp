@@ -14,18 +14,35 @@
 // along with Heimer. If not, see <http://www.gnu.org/licenses/>.
 
 #include "writer.hpp"
+#include "binary_serializer.hpp"
+#include "constants.hpp"
+#include "container_serializer.hpp"
+#include "graph.hpp"
+#include "serializer.hpp"
 
-#include <QFile>
-#include <QTextStream>
+#include <QSaveFile>
 
-bool Writer::writeToFile(QDomDocument document, QString filePath)
+static bool write(MindMapData & mindMapData, QIODevice & device, QString filePath)
 {
-    QFile file(filePath);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&file);
-        out << document;
-        file.close();
-        return true;
+    if (filePath.endsWith(Constants::Application::BINARY_FILE_EXTENSION, Qt::CaseInsensitive)) {
+        return BinarySerializer::toBinary(mindMapData, device);
+    }
+
+    // Images are stored as they are in the container instead of as base64 in the XML. Plain XML stays the
+    // default, as also older versions can open it.
+    if (filePath.endsWith(Constants::Application::CONTAINER_FILE_EXTENSION, Qt::CaseInsensitive)) {
+        return ContainerSerializer::toContainer(mindMapData, device);
+    }
+
+    return Serializer::toXml(mindMapData, device);
+}
+
+bool Writer::writeToFile(MindMapData & mindMapData, QString filePath)
+{
+    // The map is streamed to the file, so the existing file is replaced only after everything was written
+    QSaveFile file(filePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        return write(mindMapData, file, filePath) && file.commit();
     }
 
     return false;
@@ -16,11 +16,14 @@
 #ifndef WRITER_HPP
 #define WRITER_HPP
 
-#include <QDomDocument>
+#include <QString>
+
+#include "mind_map_data.hpp"
 
 namespace Writer {
 
-bool writeToFile(QDomDocument document, QString filePath);
+//! Streams the mind map to the file in the format given by the extension. \return False if the file couldn't be written.
+bool writeToFile(MindMapData & mindMapData, QString filePath);
 }
 
 #endif // WRITER_HPP